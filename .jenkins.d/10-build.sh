@@ -21,6 +21,16 @@ if [[ $JOB_NAME != *code-coverage && $JOB_NAME != *limited-build ]]; then
     # Cleanup
     ./waf --color=yes distclean
 
+    if [[ $(uname -m) == x86_64 ]] && grep -qw avx2 /proc/cpuinfo 2>/dev/null; then
+        # Build in release mode with AVX2 and run the tests of the hash functions
+        ./waf --color=yes configure --with-tests --with-avx2
+        ./waf --color=yes build
+        ./build/unit-tests -t TestUtil -t TestBloomFilter
+
+        # Cleanup
+        ./waf --color=yes distclean
+    fi
+
     # Build in release mode with examples
     ./waf --color=yes configure --with-examples
     ./waf --color=yes build
@@ -54,6 +54,18 @@ enum class CompressionScheme {
 #endif
 };
 
+/**
+ * @brief Kind of filter a Consumer uses to send its subscription list
+ */
+enum class SubscriptionFilterType {
+  /// Bloom filter, understood by every PartialProducer
+  BLOOM,
+  /// Cuckoo filter, smaller than a Bloom filter at low false positive probabilities
+  CUCKOO,
+  /// Xor filter, the smallest, but rebuilt whenever the subscription list changes
+  XOR,
+};
+
 class CompressionError : public std::runtime_error
 {
 public:
@@ -70,6 +82,27 @@ struct MissingDataInfo
 
 using UpdateCallback = std::function<void(const std::vector<MissingDataInfo>&)>;
 
+/**
+ * @brief Metrics of the delivery of updates to UpdateCallback
+ */
+struct UpdateDeliveryStats
+{
+  /// Number of prefixes whose updates are waiting to be delivered
+  size_t queueDepth = 0;
+  /// Largest queueDepth so far
+  size_t maxQueueDepth = 0;
+  /// Number of updates received in sync Data
+  uint64_t nUpdatesReceived = 0;
+  /// Number of updates merged into a waiting update of the same prefix
+  uint64_t nUpdatesMerged = 0;
+  /// Number of UpdateCallback calls
+  uint64_t nDeliveries = 0;
+  /// How long the updates of the last delivery waited, from the first one received
+  ndn::time::nanoseconds lastFlushLatency = 0_ns;
+  /// Longest lastFlushLatency so far
+  ndn::time::nanoseconds maxFlushLatency = 0_ns;
+};
+
 } // namespace psync
 
 #endif // PSYNC_COMMON_HPP
@@ -0,0 +1,236 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/consumer-group.hpp"
+
+#include <ndn-cxx/util/logger.hpp>
+
+#include <algorithm>
+
+namespace psync {
+
+NDN_LOG_INIT(psync.ConsumerGroup);
+
+ConsumerGroup::ConsumerGroup(ndn::Face& face, const Options& opts)
+  : m_face(face)
+  , m_scheduler(m_face.getIoContext())
+  , m_onHelloData(opts.onHelloData)
+  , m_onUpdate(opts.onUpdate)
+  , m_consumerOptions(opts.consumerOptions)
+  , m_maxConcurrentHellos(std::max<size_t>(opts.maxConcurrentHellos, 1))
+  , m_rng(ndn::random::getRandomNumberEngine())
+{
+}
+
+Consumer*
+ConsumerGroup::addSyncGroup(const ndn::Name& syncPrefix)
+{
+  if (m_groups.count(syncPrefix) != 0) {
+    return nullptr;
+  }
+
+  NDN_LOG_DEBUG("Adding sync group " << syncPrefix);
+
+  auto it = m_groups.try_emplace(syncPrefix, m_face, m_scheduler, syncPrefix,
+                                 m_consumerOptions).first;
+  // The consumer outlives its callbacks, which are small enough not to be allocated
+  Consumer* consumer = &it->second.consumer;
+  consumer->m_onReceiveHelloData = [this, consumer] (const auto& availableSubs) {
+    onHelloData(consumer->m_syncPrefix, availableSubs);
+  };
+  consumer->m_onUpdate = [this, consumer] (const auto& updates) {
+    onUpdate(consumer->m_syncPrefix, updates);
+  };
+  consumer->m_onHelloFetchError = [this, consumer] { onHelloFetchError(consumer->m_syncPrefix); };
+  return consumer;
+}
+
+bool
+ConsumerGroup::removeSyncGroup(const ndn::Name& syncPrefix)
+{
+  auto it = m_groups.find(syncPrefix);
+  if (it == m_groups.end()) {
+    return false;
+  }
+
+  NDN_LOG_DEBUG("Removing sync group " << syncPrefix);
+
+  auto& group = it->second;
+  group.consumer.stop();
+  if (group.isHelloQueued) {
+    m_helloQueue.erase(std::find(m_helloQueue.begin(), m_helloQueue.end(), it));
+  }
+  if (group.isHelloInFlight) {
+    --m_nHellosInFlight;
+  }
+  m_pendingUpdates.erase(syncPrefix);
+
+  // We may be called from a callback of this consumer, destroy it once it has returned
+  auto node = std::make_shared<GroupMap::node_type>(m_groups.extract(it));
+  m_scheduler.schedule(0_ms, [node] {});
+
+  startQueuedHellos();
+  return true;
+}
+
+Consumer*
+ConsumerGroup::getConsumer(const ndn::Name& syncPrefix) const
+{
+  auto it = m_groups.find(syncPrefix);
+  return it == m_groups.end() ? nullptr : &it->second.consumer;
+}
+
+bool
+ConsumerGroup::sendHelloInterest(const ndn::Name& syncPrefix)
+{
+  auto it = m_groups.find(syncPrefix);
+  if (it == m_groups.end()) {
+    return false;
+  }
+
+  auto& group = it->second;
+  if (!group.isHelloQueued && !group.isHelloInFlight) {
+    group.isHelloQueued = true;
+    m_helloQueue.push_back(it);
+    startQueuedHellos();
+  }
+  return true;
+}
+
+void
+ConsumerGroup::sendHelloInterests()
+{
+  for (auto it = m_groups.begin(); it != m_groups.end(); ++it) {
+    auto& group = it->second;
+    if (!group.isHelloQueued && !group.isHelloInFlight) {
+      group.isHelloQueued = true;
+      m_helloQueue.push_back(it);
+    }
+  }
+  startQueuedHellos();
+}
+
+void
+ConsumerGroup::stop()
+{
+  for (auto& [syncPrefix, group] : m_groups) {
+    group.consumer.stop();
+    group.isHelloQueued = false;
+    group.isHelloInFlight = false;
+    group.helloRetryEvent.cancel();
+  }
+  m_helloQueue.clear();
+  m_nHellosInFlight = 0;
+  m_pendingUpdates.clear();
+  m_dispatchEvent.cancel();
+}
+
+void
+ConsumerGroup::startQueuedHellos()
+{
+  while (!m_helloQueue.empty() && m_nHellosInFlight < m_maxConcurrentHellos) {
+    auto& group = m_helloQueue.front()->second;
+    m_helloQueue.pop_front();
+
+    group.isHelloQueued = false;
+    group.isHelloInFlight = true;
+    ++m_nHellosInFlight;
+    group.consumer.sendHelloInterest();
+  }
+
+  NDN_LOG_TRACE(m_nHellosInFlight << " hello Interests outstanding, " <<
+                m_helloQueue.size() << " queued");
+}
+
+void
+ConsumerGroup::onHelloData(const ndn::Name& syncPrefix,
+                           const std::map<ndn::Name, uint64_t>& availableSubs)
+{
+  auto it = m_groups.find(syncPrefix);
+  if (it == m_groups.end()) {
+    return;
+  }
+
+  // The consumer also sends hello Interests by itself, after an application Nack
+  if (it->second.isHelloInFlight) {
+    it->second.isHelloInFlight = false;
+    --m_nHellosInFlight;
+    startQueuedHellos();
+  }
+
+  m_onHelloData(syncPrefix, availableSubs);
+}
+
+void
+ConsumerGroup::onHelloFetchError(const ndn::Name& syncPrefix)
+{
+  auto it = m_groups.find(syncPrefix);
+  if (it == m_groups.end()) {
+    return;
+  }
+
+  // Let other groups fetch hello data while this one waits
+  auto& group = it->second;
+  if (group.isHelloInFlight) {
+    group.isHelloInFlight = false;
+    --m_nHellosInFlight;
+  }
+
+  ndn::time::milliseconds after(m_helloRetryDelay(m_rng));
+  NDN_LOG_TRACE("Queuing hello Interest for " << syncPrefix << " again after " << after);
+  group.helloRetryEvent = m_scheduler.schedule(after, [this, syncPrefix] {
+    sendHelloInterest(syncPrefix);
+  });
+
+  startQueuedHellos();
+}
+
+void
+ConsumerGroup::onUpdate(const ndn::Name& syncPrefix, const std::vector<MissingDataInfo>& updates)
+{
+  // The group may have been removed from the hello callback that precedes missed updates
+  if (m_groups.count(syncPrefix) == 0) {
+    return;
+  }
+
+  if (m_pendingUpdates.empty()) {
+    // Runs after the I/O events that are already ready, which may bring more updates
+    m_dispatchEvent = m_scheduler.schedule(0_ms, [this] { dispatchUpdates(); });
+  }
+
+  auto& pending = m_pendingUpdates[syncPrefix];
+  pending.insert(pending.end(), updates.begin(), updates.end());
+}
+
+void
+ConsumerGroup::dispatchUpdates()
+{
+  // All the pending updates may belong to groups removed since
+  if (m_pendingUpdates.empty()) {
+    return;
+  }
+
+  auto updates = std::move(m_pendingUpdates);
+  m_pendingUpdates.clear();
+
+  NDN_LOG_DEBUG("Dispatching updates of " << updates.size() << " sync groups");
+  m_onUpdate(updates);
+}
+
+} // namespace psync
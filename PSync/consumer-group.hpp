@@ -0,0 +1,201 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PSYNC_CONSUMER_GROUP_HPP
+#define PSYNC_CONSUMER_GROUP_HPP
+
+#include "PSync/consumer.hpp"
+
+#include <deque>
+
+namespace psync {
+
+using GroupHelloCallback = std::function<void(const ndn::Name& syncPrefix,
+                                              const std::map<ndn::Name, uint64_t>&)>;
+
+/**
+ * @brief Updates received by the consumers of a ConsumerGroup, by sync prefix
+ */
+using GroupUpdateCallback = std::function<void(const std::map<ndn::Name,
+                                                              std::vector<MissingDataInfo>>&)>;
+
+/**
+ * @brief Partial sync consumers of many sync groups sharing one face
+ *
+ * Each sync group, identified by its sync prefix, is followed by a Consumer.
+ * The consumers share a single scheduler for their retransmission timers, and the
+ * updates they receive are dispatched together: all updates received while processing
+ * one batch of I/O events are passed to a single GroupUpdateCallback call.
+ *
+ * Hello Interests are sent through a queue shared by all groups, so that at most
+ * Options::maxConcurrentHellos groups are fetching hello data at a time. A group whose
+ * hello data cannot be fetched gives up its place and is queued again after a random
+ * delay. Sync Interests, which stay pending at the producer until there is new data,
+ * are not limited.
+ *
+ * The application subscribes to prefixes through the Consumer of each group,
+ * typically from GroupHelloCallback, like it would with a standalone Consumer.
+ *
+ * Only the scheduler, the hello queue and the update dispatch are shared: each group keeps
+ * its own segment fetchers, subscription filter and sequence numbers, as a standalone
+ * Consumer does. A group thus saves the scheduler and its timer, and the callbacks need
+ * no copy of the sync prefix, but its memory stays close to that of a Consumer.
+ * benchmarks/consumer-group.cpp compares the allocations and timers with those of
+ * independent consumers.
+ */
+class ConsumerGroup
+{
+public:
+  /**
+   * @brief Constructor options.
+   */
+  struct Options
+  {
+    /// Callback to give hello data of a sync group back to application.
+    GroupHelloCallback onHelloData = [] (const auto&, const auto&) {};
+    /// Callback to give sync data of all sync groups back to application.
+    GroupUpdateCallback onUpdate = [] (const auto&) {};
+    /// Options of the consumer of each sync group. Its callbacks are not used.
+    Consumer::Options consumerOptions;
+    /// Maximum number of sync groups fetching hello data at the same time.
+    size_t maxConcurrentHellos = 16;
+  };
+
+  /**
+   * @brief Constructor.
+   *
+   * @param face Application face, shared by all sync groups.
+   * @param opts Options.
+   */
+  ConsumerGroup(ndn::Face& face, const Options& opts);
+
+  /**
+   * @brief Start following a sync group
+   *
+   * @param syncPrefix Prefix to send hello and sync Interests to the producer of the group.
+   * @return the consumer of the group, or nullptr if the group is already followed
+   */
+  Consumer*
+  addSyncGroup(const ndn::Name& syncPrefix);
+
+  /**
+   * @brief Stop following a sync group
+   *
+   * Updates of the group not yet passed to the application are dropped.
+   * May be called from the callbacks.
+   *
+   * @return true if the group is removed, false if it is not followed
+   */
+  bool
+  removeSyncGroup(const ndn::Name& syncPrefix);
+
+  /**
+   * @brief Get the consumer of a sync group, or nullptr if the group is not followed
+   */
+  Consumer*
+  getConsumer(const ndn::Name& syncPrefix) const;
+
+  size_t
+  size() const
+  {
+    return m_groups.size();
+  }
+
+  /**
+   * @brief Queue a hello Interest for a sync group
+   *
+   * The Interest is sent once fewer than Options::maxConcurrentHellos groups are
+   * fetching hello data. Nothing is done if a hello Interest is already queued or
+   * outstanding for the group.
+   *
+   * @return false if the group is not followed
+   */
+  bool
+  sendHelloInterest(const ndn::Name& syncPrefix);
+
+  /**
+   * @brief Queue a hello Interest for each sync group
+   */
+  void
+  sendHelloInterests();
+
+  /**
+   * @brief Stop the consumers of all sync groups
+   */
+  void
+  stop();
+
+private:
+  void
+  startQueuedHellos();
+
+  void
+  onHelloData(const ndn::Name& syncPrefix, const std::map<ndn::Name, uint64_t>& availableSubs);
+
+  void
+  onHelloFetchError(const ndn::Name& syncPrefix);
+
+  void
+  onUpdate(const ndn::Name& syncPrefix, const std::vector<MissingDataInfo>& updates);
+
+  void
+  dispatchUpdates();
+
+PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
+  struct SyncGroup
+  {
+    SyncGroup(ndn::Face& face, ndn::Scheduler& scheduler, const ndn::Name& syncPrefix,
+              const Consumer::Options& opts)
+      : consumer(face, &scheduler, syncPrefix, opts)
+    {
+    }
+
+    // Kept in the node of m_groups rather than allocated on its own,
+    // mutable since getConsumer() hands it out
+    mutable Consumer consumer;
+    bool isHelloQueued = false;
+    bool isHelloInFlight = false;
+    ndn::scheduler::ScopedEventId helloRetryEvent;
+  };
+
+  ndn::Face& m_face;
+  ndn::Scheduler m_scheduler;
+
+  GroupHelloCallback m_onHelloData;
+  GroupUpdateCallback m_onUpdate;
+  Consumer::Options m_consumerOptions;
+  size_t m_maxConcurrentHellos;
+
+  using GroupMap = std::map<ndn::Name, SyncGroup>;
+  GroupMap m_groups;
+
+  // Groups waiting to send a hello Interest, removed from here before they are erased
+  std::deque<GroupMap::iterator> m_helloQueue;
+  size_t m_nHellosInFlight = 0;
+  ndn::random::RandomNumberEngine& m_rng;
+  std::uniform_int_distribution<> m_helloRetryDelay{100, 500};
+
+  // Updates received since the last dispatch
+  std::map<ndn::Name, std::vector<MissingDataInfo>> m_pendingUpdates;
+  ndn::scheduler::ScopedEventId m_dispatchEvent;
+};
+
+} // namespace psync
+
+#endif // PSYNC_CONSUMER_GROUP_HPP
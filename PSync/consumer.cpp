@@ -23,20 +23,38 @@
 #include <ndn-cxx/security/validator-null.hpp>
 #include <ndn-cxx/util/logger.hpp>
 
+#include <algorithm>
+
 namespace psync {
 
 NDN_LOG_INIT(psync.Consumer);
 
 Consumer::Consumer(ndn::Face& face, const ndn::Name& syncPrefix, const Options& opts)
+  : Consumer(face, nullptr, syncPrefix, opts)
+{
+}
+
+Consumer::Consumer(ndn::Face& face, ndn::Scheduler* scheduler, const ndn::Name& syncPrefix,
+                   const Options& opts)
   : m_face(face)
-  , m_scheduler(m_face.getIoContext())
+  , m_ownScheduler(scheduler ? nullptr : std::make_unique<ndn::Scheduler>(m_face.getIoContext()))
+  , m_scheduler(scheduler ? *scheduler : *m_ownScheduler)
   , m_syncPrefix(syncPrefix)
   , m_helloInterestPrefix(ndn::Name(m_syncPrefix).append("hello"))
   , m_syncInterestPrefix(ndn::Name(m_syncPrefix).append("sync"))
   , m_syncDataContentType(ndn::tlv::ContentType_Blob)
   , m_onReceiveHelloData(opts.onHelloData)
   , m_onUpdate(opts.onUpdate)
-  , m_bloomFilter(opts.bfCount, opts.bfFalsePositive)
+  , m_updateBatcher(m_scheduler, [this] (const auto& updates) { m_onUpdate(updates); },
+                    opts.updateBatchInterval, opts.updateBatchSize)
+  , m_subscriptionFilter(detail::makeSubscriptionFilter(opts.subscriptionFilter, opts.bfCount,
+                                                        opts.bfFalsePositive, opts.bfBlocked))
+  , m_subscriptionFilterType(opts.subscriptionFilter)
+  , m_subscriptionFilterCount(opts.bfCount)
+  , m_subscriptionFilterFalsePositive(opts.bfFalsePositive)
+  , m_isBloomFilterBlocked(opts.bfBlocked)
+  , m_useSubscriptionToken(opts.useSubscriptionToken)
+  , m_pipelineSyncInterests(opts.pipelineSyncInterests)
   , m_helloInterestLifetime(opts.helloInterestLifetime)
   , m_syncInterestLifetime(opts.syncInterestLifetime)
   , m_rng(ndn::random::getRandomNumberEngine())
@@ -69,10 +87,10 @@ Consumer::addSubscription(const ndn::Name& prefix, uint64_t seqNo, bool callSync
   NDN_LOG_DEBUG("Subscribing prefix: " << prefix);
 
   m_subscriptionList.emplace(prefix);
-  m_bloomFilter.insert(prefix);
+  insertIntoSubscriptionFilter(prefix);
 
   if (callSyncDataCb && seqNo != 0) {
-    m_onUpdate({{prefix, seqNo, seqNo, 0}});
+    m_updateBatcher.add({{prefix, seqNo, seqNo, 0}});
   }
 
   return true;
@@ -88,27 +106,115 @@ Consumer::removeSubscription(const ndn::Name& prefix)
 
   m_prefixes.erase(prefix);
   m_subscriptionList.erase(prefix);
+  m_subscriptionFilter->erase(prefix);
 
-  // Clear and reconstruct the bloom filter
-  m_bloomFilter.clear();
+  return true;
+}
 
-  for (const auto& item : m_subscriptionList)
-    m_bloomFilter.insert(item);
+size_t
+Consumer::addSubscriptions(const std::map<ndn::Name, uint64_t>& subscriptions, bool callSyncDataCb)
+{
+  std::vector<MissingDataInfo> updates;
+  size_t nAdded = 0;
 
-  return true;
+  for (const auto& [prefix, seqNo] : subscriptions) {
+    if (!m_prefixes.emplace(prefix, seqNo).second) {
+      continue;
+    }
+
+    NDN_LOG_DEBUG("Subscribing prefix: " << prefix);
+    m_subscriptionList.emplace(prefix);
+    insertIntoSubscriptionFilter(prefix);
+    ++nAdded;
+
+    if (callSyncDataCb && seqNo != 0) {
+      updates.push_back({prefix, seqNo, seqNo, 0});
+    }
+  }
+
+  if (!updates.empty()) {
+    m_updateBatcher.add(updates);
+  }
+
+  if (nAdded > 0 && !m_iblt.empty()) {
+    sendSyncInterest();
+  }
+
+  return nAdded;
+}
+
+size_t
+Consumer::removeSubscriptions(const std::vector<ndn::Name>& prefixes)
+{
+  size_t nRemoved = 0;
+
+  for (const auto& prefix : prefixes) {
+    if (m_subscriptionList.erase(prefix) == 0) {
+      continue;
+    }
+
+    NDN_LOG_DEBUG("Unsubscribing prefix: " << prefix);
+    m_prefixes.erase(prefix);
+    m_subscriptionFilter->erase(prefix);
+    ++nRemoved;
+  }
+
+  if (nRemoved > 0 && !m_iblt.empty()) {
+    sendSyncInterest();
+  }
+
+  return nRemoved;
+}
+
+void
+Consumer::insertIntoSubscriptionFilter(const ndn::Name& prefix)
+{
+  try {
+    m_subscriptionFilter->insert(prefix);
+    return;
+  }
+  catch (const detail::SubscriptionFilter::Error& e) {
+    NDN_LOG_DEBUG("Cannot insert " << prefix << " into subscription filter: " << e.what());
+  }
+
+  // Rebuild the filter from the subscription list, which already contains prefix
+  while (true) {
+    m_subscriptionFilterCount = std::max<uint32_t>(2 * m_subscriptionFilterCount,
+                                                   m_subscriptionList.size());
+    NDN_LOG_DEBUG("Growing subscription filter to " << m_subscriptionFilterCount << " elements");
+    m_subscriptionFilter = detail::makeSubscriptionFilter(m_subscriptionFilterType,
+                                                          m_subscriptionFilterCount,
+                                                          m_subscriptionFilterFalsePositive,
+                                                          m_isBloomFilterBlocked);
+    try {
+      for (const auto& subscription : m_subscriptionList) {
+        m_subscriptionFilter->insert(subscription);
+      }
+      return;
+    }
+    catch (const detail::SubscriptionFilter::Error&) {
+    }
+  }
 }
 
 void
 Consumer::stop()
 {
   NDN_LOG_DEBUG("Canceling all the scheduled events");
-  m_scheduler.cancelAllEvents();
+  m_helloRetryEvent.cancel();
+  m_syncRetryEvent.cancel();
+  m_updateBatcher.clear();
 
   if (m_syncFetcher) {
     m_syncFetcher->stop();
     m_syncFetcher.reset();
   }
 
+  if (m_pipelinedSyncFetcher) {
+    m_pipelinedSyncFetcher->stop();
+    m_pipelinedSyncFetcher.reset();
+  }
+
   if (m_helloFetcher) {
     m_helloFetcher->stop();
     m_helloFetcher.reset();
@@ -124,6 +230,7 @@ Consumer::sendHelloInterest()
   if (m_helloFetcher) {
     m_helloFetcher->stop();
   }
+  ++m_stats.nHelloInterests;
 
   using ndn::SegmentFetcher;
   SegmentFetcher::Options options;
@@ -146,9 +253,14 @@ Consumer::sendHelloInterest()
 
   m_helloFetcher->onError.connect([this] (uint32_t errorCode, const std::string& msg) {
     NDN_LOG_TRACE("Cannot fetch hello data, error: " << errorCode << " message: " << msg);
+    ++m_stats.nFetchErrors;
+    if (m_onHelloFetchError) {
+      m_onHelloFetchError();
+      return;
+    }
     ndn::time::milliseconds after(m_rangeUniformRandom(m_rng));
     NDN_LOG_TRACE("Scheduling after " << after);
-    m_scheduler.schedule(after, [this] { sendHelloInterest(); });
+    m_helloRetryEvent = m_scheduler.schedule(after, [this] { sendHelloInterest(); });
   });
 }
 
@@ -156,6 +268,7 @@ void
 Consumer::onHelloData(const ndn::ConstBufferPtr& bufferPtr)
 {
   NDN_LOG_DEBUG("On Hello Data");
+  ++m_stats.nHelloData;
 
   // Extract IBF from name which is the last element in hello data's name
   m_iblt = m_helloDataName.getSubName(m_helloDataName.size() - 1, 1);
@@ -185,7 +298,7 @@ Consumer::onHelloData(const ndn::ConstBufferPtr& bufferPtr)
 
   if (!updates.empty()) {
     NDN_LOG_DEBUG("Updating application with missed updates");
-    m_onUpdate(updates);
+    m_updateBatcher.add(updates);
   }
 }
 
@@ -196,8 +309,20 @@ Consumer::sendSyncInterest()
 
   ndn::Name syncInterestName(m_syncInterestPrefix);
 
-  // Append subscription list
-  m_bloomFilter.appendToName(syncInterestName);
+  // Append subscription list, or only its token if the producer has it already
+  ndn::Name filterName;
+  m_subscriptionFilter->appendToName(filterName);
+  std::optional<ndn::name::Component> token;
+  if (m_useSubscriptionToken) {
+    token = detail::makeSubscriptionToken(filterName);
+  }
+  bool isTokenOnly = token && token == m_registeredToken;
+  if (isTokenOnly) {
+    syncInterestName.append(*token);
+  }
+  else {
+    syncInterestName.append(filterName);
+  }
 
   // Append IBF received in hello/sync data
   syncInterestName.append(m_iblt);
@@ -219,54 +344,113 @@ Consumer::sendSyncInterest()
 
   m_syncFetcher = SegmentFetcher::start(m_face, syncInterest,
                                         ndn::security::getAcceptAllValidator(), options);
+  ++m_stats.nSyncInterests;
+  auto sentTime = ndn::time::steady_clock::now();
+
+  // Set once the next sync Interest has been sent while this sync data is being fetched
+  auto isPipelined = std::make_shared<bool>(false);
+
+  m_syncFetcher->afterSegmentValidated.connect([this, token, isTokenOnly, isPipelined] (const ndn::Data& data) {
+    if (*isPipelined) {
+      return;
+    }
 
-  m_syncFetcher->afterSegmentValidated.connect([this] (const ndn::Data& data) {
     if (data.getFinalBlock()) {
       m_syncDataName = data.getName().getPrefix(-2);
       m_syncDataContentType = data.getContentType();
     }
 
-    if (m_syncDataContentType == ndn::tlv::ContentType_Nack) {
+    // A Nack to a token may only mean that the producer has evicted it, see onComplete
+    if (m_syncDataContentType == ndn::tlv::ContentType_Nack && !isTokenOnly) {
       NDN_LOG_DEBUG("Received application Nack from producer, sending hello again");
       sendHelloInterest();
+      return;
+    }
+
+    // Segments of earlier sync data may still be in flight, pipeline one at a time
+    if (m_pipelineSyncInterests && !m_pipelinedSyncFetcher &&
+        data.getContentType() != ndn::tlv::ContentType_Nack) {
+      *isPipelined = true;
+      m_iblt = data.getName().getPrefix(-2).getSubName(-1, 1);
+      if (token) {
+        m_registeredToken = token;
+      }
+      NDN_LOG_TRACE("Pipelining sync Interest with m_iblt: " << std::hash<ndn::Name>{}(m_iblt));
+      m_pipelinedSyncFetcher = std::move(m_syncFetcher);
+      sendSyncInterest();
     }
   });
 
-  m_syncFetcher->onComplete.connect([this] (const ndn::ConstBufferPtr& bufferPtr) {
+  m_syncFetcher->onComplete.connect([this, token, isTokenOnly, isPipelined, sentTime] (const ndn::ConstBufferPtr& bufferPtr) {
+    auto roundTime = ndn::time::steady_clock::now() - sentTime;
+    m_stats.syncRoundTimeUs.record(ndn::time::duration_cast<ndn::time::microseconds>(roundTime).count());
+    if (*isPipelined) {
+      NDN_LOG_TRACE("Segment fetcher got pipelined sync data");
+      m_pipelinedSyncFetcher.reset();
+      onSyncData(bufferPtr, true);
+      return;
+    }
     if (m_syncDataContentType == ndn::tlv::ContentType_Nack) {
+      ++m_stats.nNacks;
       m_syncDataContentType = ndn::tlv::ContentType_Blob;
+      if (isTokenOnly) {
+        // If the producer cannot decode our IBF either, the full filter will be Nacked too
+        NDN_LOG_DEBUG("Received application Nack to subscription token, sending the filter again");
+        m_registeredToken.reset();
+        sendSyncInterest();
+      }
       return;
     }
     NDN_LOG_TRACE("Segment fetcher got sync data");
+    if (token) {
+      m_registeredToken = token;
+    }
     onSyncData(bufferPtr);
   });
 
-  m_syncFetcher->onError.connect([this] (uint32_t errorCode, const std::string& msg) {
+  m_syncFetcher->onError.connect([this, isTokenOnly, isPipelined] (uint32_t errorCode, const std::string& msg) {
+    ++m_stats.nFetchErrors;
+    if (*isPipelined) {
+      // Our IBF already covers this sync data, only hello data can tell what we missed
+      NDN_LOG_DEBUG("Cannot fetch pipelined sync data, error: " << errorCode << " message: " << msg);
+      m_pipelinedSyncFetcher.reset();
+      sendHelloInterest();
+      return;
+    }
     NDN_LOG_TRACE("Cannot fetch sync data, error: " << errorCode << " message: " << msg);
+    if (isTokenOnly) {
+      // The producer may not support tokens, send the full filter next time
+      m_registeredToken.reset();
+    }
     if (errorCode == SegmentFetcher::ErrorCode::INTEREST_TIMEOUT) {
       sendSyncInterest();
     }
     else {
       ndn::time::milliseconds after(m_rangeUniformRandom(m_rng));
       NDN_LOG_TRACE("Scheduling sync Interest after: " << after);
-      m_scheduler.schedule(after, [this] { sendSyncInterest(); });
+      m_syncRetryEvent = m_scheduler.schedule(after, [this] { sendSyncInterest(); });
     }
   });
 }
 
 void
-Consumer::onSyncData(const ndn::ConstBufferPtr& bufferPtr)
+Consumer::onSyncData(const ndn::ConstBufferPtr& bufferPtr, bool isPipelined)
 {
-  // Extract IBF from sync data name which is the last component
-  m_iblt = m_syncDataName.getSubName(m_syncDataName.size() - 1, 1);
+  if (!isPipelined) {
+    // Extract IBF from sync data name which is the last component
+    m_iblt = m_syncDataName.getSubName(m_syncDataName.size() - 1, 1);
+  }
 
   detail::State state{ndn::Block(bufferPtr)};
   std::vector<MissingDataInfo> updates;
+  ++m_stats.nSyncData;
+  m_stats.syncDataSize.record(bufferPtr->size());
 
   for (const auto& content : state) {
     NDN_LOG_DEBUG(content);
     const ndn::Name& prefix = content.getPrefix(-1);
     uint64_t seq = content.get(content.size() - 1).toNumber();
+    // Pipelined sync data may arrive after more recent sync data covering the same prefixes
     if (m_prefixes.find(prefix) == m_prefixes.end() || seq > m_prefixes[prefix]) {
       // If this is just the next seq number then we had already informed the consumer about
       // the previous sequence number and hence seq low and seq high should be equal to current seq
@@ -277,12 +461,15 @@ Consumer::onSyncData(const ndn::ConstBufferPtr& bufferPtr)
   }
 
   NDN_LOG_DEBUG("Sync Data: " << state);
+  m_stats.updatesPerSyncData.record(updates.size());
 
   if (!updates.empty()) {
-    m_onUpdate(updates);
+    m_updateBatcher.add(updates);
   }
 
-  sendSyncInterest();
+  if (!isPipelined) {
+    sendSyncInterest();
+  }
 }
 
 } // namespace psync
@@ -21,8 +21,10 @@
 #define PSYNC_CONSUMER_HPP
 
 #include "PSync/common.hpp"
+#include "PSync/stats.hpp"
 #include "PSync/detail/access-specifiers.hpp"
-#include "PSync/detail/bloom-filter.hpp"
+#include "PSync/detail/subscription-filter.hpp"
+#include "PSync/detail/update-batcher.hpp"
 
 #include <ndn-cxx/face.hpp>
 #include <ndn-cxx/util/random.hpp>
@@ -33,6 +35,8 @@
 
 namespace psync {
 
+class ConsumerGroup;
+
 using ReceiveHelloCallback = std::function<void(const std::map<ndn::Name, uint64_t>&)>;
 
 /**
@@ -72,6 +76,45 @@ public:
     ndn::time::milliseconds helloInterestLifetime = HELLO_INTEREST_LIFETIME;
     /// Lifetime of sync Interest.
     ndn::time::milliseconds syncInterestLifetime = SYNC_INTEREST_LIFETIME;
+    /**
+     * @brief Use a cache-line-blocked Bloom filter.
+     *
+     * Needs two hashes per lookup instead of one per bit, at the cost of a table
+     * rounded up to a multiple of 64 bytes. Requires a producer that understands it.
+     */
+    bool bfBlocked = false;
+    /**
+     * @brief Kind of filter carrying the subscription list in sync Interests.
+     *
+     * bfCount and bfFalsePositive apply to all kinds. Filters other than
+     * SubscriptionFilterType::BLOOM require a producer that understands them.
+     */
+    SubscriptionFilterType subscriptionFilter = SubscriptionFilterType::BLOOM;
+    /**
+     * @brief Send a short token instead of the subscription filter once the producer has it.
+     *
+     * After a sync Interest carrying the full filter has been answered, the following ones
+     * carry only a token derived from the filter, until the subscription list changes.
+     * If the producer no longer knows the token, the full filter is sent again.
+     */
+    bool useSubscriptionToken = false;
+    /**
+     * @brief Send the next sync Interest as soon as the first segment of sync data arrives.
+     *
+     * The producer's new IBF is in the name of every segment, so the next sync Interest
+     * can be pending at the producer while the remaining segments are fetched and the
+     * application processes the updates. Updates received twice are dropped.
+     */
+    bool pipelineSyncInterests = false;
+    /**
+     * @brief How long updates may wait before UpdateCallback is called.
+     *
+     * The updates received meanwhile are merged, one MissingDataInfo per prefix.
+     * Zero calls UpdateCallback for each sync Data.
+     */
+    ndn::time::milliseconds updateBatchInterval = 0_ms;
+    /// Call UpdateCallback before updateBatchInterval once updates of this many prefixes wait; zero for no limit.
+    size_t updateBatchSize = 0;
   };
 
   /**
@@ -104,7 +147,9 @@ public:
   /**
    * @brief send sync interest /<sync-prefix>/sync/\<BF\>/\<producers-IBF\>
    *
-   * Should be called after subscription list is set or updated
+   * Should be called after subscription list is set or updated.
+   * In session mode (Options::useSubscriptionToken), the name is
+   * /<sync-prefix>/sync/\<token\>/\<producers-IBF\> once the producer has the filter.
    */
   void
   sendSyncInterest();
@@ -133,6 +178,30 @@ public:
   bool
   removeSubscription(const ndn::Name& prefix);
 
+  /**
+   * @brief Add several prefixes to subscription list
+   *
+   * Unlike addSubscription, the application is notified with a single UpdateCallback
+   * and, if hello data has already been received, a single sync Interest is sent.
+   *
+   * @param subscriptions prefixes with their latest sequence numbers received in HelloData callback
+   * @param callSyncDataCb see addSubscription
+   * @return number of prefixes added
+   */
+  size_t
+  addSubscriptions(const std::map<ndn::Name, uint64_t>& subscriptions, bool callSyncDataCb = true);
+
+  /**
+   * @brief Remove several prefixes from subscription list
+   *
+   * If hello data has already been received, a single sync Interest is sent afterwards.
+   *
+   * @param prefixes prefixes to be removed from the list
+   * @return number of prefixes removed
+   */
+  size_t
+  removeSubscriptions(const std::vector<ndn::Name>& prefixes);
+
   std::set<ndn::Name>
   getSubscriptionList() const
   {
@@ -155,13 +224,39 @@ public:
     return it->second;
   }
 
+  const UpdateDeliveryStats&
+  getUpdateDeliveryStats() const
+  {
+    return m_updateBatcher.getStats();
+  }
+
+  /**
+   * @brief Returns the counters of this consumer since it was created
+   */
+  const ConsumerStats&
+  getStats() const
+  {
+    return m_stats;
+  }
+
   /**
    * @brief Stop segment fetcher to stop the sync and free resources
+   *
+   * Updates waiting for UpdateCallback are dropped.
    */
   void
   stop();
 
 private:
+  /**
+   * @brief Constructor used by ConsumerGroup
+   *
+   * @param scheduler Scheduler shared with other consumers, or nullptr to use one of our own.
+   */
+  Consumer(ndn::Face& face, ndn::Scheduler* scheduler, const ndn::Name& syncPrefix,
+           const Options& opts);
+
+PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
   /**
    * @brief Get hello data from the producer
    *
@@ -186,13 +281,27 @@ private:
    * Then we send another sync interest after a random jitter.
    *
    * @param bufferPtr sync data content
+   * @param isPipelined the next sync Interest has already been sent
    */
   void
-  onSyncData(const ndn::ConstBufferPtr& bufferPtr);
+  onSyncData(const ndn::ConstBufferPtr& bufferPtr, bool isPipelined = false);
+
+  /**
+   * @brief Insert @p prefix into m_subscriptionFilter, growing the filter if it is full
+   *
+   * @p prefix must already be in m_subscriptionList.
+   */
+  void
+  insertIntoSubscriptionFilter(const ndn::Name& prefix);
 
 PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
   ndn::Face& m_face;
-  ndn::Scheduler m_scheduler;
+  // Null when the scheduler is shared with the other consumers of a ConsumerGroup
+  std::unique_ptr<ndn::Scheduler> m_ownScheduler;
+  ndn::Scheduler& m_scheduler;
+  // Only our own events may be canceled on a shared scheduler
+  ndn::scheduler::ScopedEventId m_helloRetryEvent;
+  ndn::scheduler::ScopedEventId m_syncRetryEvent;
 
   ndn::Name m_syncPrefix;
   ndn::Name m_helloInterestPrefix;
@@ -203,12 +312,25 @@ PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
   uint32_t m_syncDataContentType;
 
   ReceiveHelloCallback m_onReceiveHelloData;
+  // Set by ConsumerGroup, which then retries the hello Interest instead of us
+  std::function<void()> m_onHelloFetchError;
 
   // Called when new sync update is received from producer.
   UpdateCallback m_onUpdate;
+  detail::UpdateBatcher m_updateBatcher;
+
+  // Filter used to send application/user's subscription list.
+  // Supports removal, so that a subscription can be removed without rebuilding it.
+  std::unique_ptr<detail::SubscriptionFilter> m_subscriptionFilter;
+  SubscriptionFilterType m_subscriptionFilterType;
+  uint32_t m_subscriptionFilterCount;
+  double m_subscriptionFilterFalsePositive;
+  bool m_isBloomFilterBlocked;
 
-  // Bloom filter is used to store application/user's subscription list.
-  detail::BloomFilter m_bloomFilter;
+  bool m_useSubscriptionToken;
+  bool m_pipelineSyncInterests;
+  // Token of the filter that the producer is believed to have cached
+  std::optional<ndn::name::Component> m_registeredToken;
 
   ndn::time::milliseconds m_helloInterestLifetime;
   ndn::time::milliseconds m_syncInterestLifetime;
@@ -221,6 +343,12 @@ PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
   std::uniform_int_distribution<> m_rangeUniformRandom;
   std::shared_ptr<ndn::SegmentFetcher> m_helloFetcher;
   std::shared_ptr<ndn::SegmentFetcher> m_syncFetcher;
+  // Fetcher of the remaining segments of sync data, after the next sync Interest was sent
+  std::shared_ptr<ndn::SegmentFetcher> m_pipelinedSyncFetcher;
+
+  ConsumerStats m_stats;
+
+  friend ConsumerGroup;
 };
 
 } // namespace psync
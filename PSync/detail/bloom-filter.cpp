@@ -52,6 +52,10 @@
 #include <cmath>
 #include <cstdlib>
 #include <limits>
+#include <list>
+#include <map>
+#include <mutex>
+#include <stdexcept>
 
 namespace psync::detail {
 
@@ -59,6 +63,13 @@ namespace psync::detail {
 
 static const std::size_t bits_per_char = 0x08;    // 8 bits in 1 char(unsigned)
 
+// A block of a blocked bloom filter spans one 64-byte cache line
+static const std::size_t bits_per_block = 512;
+
+// Seeds of the two hashes used by a blocked bloom filter
+static const uint32_t block_seed = 0xA5A5A5A5;
+static const uint32_t probe_seed = 0x5A5A5A5A;
+
 static const unsigned char bit_mask[bits_per_char] = {
   0x01,  //00000001
   0x02,  //00000010
@@ -187,24 +198,59 @@ public:
 };
 
 
-BloomFilter::BloomFilter(const bloom_parameters& p)
-: projected_element_count_(p.projected_element_count),
-  inserted_element_count_(0),
-  random_seed_((p.random_seed * 0xA5A5A5A5) + 1),
-  desired_false_positive_probability_(p.false_positive_probability)
+class hashing_parameters
 {
-  salt_count_ = p.optimal_parameters.number_of_hashes;
-  table_size_ = p.optimal_parameters.table_size;
-
-  generate_unique_salt();
+public:
+   unsigned int salt_count = 0;
+   unsigned int table_size = 0;
+   std::vector<uint32_t> salt;
+};
 
-  bit_table_.resize(table_size_ / bits_per_char, static_cast<cell_type>(0x00));
-}
+static void
+generate_unique_salt(unsigned int salt_count, unsigned long long int random_seed,
+                     std::vector<uint32_t>& salt);
 
-static bloom_parameters
-makeParameters(unsigned int projected_element_count,
-               double false_positive_probability)
+/**
+ * @brief Compute or look up the hashing parameters of a filter
+ *
+ * Computing the optimal parameters and generating the salts is much more expensive
+ * than parsing a received filter, and consumers use a handful of distinct values.
+ */
+static std::shared_ptr<const hashing_parameters>
+getHashingParameters(unsigned int projected_element_count,
+                     double false_positive_probability)
 {
+  using cache_key = std::pair<unsigned int, double>;
+  struct cache_entry
+  {
+    std::shared_ptr<const hashing_parameters> parameters;
+    // Position in lru
+    std::list<cache_key>::iterator lru_it;
+  };
+
+  // Bounded, so that Interests carrying arbitrary values cannot grow it indefinitely.
+  // The least recently used parameters are evicted, so that values seen once cannot
+  // keep the ones in use out.
+  static constexpr std::size_t max_cached_parameters = 64;
+  static std::mutex mutex;
+  static std::map<cache_key, cache_entry> cache;
+  // Keys from most to least recently used
+  static std::list<cache_key> lru;
+
+  if (std::isnan(false_positive_probability)) {
+    NDN_THROW(BloomFilter::Error("Bloom filter parameters are not correct!"));
+  }
+
+  auto key = std::make_pair(projected_element_count, false_positive_probability);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+      lru.splice(lru.begin(), lru, it->second.lru_it);
+      return it->second.parameters;
+    }
+  }
+
   bloom_parameters p;
   p.projected_element_count = projected_element_count;
   p.false_positive_probability = false_positive_probability;
@@ -212,25 +258,70 @@ makeParameters(unsigned int projected_element_count,
   if (!p.compute_optimal_parameters()) {
     NDN_THROW(BloomFilter::Error("Bloom filter parameters are not correct!"));
   }
-  return p;
+
+  auto parameters = std::make_shared<hashing_parameters>();
+  parameters->salt_count = p.optimal_parameters.number_of_hashes;
+  parameters->table_size = p.optimal_parameters.table_size;
+  generate_unique_salt(parameters->salt_count, (p.random_seed * 0xA5A5A5A5) + 1, parameters->salt);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  // Another thread may have computed the same parameters meanwhile
+  auto it = cache.find(key);
+  if (it != cache.end()) {
+    lru.splice(lru.begin(), lru, it->second.lru_it);
+    return it->second.parameters;
+  }
+  if (cache.size() >= max_cached_parameters) {
+    cache.erase(lru.back());
+    lru.pop_back();
+  }
+  lru.push_front(key);
+  cache.emplace(key, cache_entry{parameters, lru.begin()});
+  return parameters;
+}
+
+BloomFilter::BloomFilter(std::shared_ptr<const hashing_parameters> parameters, Layout layout)
+: parameters_(std::move(parameters)),
+  salt_count_(parameters_->salt_count),
+  table_size_(parameters_->table_size),
+  layout_(layout)
+{
+  if (layout_ == Layout::BLOCKED) {
+    table_size_ += (((table_size_ % bits_per_block) != 0) ? (bits_per_block - (table_size_ % bits_per_block)) : 0);
+  }
 }
 
 BloomFilter::BloomFilter(unsigned int projected_element_count,
-                         double false_positive_probability)
-  : BloomFilter(makeParameters(projected_element_count, false_positive_probability))
+                         double false_positive_probability,
+                         Layout layout)
+  : BloomFilter(getHashingParameters(projected_element_count, false_positive_probability), layout)
 {
+  projected_element_count_ = projected_element_count;
+  desired_false_positive_probability_ = false_positive_probability;
+  bit_table_.resize(table_size_ / bits_per_char, static_cast<cell_type>(0x00));
 }
 
 BloomFilter::BloomFilter(unsigned int projected_element_count,
                          double false_positive_probability,
                          const ndn::name::Component& bfName)
-  : BloomFilter(projected_element_count, false_positive_probability)
+  : BloomFilter(getHashingParameters(projected_element_count, false_positive_probability),
+                bfName.type() == tlv::BlockedBloomFilterComponent ? Layout::BLOCKED : Layout::CLASSIC)
 {
-  std::vector<cell_type> table(bfName.value_begin(), bfName.value_end());
-  if (table.size() != table_size_ / bits_per_char) {
+  if (bfName.value_size() != table_size_ / bits_per_char) {
     NDN_THROW(Error("Bloom filter cannot be decoded!"));
   }
-  bit_table_ = std::move(table);
+  projected_element_count_ = projected_element_count;
+  desired_false_positive_probability_ = false_positive_probability;
+  bit_table_view_ = bfName;
+}
+
+void
+BloomFilter::make_writable()
+{
+  if (bit_table_view_.isValid()) {
+    bit_table_.assign(bit_table_view_.value_begin(), bit_table_view_.value_end());
+    bit_table_view_ = ndn::Block();
+  }
 }
 
 void
@@ -238,25 +329,51 @@ BloomFilter::appendToName(ndn::Name& name) const
 {
   name.appendNumber(projected_element_count_);
   name.appendNumber(static_cast<uint64_t>(desired_false_positive_probability_ * 1000));
-  name.append(bit_table_.begin(), bit_table_.end());
+  auto table = bit_table();
+  if (layout_ == Layout::BLOCKED) {
+    name.append(ndn::name::Component(tlv::BlockedBloomFilterComponent, table));
+  }
+  else {
+    name.append(table.begin(), table.end());
+  }
 }
 
 void
 BloomFilter::clear()
 {
-  std::fill(bit_table_.begin(), bit_table_.end(), static_cast<cell_type>(0x00));
+  bit_table_view_ = ndn::Block();
+  bit_table_.assign(table_size_ / bits_per_char, static_cast<cell_type>(0x00));
   inserted_element_count_ = 0;
 }
 
 void
 BloomFilter::insert(const ndn::Name& key)
 {
+  make_writable();
+
+  if (layout_ == Layout::BLOCKED)
+  {
+    bloom_type probe = 0;
+    bloom_type step  = 0;
+    const std::size_t block = compute_block(key, probe, step);
+
+    for (std::size_t i = 0; i < salt_count_; ++i, probe += step)
+    {
+      const std::size_t bit_index = block + (probe & (bits_per_block - 1));
+      bit_table_[bit_index / bits_per_char] |= bit_mask[bit_index % bits_per_char];
+    }
+
+    ++inserted_element_count_;
+    return;
+  }
+
   std::size_t bit_index = 0;
   std::size_t bit       = 0;
+  const auto hashes = compute_hashes(key);
 
-  for (std::size_t i = 0; i < salt_.size(); ++i)
+  for (std::size_t i = 0; i < salt_count_; ++i)
   {
-    compute_indices(murmurHash3(salt_[i], key), bit_index, bit);
+    compute_indices(hashes[i], bit_index, bit);
 
     bit_table_[bit_index / bits_per_char] |= bit_mask[bit];
   }
@@ -267,22 +384,125 @@ BloomFilter::insert(const ndn::Name& key)
 bool
 BloomFilter::contains(const ndn::Name& key) const
 {
+  auto table = bit_table();
+
+  if (layout_ == Layout::BLOCKED)
+  {
+    bloom_type probe = 0;
+    bloom_type step  = 0;
+    const std::size_t block = compute_block(key, probe, step);
+
+    for (std::size_t i = 0; i < salt_count_; ++i, probe += step)
+    {
+      const std::size_t bit_index = block + (probe & (bits_per_block - 1));
+      if ((table[bit_index / bits_per_char] & bit_mask[bit_index % bits_per_char]) == 0)
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
   std::size_t bit_index = 0;
   std::size_t bit       = 0;
+  // One batch of lanes at a time, so that a miss, which mostly ends on the first
+  // salts, does not pay for the hashes of all of them
+  const ndn::span<const uint32_t> salt(parameters_->salt);
+  uint32_t hashes[MURMUR_HASH3_LANES];
 
-  for (std::size_t i = 0; i < salt_.size(); ++i)
+  for (std::size_t first = 0; first < salt_count_; first += MURMUR_HASH3_LANES)
   {
-    compute_indices(murmurHash3(salt_[i], key), bit_index, bit);
+    const std::size_t count = std::min(MURMUR_HASH3_LANES, salt_count_ - first);
+    murmurHash3xN(key, salt.subspan(first, count), hashes);
 
-    if ((bit_table_[bit_index / bits_per_char] & bit_mask[bit]) != bit_mask[bit])
+    for (std::size_t i = 0; i < count; ++i)
     {
-      return false;
+      compute_indices(hashes[i], bit_index, bit);
+
+      if ((table[bit_index / bits_per_char] & bit_mask[bit]) != bit_mask[bit])
+      {
+        return false;
+      }
     }
   }
 
   return true;
 }
 
+std::vector<uint32_t>
+BloomFilter::getBitPositions(const ndn::Name& key) const
+{
+  std::vector<uint32_t> positions;
+  positions.reserve(salt_count_);
+
+  if (layout_ == Layout::BLOCKED)
+  {
+    bloom_type probe = 0;
+    bloom_type step  = 0;
+    const std::size_t block = compute_block(key, probe, step);
+
+    for (std::size_t i = 0; i < salt_count_; ++i, probe += step)
+    {
+      positions.push_back(static_cast<uint32_t>(block + (probe & (bits_per_block - 1))));
+    }
+
+    return positions;
+  }
+
+  std::size_t bit_index = 0;
+  std::size_t bit       = 0;
+  const auto hashes = compute_hashes(key);
+
+  for (std::size_t i = 0; i < salt_count_; ++i)
+  {
+    compute_indices(hashes[i], bit_index, bit);
+    positions.push_back(static_cast<uint32_t>(bit_index));
+  }
+
+  return positions;
+}
+
+bool
+BloomFilter::containsBits(const std::vector<uint32_t>& positions) const
+{
+  auto table = bit_table();
+  return std::all_of(positions.begin(), positions.end(), [this, table] (uint32_t pos) {
+    return pos < table_size_ &&
+           (table[pos / bits_per_char] & bit_mask[pos % bits_per_char]) != 0;
+  });
+}
+
+std::vector<uint32_t>
+BloomFilter::getSetBits() const
+{
+  auto table = bit_table();
+  std::vector<uint32_t> positions;
+  for (std::size_t i = 0; i < table.size(); ++i)
+  {
+    for (std::size_t bit = 0; bit < bits_per_char; ++bit)
+    {
+      if (table[i] & bit_mask[bit])
+        positions.push_back(static_cast<uint32_t>(i * bits_per_char + bit));
+    }
+  }
+  return positions;
+}
+
+void
+BloomFilter::setBit(uint32_t position, bool value)
+{
+  if (position >= table_size_) {
+    NDN_THROW(std::out_of_range("Bit position is outside the table"));
+  }
+
+  make_writable();
+  if (value)
+    bit_table_[position / bits_per_char] |= bit_mask[position % bits_per_char];
+  else
+    bit_table_[position / bits_per_char] &= static_cast<cell_type>(~bit_mask[position % bits_per_char]);
+}
+
 void
 BloomFilter::compute_indices(const bloom_type& hash, std::size_t& bit_index, std::size_t& bit) const
 {
@@ -290,8 +510,75 @@ BloomFilter::compute_indices(const bloom_type& hash, std::size_t& bit_index, std
   bit       = bit_index % bits_per_char;
 }
 
+BloomFilter::Hashes
+BloomFilter::compute_hashes(const ndn::Name& key) const
+{
+  Hashes hashes(salt_count_);
+  murmurHash3xN(key, parameters_->salt, hashes);
+  return hashes;
+}
+
+std::size_t
+BloomFilter::compute_block(const ndn::Name& key, bloom_type& probe, bloom_type& step) const
+{
+  const uint32_t seeds[] = {block_seed, probe_seed};
+  uint32_t hashes[2];
+  murmurHash3xN(key, seeds, hashes);
+  const bloom_type block_hash = hashes[0];
+  probe = hashes[1];
+  // An odd step visits distinct bits of the block for up to bits_per_block probes
+  step = ((probe >> 16) | (probe << 16)) | 1;
+
+  return (block_hash % (table_size_ / bits_per_block)) * bits_per_block;
+}
+
+CountingBloomFilter::CountingBloomFilter(unsigned int projected_element_count,
+                                         double false_positive_probability,
+                                         BloomFilter::Layout layout)
+  : m_bf(projected_element_count, false_positive_probability, layout)
+{
+}
+
+CountingBloomFilter::CountingBloomFilter(BloomFilter bf)
+  : m_bf(std::move(bf))
+{
+}
+
 void
-BloomFilter::generate_unique_salt()
+CountingBloomFilter::clear()
+{
+  m_bf.clear();
+  m_counters.clear();
+}
+
+void
+CountingBloomFilter::insert(const ndn::Name& key)
+{
+  for (auto pos : m_bf.getBitPositions(key)) {
+    if (m_counters[pos]++ == 0) {
+      m_bf.setBit(pos, true);
+    }
+  }
+}
+
+void
+CountingBloomFilter::erase(const ndn::Name& key)
+{
+  for (auto pos : m_bf.getBitPositions(key)) {
+    auto it = m_counters.find(pos);
+    if (it == m_counters.end()) {
+      continue;
+    }
+    if (--it->second == 0) {
+      m_counters.erase(it);
+      m_bf.setBit(pos, false);
+    }
+  }
+}
+
+static void
+generate_unique_salt(unsigned int salt_count, unsigned long long int random_seed,
+                     std::vector<uint32_t>& salt)
 {
   /*
     Note:
@@ -301,7 +588,7 @@ BloomFilter::generate_unique_salt()
   */
   const unsigned int predef_salt_count = 128;
 
-  static const bloom_type predef_salt[predef_salt_count] =
+  static const uint32_t predef_salt[predef_salt_count] =
                              {
                                 0xAAAAAAAA, 0x55555555, 0x33333333, 0xCCCCCCCC,
                                 0x66666666, 0x99999999, 0xB5B5B5B5, 0x4B4B4B4B,
@@ -337,13 +624,13 @@ BloomFilter::generate_unique_salt()
                                 0xC569F575, 0xCDB2A091, 0x2CC016B4, 0x5C5F4421
                              };
 
-  if (salt_count_ <= predef_salt_count)
+  if (salt_count <= predef_salt_count)
   {
     std::copy(predef_salt,
-              predef_salt + salt_count_,
-              std::back_inserter(salt_));
+              predef_salt + salt_count,
+              std::back_inserter(salt));
 
-    for (std::size_t i = 0; i < salt_.size(); ++i)
+    for (std::size_t i = 0; i < salt.size(); ++i)
     {
       /*
          Note:
@@ -351,25 +638,25 @@ BloomFilter::generate_unique_salt()
          so as to allow for the generation of unique bloom filter
          instances.
       */
-      salt_[i] = salt_[i] * salt_[(i + 3) % salt_.size()] + static_cast<bloom_type>(random_seed_);
+      salt[i] = salt[i] * salt[(i + 3) % salt.size()] + static_cast<uint32_t>(random_seed);
     }
   }
   else
   {
-    std::copy(predef_salt, predef_salt + predef_salt_count, std::back_inserter(salt_));
+    std::copy(predef_salt, predef_salt + predef_salt_count, std::back_inserter(salt));
 
-    srand(static_cast<unsigned int>(random_seed_));
+    srand(static_cast<unsigned int>(random_seed));
 
-    while (salt_.size() < salt_count_)
+    while (salt.size() < salt_count)
     {
-      bloom_type current_salt = static_cast<bloom_type>(rand()) * static_cast<bloom_type>(rand());
+      uint32_t current_salt = static_cast<uint32_t>(rand()) * static_cast<uint32_t>(rand());
 
       if (0 == current_salt)
         continue;
 
-      if (salt_.end() == std::find(salt_.begin(), salt_.end(), current_salt))
+      if (salt.end() == std::find(salt.begin(), salt.end(), current_salt))
       {
-        salt_.push_back(current_salt);
+        salt.push_back(current_salt);
       }
     }
   }
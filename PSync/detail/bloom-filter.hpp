@@ -46,15 +46,23 @@
 #ifndef PSYNC_DETAIL_BLOOM_FILTER_HPP
 #define PSYNC_DETAIL_BLOOM_FILTER_HPP
 
+#include "PSync/detail/access-specifiers.hpp"
+#include "PSync/detail/subscription-filter.hpp"
+
 #include <ndn-cxx/name.hpp>
 #include <ndn-cxx/util/string-helper.hpp>
 
+#include <boost/container/small_vector.hpp>
+
+#include <algorithm>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace psync::detail {
 
-class bloom_parameters;
+class hashing_parameters;
 
 class BloomFilter
 {
@@ -65,11 +73,29 @@ public:
     using std::runtime_error::runtime_error;
   };
 
+  /**
+   * @brief Arrangement of the bits in the table
+   */
+  enum class Layout {
+    /// Each of the k hashes selects a bit anywhere in the table
+    CLASSIC,
+    /// One hash selects a 64-byte block, all k bits are set inside it from a second hash
+    BLOCKED,
+  };
+
   BloomFilter() = default;
 
   BloomFilter(unsigned int projected_element_count,
-              double false_positive_probability);
+              double false_positive_probability,
+              Layout layout = Layout::CLASSIC);
 
+  /**
+   * @brief Construct a copy of a bloom filter appended to a name by appendToName
+   *
+   * The layout is determined by the type of @p bfName.
+   * The filter is a view over the bytes of @p bfName and does not copy them
+   * unless it is modified.
+   */
   BloomFilter(unsigned int projected_element_count,
               double false_positive_probability,
               const ndn::name::Component& bfName);
@@ -79,12 +105,20 @@ public:
    *
    * Append the count and false positive probability
    * along with the bloom filter so that producer (PartialProducer) can construct a copy.
+   * The bit table of a blocked filter is appended as a component of TLV-TYPE
+   * tlv::BlockedBloomFilterComponent, and that of a classic filter as a GenericNameComponent.
    *
    * @param name append bloom filter to this name
    */
   void
   appendToName(ndn::Name& name) const;
 
+  Layout
+  getLayout() const
+  {
+    return layout_;
+  }
+
   void
   clear();
 
@@ -94,18 +128,75 @@ public:
   bool
   contains(const ndn::Name& key) const;
 
+  /**
+   * @brief Compute the positions of the bits that @p key maps to
+   *
+   * Filters constructed with the same count and false positive probability
+   * map a key to the same positions, so the result can be reused across them.
+   */
+  std::vector<uint32_t>
+  getBitPositions(const ndn::Name& key) const;
+
+  /**
+   * @brief Check whether the bits at all of @p positions are set
+   */
+  bool
+  containsBits(const std::vector<uint32_t>& positions) const;
+
+  /**
+   * @brief Returns the positions of all the set bits
+   */
+  std::vector<uint32_t>
+  getSetBits() const;
+
+  /**
+   * @brief Set or clear the bit at @p position, as returned by getBitPositions
+   */
+  void
+  setBit(uint32_t position, bool value);
+
 private:
   typedef uint32_t bloom_type;
+  // One hash per salt, on the stack for usual salt counts
+  typedef boost::container::small_vector<bloom_type, 16> Hashes;
   typedef uint8_t cell_type;
 
-  explicit
-  BloomFilter(const bloom_parameters& p);
+  BloomFilter(std::shared_ptr<const hashing_parameters> parameters, Layout layout);
+
+  ndn::span<const cell_type>
+  bit_table() const
+  {
+    if (bit_table_view_.isValid()) {
+      return {bit_table_view_.value(), bit_table_view_.value_size()};
+    }
+    return bit_table_;
+  }
 
+  /**
+   * @brief Copy the viewed bytes into our own table before modifying it
+   */
   void
-  compute_indices(const bloom_type& hash, std::size_t& bit_index, std::size_t& bit) const;
+  make_writable();
+
+  /**
+   * @brief Hash @p key with each salt, together
+   */
+  Hashes
+  compute_hashes(const ndn::Name& key) const;
 
   void
-  generate_unique_salt();
+  compute_indices(const bloom_type& hash, std::size_t& bit_index, std::size_t& bit) const;
+
+  /**
+   * @brief Select the block of @p key in a blocked filter
+   *
+   * @param key the key
+   * @param[out] probe hash from which the bits inside the block are derived
+   * @param[out] step odd increment between successive bits inside the block
+   * @return index of the first bit of the block
+   */
+  std::size_t
+  compute_block(const ndn::Name& key, bloom_type& probe, bloom_type& step) const;
 
 private: // non-member operators
   // NOTE: the following "hidden friend" operators are available via
@@ -114,31 +205,103 @@ private: // non-member operators
   friend bool
   operator==(const BloomFilter& lhs, const BloomFilter& rhs)
   {
-    return lhs.bit_table_ == rhs.bit_table_;
+    auto lt = lhs.bit_table();
+    auto rt = rhs.bit_table();
+    return std::equal(lt.begin(), lt.end(), rt.begin(), rt.end());
   }
 
   friend bool
   operator!=(const BloomFilter& lhs, const BloomFilter& rhs)
   {
-    return lhs.bit_table_ != rhs.bit_table_;
+    return !(lhs == rhs);
   }
 
   friend std::ostream&
   operator<<(std::ostream& os, const BloomFilter& bf)
   {
-    ndn::printHex(os, bf.bit_table_, false);
+    ndn::printHex(os, bf.bit_table(), false);
     return os;
   }
 
-private:
-  std::vector<bloom_type> salt_;
+PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
+  // Salts and table size, shared by all filters with the same count and probability
+  std::shared_ptr<const hashing_parameters> parameters_;
   std::vector<cell_type>  bit_table_;
+  // Name component holding the bit table when this filter is a view
+  ndn::Block              bit_table_view_;
   unsigned int            salt_count_ = 0;
   unsigned int            table_size_ = 0;
   unsigned int            projected_element_count_ = 0;
   unsigned int            inserted_element_count_ = 0;
-  unsigned long long int  random_seed_ = 0;
   double                  desired_false_positive_probability_ = 0.0;
+  Layout                  layout_ = Layout::CLASSIC;
+};
+
+/**
+ * @brief Bloom filter that supports removal of keys
+ *
+ * Keeps a reference count for each set bit next to a regular BloomFilter,
+ * whose bit table is the one appended to names.
+ */
+class CountingBloomFilter : public SubscriptionFilter
+{
+public:
+  CountingBloomFilter() = default;
+
+  CountingBloomFilter(unsigned int projected_element_count,
+                      double false_positive_probability,
+                      BloomFilter::Layout layout = BloomFilter::Layout::CLASSIC);
+
+  /**
+   * @brief Wrap a filter whose keys are unknown, such as one decoded from a name
+   *
+   * Erasing keys from such a filter has no effect.
+   */
+  explicit
+  CountingBloomFilter(BloomFilter bf);
+
+  void
+  appendToName(ndn::Name& name) const final
+  {
+    m_bf.appendToName(name);
+  }
+
+  void
+  clear() final;
+
+  void
+  insert(const ndn::Name& key) final;
+
+  /**
+   * @brief Remove a previously inserted key
+   *
+   * Removing a key that was not inserted leaves other keys' bits cleared.
+   */
+  void
+  erase(const ndn::Name& key) final;
+
+  bool
+  contains(const ndn::Name& key) const final
+  {
+    return m_bf.contains(key);
+  }
+
+  const BloomFilter*
+  asBloomFilter() const final
+  {
+    return &m_bf;
+  }
+
+  const BloomFilter&
+  getBloomFilter() const
+  {
+    return m_bf;
+  }
+
+private:
+  BloomFilter m_bf;
+  // bit position => number of inserted keys that map to it
+  std::unordered_map<uint32_t, uint32_t> m_counters;
 };
 
 } // namespace psync::detail
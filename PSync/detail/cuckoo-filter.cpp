@@ -0,0 +1,182 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/detail/cuckoo-filter.hpp"
+#include "PSync/detail/util.hpp"
+
+#include <ndn-cxx/util/exception.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace psync::detail {
+
+static constexpr size_t SLOTS_PER_BUCKET = 4;
+// Insertions start failing well before every slot is taken
+static constexpr double MAX_LOAD_FACTOR = 0.9;
+static constexpr unsigned int MAX_KICKS = 500;
+
+static constexpr uint32_t BUCKET_SEED = 0x2C9277B5;
+static constexpr uint32_t FINGERPRINT_SEED = 0x8F1BBCDC;
+static constexpr uint32_t ALT_BUCKET_SEED = 0x6ED9EBA1;
+
+static unsigned int
+computeFingerprintSize(uint64_t falsePositive1000)
+{
+  if (falsePositive1000 == 0) {
+    return 16;
+  }
+  // A lookup compares the fingerprint against the slots of two buckets
+  auto size = std::ceil(std::log2(2.0 * SLOTS_PER_BUCKET * 1000 / falsePositive1000));
+  return std::clamp(static_cast<unsigned int>(size), 4U, 16U);
+}
+
+static size_t
+computeNumBuckets(unsigned int count)
+{
+  auto nBuckets = static_cast<size_t>(std::ceil(count / (SLOTS_PER_BUCKET * MAX_LOAD_FACTOR)));
+  return std::max<size_t>(nBuckets, 1);
+}
+
+CuckooFilter::CuckooFilter(unsigned int count, double falsePositive)
+  : m_count(count)
+  , m_falsePositive1000(encodeFalsePositive(falsePositive))
+  , m_nBuckets(computeNumBuckets(count))
+  , m_fingerprintSize(computeFingerprintSize(m_falsePositive1000))
+  , m_slots(m_nBuckets * SLOTS_PER_BUCKET, 0)
+{
+}
+
+CuckooFilter::CuckooFilter(unsigned int count, double falsePositive,
+                           const ndn::name::Component& component)
+  : m_count(count)
+  , m_falsePositive1000(encodeFalsePositive(falsePositive))
+  , m_nBuckets(computeNumBuckets(count))
+  , m_fingerprintSize(computeFingerprintSize(m_falsePositive1000))
+{
+  // Checked before allocating, the count comes from the network
+  if (component.type() != tlv::CuckooFilterComponent ||
+      component.value_size() != getPackedSize(m_nBuckets * SLOTS_PER_BUCKET, m_fingerprintSize)) {
+    NDN_THROW(Error("Cuckoo filter cannot be decoded!"));
+  }
+  m_slots = unpackBits({component.value(), component.value_size()},
+                       m_nBuckets * SLOTS_PER_BUCKET, m_fingerprintSize);
+}
+
+void
+CuckooFilter::appendToName(ndn::Name& name) const
+{
+  name.appendNumber(m_count);
+  name.appendNumber(m_falsePositive1000);
+  name.append(ndn::name::Component(tlv::CuckooFilterComponent, packBits(m_slots, m_fingerprintSize)));
+}
+
+void
+CuckooFilter::insert(const ndn::Name& key)
+{
+  uint16_t fingerprint = computeFingerprint(key);
+  size_t bucket = murmurHash3(BUCKET_SEED, key) % m_nBuckets;
+
+  for (size_t b : {bucket, getAltBucket(bucket, fingerprint)}) {
+    if (auto slot = findSlot(b, 0); slot) {
+      m_slots[*slot] = fingerprint;
+      return;
+    }
+  }
+
+  // Both buckets are full, relocate fingerprints to their alternate buckets.
+  // The replaced values are kept to restore the table if no free slot is found.
+  std::vector<std::pair<size_t, uint16_t>> evicted;
+  for (unsigned int i = 0; i < MAX_KICKS; ++i) {
+    size_t victim = bucket * SLOTS_PER_BUCKET + i % SLOTS_PER_BUCKET;
+    evicted.emplace_back(victim, m_slots[victim]);
+    std::swap(fingerprint, m_slots[victim]);
+
+    bucket = getAltBucket(bucket, fingerprint);
+    if (auto slot = findSlot(bucket, 0); slot) {
+      m_slots[*slot] = fingerprint;
+      return;
+    }
+  }
+
+  for (auto it = evicted.rbegin(); it != evicted.rend(); ++it) {
+    m_slots[it->first] = it->second;
+  }
+  NDN_THROW(Error("Cuckoo filter is full"));
+}
+
+void
+CuckooFilter::erase(const ndn::Name& key)
+{
+  uint16_t fingerprint = computeFingerprint(key);
+  size_t bucket = murmurHash3(BUCKET_SEED, key) % m_nBuckets;
+
+  for (size_t b : {bucket, getAltBucket(bucket, fingerprint)}) {
+    if (auto slot = findSlot(b, fingerprint); slot) {
+      m_slots[*slot] = 0;
+      return;
+    }
+  }
+}
+
+void
+CuckooFilter::clear()
+{
+  std::fill(m_slots.begin(), m_slots.end(), 0);
+}
+
+bool
+CuckooFilter::contains(const ndn::Name& key) const
+{
+  uint16_t fingerprint = computeFingerprint(key);
+  size_t bucket = murmurHash3(BUCKET_SEED, key) % m_nBuckets;
+
+  return findSlot(bucket, fingerprint) || findSlot(getAltBucket(bucket, fingerprint), fingerprint);
+}
+
+uint16_t
+CuckooFilter::computeFingerprint(const ndn::Name& key) const
+{
+  auto fingerprint = static_cast<uint16_t>(murmurHash3(FINGERPRINT_SEED, key) &
+                                           ((1U << m_fingerprintSize) - 1));
+  // Zero marks an empty slot
+  return fingerprint == 0 ? 1 : fingerprint;
+}
+
+size_t
+CuckooFilter::getAltBucket(size_t bucket, uint16_t fingerprint) const
+{
+  // (h - bucket) mod n is its own inverse, which unlike the usual xor
+  // does not require the number of buckets to be a power of two
+  size_t h = murmurHash3(ALT_BUCKET_SEED, static_cast<uint32_t>(fingerprint)) % m_nBuckets;
+  return (h + m_nBuckets - bucket) % m_nBuckets;
+}
+
+std::optional<size_t>
+CuckooFilter::findSlot(size_t bucket, uint16_t fingerprint) const
+{
+  for (size_t slot = bucket * SLOTS_PER_BUCKET; slot < (bucket + 1) * SLOTS_PER_BUCKET; ++slot) {
+    if (m_slots[slot] == fingerprint) {
+      return slot;
+    }
+  }
+  return std::nullopt;
+}
+
+} // namespace psync::detail
@@ -0,0 +1,105 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PSYNC_DETAIL_CUCKOO_FILTER_HPP
+#define PSYNC_DETAIL_CUCKOO_FILTER_HPP
+
+#include "PSync/detail/subscription-filter.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace psync::detail {
+
+/**
+ * @brief Cuckoo filter with four fingerprints per bucket
+ *
+ * Each key has a fingerprint that can be stored in one of two buckets. The second
+ * bucket is derived from the first and the fingerprint alone, so that fingerprints
+ * can be relocated without knowing their keys.
+ *
+ * Based on B. Fan et al., "Cuckoo Filter: Practically Better Than Bloom", CoNEXT 2014.
+ */
+class CuckooFilter : public SubscriptionFilter
+{
+public:
+  CuckooFilter(unsigned int count, double falsePositive);
+
+  /**
+   * @brief Construct a copy of a cuckoo filter appended to a name by appendToName
+   */
+  CuckooFilter(unsigned int count, double falsePositive, const ndn::name::Component& component);
+
+  /**
+   * @brief Append the count, the false positive probability, and the fingerprint table
+   *
+   * The table is appended as a name component of type tlv::CuckooFilterComponent.
+   */
+  void
+  appendToName(ndn::Name& name) const final;
+
+  void
+  insert(const ndn::Name& key) final;
+
+  void
+  erase(const ndn::Name& key) final;
+
+  void
+  clear() final;
+
+  bool
+  contains(const ndn::Name& key) const final;
+
+  size_t
+  getNumBuckets() const
+  {
+    return m_nBuckets;
+  }
+
+  unsigned int
+  getFingerprintSize() const
+  {
+    return m_fingerprintSize;
+  }
+
+private:
+  uint16_t
+  computeFingerprint(const ndn::Name& key) const;
+
+  size_t
+  getAltBucket(size_t bucket, uint16_t fingerprint) const;
+
+  /**
+   * @brief Returns the index in m_slots of a slot of @p bucket holding @p fingerprint
+   */
+  std::optional<size_t>
+  findSlot(size_t bucket, uint16_t fingerprint) const;
+
+private:
+  unsigned int m_count;
+  uint64_t m_falsePositive1000;
+  size_t m_nBuckets;
+  unsigned int m_fingerprintSize;
+  // m_nBuckets * SLOTS_PER_BUCKET fingerprints, zero marks an empty slot
+  std::vector<uint16_t> m_slots;
+};
+
+} // namespace psync::detail
+
+#endif // PSYNC_DETAIL_CUCKOO_FILTER_HPP
@@ -0,0 +1,295 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2024,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+
+ * This file incorporates work covered by the following copyright and
+ * permission notice:
+
+ * The MIT License (MIT)
+
+ * Copyright (c) 2014 Gavin Andresen
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#ifndef PSYNC_DETAIL_IBLT_IMPL_HPP
+#define PSYNC_DETAIL_IBLT_IMPL_HPP
+
+#include "PSync/detail/iblt.hpp"
+#include "PSync/detail/util.hpp"
+
+#include <ndn-cxx/util/exception.hpp>
+
+#include <boost/endian/conversion.hpp>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace psync::detail {
+
+template<typename KeyT>
+inline constexpr size_t ENTRY_SIZE = sizeof(BasicHashTableEntry<KeyT>::count) +
+                                     sizeof(BasicHashTableEntry<KeyT>::keySum) +
+                                     sizeof(BasicHashTableEntry<KeyT>::keyCheck);
+
+template<typename KeyT>
+inline uint32_t
+checkHash(KeyT key)
+{
+  return murmurHash3(&key, sizeof(key), N_HASHCHECK);
+}
+
+template<typename KeyT>
+bool
+BasicHashTableEntry<KeyT>::isPure() const
+{
+  if (count == 1 || count == -1) {
+    uint32_t check = checkHash(keySum);
+    return keyCheck == check;
+  }
+
+  return false;
+}
+
+template<typename KeyT>
+bool
+BasicHashTableEntry<KeyT>::isEmpty() const
+{
+  return count == 0 && keySum == 0 && keyCheck == 0;
+}
+
+// Reciprocal of @p d for fastModulo(), see Lemire et al., "Faster Remainder by Direct
+// Computation", https://arxiv.org/abs/1902.01961
+inline uint64_t
+computeReciprocal(uint32_t d)
+{
+  return d == 0 ? 0 : std::numeric_limits<uint64_t>::max() / d + 1;
+}
+
+// h % d, with a multiplication instead of a division when 128-bit integers are available
+inline uint32_t
+fastModulo(uint32_t h, uint32_t d, [[maybe_unused]] uint64_t reciprocal)
+{
+#ifdef __SIZEOF_INT128__
+  uint64_t lowBits = reciprocal * h;
+  return static_cast<uint32_t>((static_cast<unsigned __int128>(lowBits) * d) >> 64);
+#else
+  return h % d;
+#endif
+}
+
+template<typename KeyT, size_t NHash>
+BasicIBLT<KeyT, NHash>::BasicIBLT(size_t expectedNumEntries, CompressionScheme scheme)
+  : m_compressionScheme(scheme)
+{
+  // An empty table has no bucket to put the keys in
+  if (expectedNumEntries == 0) {
+    NDN_THROW(Error("IBLT must have at least one entry"));
+  }
+
+  // 1.5x expectedNumEntries gives very low probability of decoding failure
+  size_t nEntries = expectedNumEntries + expectedNumEntries / 2;
+  // make nEntries exactly divisible by NHash
+  size_t remainder = nEntries % NHash;
+  if (remainder != 0) {
+    nEntries += (NHash - remainder);
+  }
+
+  m_hashTable.resize(nEntries);
+  BOOST_ASSERT(nEntries / NHash <= std::numeric_limits<uint32_t>::max());
+  m_bucketsPerHash = static_cast<uint32_t>(nEntries / NHash);
+  m_bucketsPerHashReciprocal = computeReciprocal(m_bucketsPerHash);
+}
+
+template<typename KeyT, size_t NHash>
+void
+BasicIBLT<KeyT, NHash>::initialize(const ndn::name::Component& ibltName)
+{
+  auto decompressed = decompress(m_compressionScheme, ibltName.value_bytes());
+  if (decompressed->size() != ENTRY_SIZE<KeyT> * m_hashTable.size()) {
+    NDN_THROW(Error("Received IBF cannot be decoded!"));
+  }
+
+  const uint8_t* input = decompressed->data();
+  for (auto& entry : m_hashTable) {
+    entry.count = boost::endian::endian_load<int32_t, sizeof(int32_t), boost::endian::order::big>(input);
+    input += sizeof(entry.count);
+
+    entry.keySum = boost::endian::endian_load<KeyT, sizeof(KeyT), boost::endian::order::big>(input);
+    input += sizeof(entry.keySum);
+
+    entry.keyCheck = boost::endian::endian_load<uint32_t, sizeof(uint32_t), boost::endian::order::big>(input);
+    input += sizeof(entry.keyCheck);
+  }
+}
+
+// Seeds of the NHash bucket hashes, then of the check hash
+template<size_t NHash>
+constexpr std::array<uint32_t, NHash + 1>
+makeUpdateSeeds()
+{
+  std::array<uint32_t, NHash + 1> seeds{};
+  for (size_t i = 0; i < NHash; i++) {
+    seeds[i] = i;
+  }
+  seeds[NHash] = N_HASHCHECK;
+  return seeds;
+}
+
+template<size_t NHash, typename Table, typename KeyT>
+inline void
+ibltUpdate(Table& ht, uint32_t bucketsPerHash, uint64_t reciprocal, int32_t plusOrMinus, KeyT key)
+{
+  static constexpr auto seeds = makeUpdateSeeds<NHash>();
+  std::array<uint32_t, seeds.size()> hashes;
+  murmurHash3xN(&key, sizeof(key), seeds, hashes);
+  uint32_t check = hashes[NHash];
+
+  // NHash is a constant, so the compiler can unroll this loop
+  for (size_t i = 0; i < NHash; i++) {
+    size_t startEntry = i * bucketsPerHash;
+    auto& entry = ht[startEntry + fastModulo(hashes[i], bucketsPerHash, reciprocal)];
+    entry.count += plusOrMinus;
+    entry.keySum ^= key;
+    entry.keyCheck ^= check;
+  }
+}
+
+template<typename KeyT, size_t NHash>
+void
+BasicIBLT<KeyT, NHash>::insert(KeyT key)
+{
+  ibltUpdate<NHash>(m_hashTable, m_bucketsPerHash, m_bucketsPerHashReciprocal, 1, key);
+}
+
+template<typename KeyT, size_t NHash>
+void
+BasicIBLT<KeyT, NHash>::erase(KeyT key)
+{
+  ibltUpdate<NHash>(m_hashTable, m_bucketsPerHash, m_bucketsPerHashReciprocal, -1, key);
+}
+
+template<typename KeyT, size_t NHash>
+void
+BasicIBLT<KeyT, NHash>::appendToName(ndn::Name& name) const
+{
+  std::vector<uint8_t> buffer(ENTRY_SIZE<KeyT> * m_hashTable.size());
+  uint8_t* output = buffer.data();
+  for (const auto& entry : m_hashTable) {
+    boost::endian::endian_store<int32_t, sizeof(int32_t), boost::endian::order::big>(output, entry.count);
+    output += sizeof(entry.count);
+
+    boost::endian::endian_store<KeyT, sizeof(KeyT), boost::endian::order::big>(output, entry.keySum);
+    output += sizeof(entry.keySum);
+
+    boost::endian::endian_store<uint32_t, sizeof(uint32_t), boost::endian::order::big>(output, entry.keyCheck);
+    output += sizeof(entry.keyCheck);
+  }
+
+  auto compressed = compress(m_compressionScheme, buffer);
+  name.append(ndn::name::Component(std::move(compressed)));
+}
+
+template<typename KeyT, size_t NHash>
+std::ostream&
+operator<<(std::ostream& os, const BasicIBLT<KeyT, NHash>& iblt)
+{
+  os << "count keySum keyCheckMatch\n";
+  for (const auto& entry : iblt.getHashTable()) {
+    os << entry.count << " " << entry.keySum << " "
+       << ((entry.isEmpty() || checkHash(entry.keySum) == entry.keyCheck) ? "true" : "false")
+       << "\n";
+  }
+  return os;
+}
+
+template<typename KeyT, size_t NHash>
+BasicIBLTDiff<KeyT>
+operator-(const BasicIBLT<KeyT, NHash>& lhs, const BasicIBLT<KeyT, NHash>& rhs)
+{
+  using Entry = BasicHashTableEntry<KeyT>;
+
+  const auto& lht = lhs.getHashTable();
+  const auto& rht = rhs.getHashTable();
+  BOOST_ASSERT(lht.size() == rht.size());
+
+  // On the stack for tables of up to the default FullProducer::Options::ibfCount entries
+  boost::container::small_vector<Entry, 120> peeled(lht.size());
+  std::transform(lht.begin(), lht.end(), rht.begin(), peeled.begin(),
+    [] (const Entry& lhe, const Entry& rhe) {
+      Entry diff;
+      diff.count = lhe.count - rhe.count;
+      diff.keySum = lhe.keySum ^ rhe.keySum;
+      diff.keyCheck = lhe.keyCheck ^ rhe.keyCheck;
+      return diff;
+    }
+  );
+
+  auto bucketsPerHash = static_cast<uint32_t>(peeled.size() / NHash);
+  auto reciprocal = computeReciprocal(bucketsPerHash);
+
+  BasicIBLTDiff<KeyT> diff;
+  size_t nErased = 0;
+  do {
+    nErased = 0;
+    for (const auto& entry : peeled) {
+      if (entry.isPure()) {
+        if (entry.count == 1) {
+          diff.positive.push_back(entry.keySum);
+        }
+        else {
+          diff.negative.push_back(entry.keySum);
+        }
+        ibltUpdate<NHash>(peeled, bucketsPerHash, reciprocal, -entry.count, entry.keySum);
+        ++nErased;
+      }
+    }
+  } while (nErased > 0);
+
+  // If any buckets for one of the hash functions is not empty,
+  // then we didn't peel them all:
+  diff.canDecode = std::all_of(peeled.begin(), peeled.end(),
+                               [] (const Entry& entry) { return entry.isEmpty(); });
+
+  for (auto* keys : {&diff.positive, &diff.negative}) {
+    std::sort(keys->begin(), keys->end());
+    keys->erase(std::unique(keys->begin(), keys->end()), keys->end());
+  }
+  return diff;
+}
+
+} // namespace psync::detail
+
+#endif // PSYNC_DETAIL_IBLT_IMPL_HPP
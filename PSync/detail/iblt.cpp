@@ -44,171 +44,19 @@
 */
 
 #include "PSync/detail/iblt.hpp"
-#include "PSync/detail/util.hpp"
-
-#include <ndn-cxx/util/exception.hpp>
 
 namespace psync::detail {
 
-namespace be = boost::endian;
-
-constexpr size_t ENTRY_SIZE = sizeof(HashTableEntry::count) + sizeof(HashTableEntry::keySum) +
-                              sizeof(HashTableEntry::keyCheck);
-
-bool
-HashTableEntry::isPure() const
-{
-  if (count == 1 || count == -1) {
-    uint32_t check = murmurHash3(N_HASHCHECK, keySum);
-    return keyCheck == check;
-  }
-
-  return false;
-}
-
-bool
-HashTableEntry::isEmpty() const
-{
-  return count == 0 && keySum == 0 && keyCheck == 0;
-}
-
-IBLT::IBLT(size_t expectedNumEntries, CompressionScheme scheme)
-  : m_compressionScheme(scheme)
-{
-  // 1.5x expectedNumEntries gives very low probability of decoding failure
-  size_t nEntries = expectedNumEntries + expectedNumEntries / 2;
-  // make nEntries exactly divisible by N_HASH
-  size_t remainder = nEntries % N_HASH;
-  if (remainder != 0) {
-    nEntries += (N_HASH - remainder);
-  }
-
-  m_hashTable.resize(nEntries);
-}
-
-void
-IBLT::initialize(const ndn::name::Component& ibltName)
-{
-  auto decompressed = decompress(m_compressionScheme, ibltName.value_bytes());
-  if (decompressed->size() != ENTRY_SIZE * m_hashTable.size()) {
-    NDN_THROW(Error("Received IBF cannot be decoded!"));
-  }
-
-  const uint8_t* input = decompressed->data();
-  for (auto& entry : m_hashTable) {
-    entry.count = be::endian_load<int32_t, sizeof(int32_t), be::order::big>(input);
-    input += sizeof(entry.count);
-
-    entry.keySum = be::endian_load<uint32_t, sizeof(uint32_t), be::order::big>(input);
-    input += sizeof(entry.keySum);
-
-    entry.keyCheck = be::endian_load<uint32_t, sizeof(uint32_t), be::order::big>(input);
-    input += sizeof(entry.keyCheck);
-  }
-}
-
-static inline void
-ibltUpdate(std::vector<HashTableEntry>& ht, int32_t plusOrMinus, uint32_t key)
-{
-  size_t bucketsPerHash = ht.size() / N_HASH;
-
-  for (size_t i = 0; i < N_HASH; i++) {
-    size_t startEntry = i * bucketsPerHash;
-    uint32_t h = murmurHash3(i, key);
-    HashTableEntry& entry = ht.at(startEntry + (h % bucketsPerHash));
-    entry.count += plusOrMinus;
-    entry.keySum ^= key;
-    entry.keyCheck ^= murmurHash3(N_HASHCHECK, key);
-  }
-}
-
-void
-IBLT::insert(uint32_t key)
-{
-  ibltUpdate(m_hashTable, 1, key);
-}
-
-void
-IBLT::erase(uint32_t key)
-{
-  ibltUpdate(m_hashTable, -1, key);
-}
-
-void
-IBLT::appendToName(ndn::Name& name) const
-{
-  std::vector<uint8_t> buffer(ENTRY_SIZE * m_hashTable.size());
-  uint8_t* output = buffer.data();
-  for (const auto& entry : m_hashTable) {
-    be::endian_store<int32_t, sizeof(int32_t), be::order::big>(output, entry.count);
-    output += sizeof(entry.count);
-
-    be::endian_store<uint32_t, sizeof(uint32_t), be::order::big>(output, entry.keySum);
-    output += sizeof(entry.keySum);
-
-    be::endian_store<uint32_t, sizeof(uint32_t), be::order::big>(output, entry.keyCheck);
-    output += sizeof(entry.keyCheck);
-  }
-
-  auto compressed = compress(m_compressionScheme, buffer);
-  name.append(ndn::name::Component(std::move(compressed)));
-}
-
-std::ostream&
-operator<<(std::ostream& os, const IBLT& iblt)
-{
-  os << "count keySum keyCheckMatch\n";
-  for (const auto& entry : iblt.getHashTable()) {
-    os << entry.count << " " << entry.keySum << " "
-       << ((entry.isEmpty() || murmurHash3(N_HASHCHECK, entry.keySum) == entry.keyCheck) ? "true" : "false")
-       << "\n";
-  }
-  return os;
-}
-
-IBLTDiff
-operator-(const IBLT& lhs, const IBLT& rhs)
-{
-  const auto& lht = lhs.getHashTable();
-  const auto& rht = rhs.getHashTable();
-  BOOST_ASSERT(lht.size() == rht.size());
-
-  std::vector<HashTableEntry> peeled(lht.size());
-  std::transform(lht.begin(), lht.end(), rht.begin(), peeled.begin(),
-    [] (const HashTableEntry& lhe, const HashTableEntry& rhe) {
-      HashTableEntry diff;
-      diff.count = lhe.count - rhe.count;
-      diff.keySum = lhe.keySum ^ rhe.keySum;
-      diff.keyCheck = lhe.keyCheck ^ rhe.keyCheck;
-      return diff;
-    }
-  );
+template class BasicHashTableEntry<uint32_t>;
+template class BasicHashTableEntry<uint64_t>;
 
-  std::set<uint32_t> positive;
-  std::set<uint32_t> negative;
+template class BasicIBLT<uint32_t>;
+template class BasicIBLT<uint64_t>;
 
-  size_t nErased = 0;
-  do {
-    nErased = 0;
-    for (const auto& entry : peeled) {
-      if (entry.isPure()) {
-        if (entry.count == 1) {
-          positive.insert(entry.keySum);
-        }
-        else {
-          negative.insert(entry.keySum);
-        }
-        ibltUpdate(peeled, -entry.count, entry.keySum);
-        ++nErased;
-      }
-    }
-  } while (nErased > 0);
+template std::ostream& operator<<(std::ostream&, const IBLT&);
+template std::ostream& operator<<(std::ostream&, const IBLT64&);
 
-  // If any buckets for one of the hash functions is not empty,
-  // then we didn't peel them all:
-  bool canDecode = std::all_of(peeled.begin(), peeled.end(),
-                               [] (const HashTableEntry& entry) { return entry.isEmpty(); });
-  return {canDecode, std::move(positive), std::move(negative)};
-}
+template IBLTDiff operator-(const IBLT&, const IBLT&);
+template BasicIBLTDiff<uint64_t> operator-(const IBLT64&, const IBLT64&);
 
 } // namespace psync::detail
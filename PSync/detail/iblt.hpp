@@ -50,14 +50,19 @@
 
 #include <ndn-cxx/name.hpp>
 
+#include <boost/container/small_vector.hpp>
 #include <boost/operators.hpp>
 
-#include <set>
 #include <string>
+#include <type_traits>
 
 namespace psync::detail {
 
-class HashTableEntry : private boost::equality_comparable<HashTableEntry>
+/**
+ * @brief Cell of an IBLT with keys of type @p KeyT
+ */
+template<typename KeyT>
+class BasicHashTableEntry : private boost::equality_comparable<BasicHashTableEntry<KeyT>>
 {
 public:
   bool
@@ -72,28 +77,68 @@ private: // non-member operators
   // boost::equality_comparable provides != operator.
 
   friend bool
-  operator==(const HashTableEntry& lhs, const HashTableEntry& rhs) noexcept
+  operator==(const BasicHashTableEntry& lhs, const BasicHashTableEntry& rhs) noexcept
   {
     return lhs.count == rhs.count && lhs.keySum == rhs.keySum && lhs.keyCheck == rhs.keyCheck;
   }
 
 public:
   int32_t count = 0;
-  uint32_t keySum = 0;
+  KeyT keySum = 0;
   uint32_t keyCheck = 0;
 };
 
+using HashTableEntry = BasicHashTableEntry<uint32_t>;
+
 inline constexpr size_t N_HASH = 3;
 inline constexpr size_t N_HASHCHECK = 11;
 
+/** @brief Represent the difference between two IBLTs, */
+template<typename KeyT>
+struct BasicIBLTDiff
+{
+  /**
+   * @brief Keys sorted in ascending order, without duplicates
+   *
+   * Up to 16 keys are held without allocating, enough for the usual differences.
+   * Use std::binary_search to look up a key.
+   */
+  using Keys = boost::container::small_vector<KeyT, 16>;
+
+  /** @brief Whether decoding completed successfully. */
+  bool canDecode = false;
+
+  /** @brief Entries in lhs but not rhs. */
+  Keys positive;
+
+  /** @brief Entries in rhs but not lhs. */
+  Keys negative;
+};
+
+using IBLTDiff = BasicIBLTDiff<uint32_t>;
+
 /**
  * @brief Invertible Bloom Lookup Table (Invertible Bloom Filter)
  *
  * Used by Partial Sync (PartialProducer) and Full Sync (Full Producer)
+ *
+ * @tparam KeyT type of the keys, uint32_t or uint64_t
+ * @tparam NHash number of hash functions, each of which has its own part of the table
+ *
+ * The members are defined in iblt-impl.hpp. IBLT and IBLT64 are instantiated once, in
+ * the library, other key types and hash counts where they are used.
  */
-class IBLT : private boost::equality_comparable<IBLT>
+template<typename KeyT, size_t NHash = N_HASH>
+class BasicIBLT : private boost::equality_comparable<BasicIBLT<KeyT, NHash>>
 {
+  static_assert(std::is_same_v<KeyT, uint32_t> || std::is_same_v<KeyT, uint64_t>,
+                "IBLT keys must be uint32_t or uint64_t");
+  static_assert(NHash > 0, "IBLT needs at least one hash function");
+
 public:
+  using Entry = BasicHashTableEntry<KeyT>;
+  using Diff = BasicIBLTDiff<KeyT>;
+
   class Error : public std::runtime_error
   {
   public:
@@ -105,9 +150,10 @@ public:
    *
    * @param expectedNumEntries the expected number of entries in the IBLT
    * @param scheme compression scheme to be used for the IBLT
+   * @throws Error if @p expectedNumEntries is zero
    */
   explicit
-  IBLT(size_t expectedNumEntries, CompressionScheme scheme);
+  BasicIBLT(size_t expectedNumEntries, CompressionScheme scheme);
 
   /**
    * @brief Populate the hash table using the vector representation of IBLT
@@ -119,12 +165,12 @@ public:
   initialize(const ndn::name::Component& ibltName);
 
   void
-  insert(uint32_t key);
+  insert(KeyT key);
 
   void
-  erase(uint32_t key);
+  erase(KeyT key);
 
-  const std::vector<HashTableEntry>&
+  const std::vector<Entry>&
   getHashTable() const
   {
     return m_hashTable;
@@ -138,6 +184,8 @@ public:
    * We put the first count in first 4 cells, keySum in next 4, and keyCheck in next 4.
    * Repeat for all the other cells of the hash table.
    * Then we append this uint8_t vector to the name.
+   *
+   * With 64-bit keys, keySum takes 8 cells instead of 4.
    */
   void
   appendToName(ndn::Name& name) const;
@@ -148,31 +196,32 @@ private: // non-member operators
   // boost::equality_comparable provides != operator.
 
   friend bool
-  operator==(const IBLT& lhs, const IBLT& rhs)
+  operator==(const BasicIBLT& lhs, const BasicIBLT& rhs)
   {
     return lhs.m_hashTable == rhs.m_hashTable;
   }
 
 private:
-  std::vector<HashTableEntry> m_hashTable;
+  std::vector<Entry> m_hashTable;
   CompressionScheme m_compressionScheme;
+  // Number of entries of each hash function, and its precomputed reciprocal
+  uint32_t m_bucketsPerHash = 0;
+  uint64_t m_bucketsPerHashReciprocal = 0;
 };
 
-std::ostream&
-operator<<(std::ostream& os, const IBLT& iblt);
-
-/** @brief Represent the difference between two IBLTs, */
-struct IBLTDiff
-{
-  /** @brief Whether decoding completed successfully. */
-  bool canDecode = false;
+/**
+ * @brief IBLT of 32-bit keys, as exchanged by Full Sync and Partial Sync
+ */
+using IBLT = BasicIBLT<uint32_t>;
 
-  /** @brief Entries in lhs but not rhs. */
-  std::set<uint32_t> positive;
+/**
+ * @brief IBLT of 64-bit keys, whose entries are 16 bytes when encoded
+ */
+using IBLT64 = BasicIBLT<uint64_t>;
 
-  /** @brief Entries in rhs but not lhs. */
-  std::set<uint32_t> negative;
-};
+template<typename KeyT, size_t NHash>
+std::ostream&
+operator<<(std::ostream& os, const BasicIBLT<KeyT, NHash>& iblt);
 
 /**
  * @brief Compute the difference between two IBLTs.
@@ -180,9 +229,24 @@ struct IBLTDiff
  * @param rhs received IBLT. It must have same hashtable size @p lhs hashtable.
  * @return decoding result.
  */
-IBLTDiff
-operator-(const IBLT& lhs, const IBLT& rhs);
+template<typename KeyT, size_t NHash>
+BasicIBLTDiff<KeyT>
+operator-(const BasicIBLT<KeyT, NHash>& lhs, const BasicIBLT<KeyT, NHash>& rhs);
+
+extern template class BasicHashTableEntry<uint32_t>;
+extern template class BasicHashTableEntry<uint64_t>;
+
+extern template class BasicIBLT<uint32_t>;
+extern template class BasicIBLT<uint64_t>;
+
+extern template std::ostream& operator<<(std::ostream&, const IBLT&);
+extern template std::ostream& operator<<(std::ostream&, const IBLT64&);
+
+extern template IBLTDiff operator-(const IBLT&, const IBLT&);
+extern template BasicIBLTDiff<uint64_t> operator-(const IBLT64&, const IBLT64&);
 
 } // namespace psync::detail
 
+#include "PSync/detail/iblt-impl.hpp"
+
 #endif // PSYNC_DETAIL_IBLT_HPP
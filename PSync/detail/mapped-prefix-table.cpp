@@ -0,0 +1,534 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/detail/mapped-prefix-table.hpp"
+#include "PSync/detail/util.hpp"
+
+#include <ndn-cxx/encoding/tlv.hpp>
+#include <ndn-cxx/util/exception.hpp>
+#include <ndn-cxx/util/logger.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include <sys/mman.h>
+
+namespace psync::detail {
+
+NDN_LOG_INIT(psync.MappedPrefixTable);
+
+const char MAGIC[8] = {'P', 'S', 'Y', 'N', 'C', 'P', 'T', '1'};
+const uint64_t EMPTY = 0;
+const uint32_t EMPTY_INDEX = 0;
+const uint32_t PREFIX_HASH_SEED = 0;
+const size_t SLOT_SIZE = 32;
+
+// Slots are at most 70% full
+static size_t
+getMaxEntries(size_t nSlots)
+{
+  return nSlots / 10 * 7;
+}
+
+// Whether @p pos is in the cyclic range (from, to]
+static bool
+isInRange(size_t from, size_t pos, size_t to)
+{
+  return from <= to ? (from < pos && pos <= to) : (from < pos || pos <= to);
+}
+
+static size_t
+getArenaOffset(size_t nSlots)
+{
+  size_t offset = 64 + nSlots * (SLOT_SIZE + sizeof(uint32_t));
+  return (offset + 7) / 8 * 8;
+}
+
+// Size of the TLV-VALUE of @p name, computed without encoding it
+static size_t
+getNameValueSize(const ndn::Name& name)
+{
+  size_t size = 0;
+  for (const auto& component : name) {
+    size += ndn::tlv::sizeOfVarNumber(component.type()) +
+            ndn::tlv::sizeOfVarNumber(component.value_size()) + component.value_size();
+  }
+  return size;
+}
+
+static size_t
+getNameSize(size_t valueSize)
+{
+  return ndn::tlv::sizeOfVarNumber(ndn::tlv::Name) + ndn::tlv::sizeOfVarNumber(valueSize) +
+         valueSize;
+}
+
+// Writes the Name TLV of @p name to @p buf, using the wire of the components that have one
+static void
+writeName(uint8_t* buf, const ndn::Name& name, size_t valueSize)
+{
+  buf += writeVarNumber(buf, ndn::tlv::Name);
+  buf += writeVarNumber(buf, valueSize);
+  for (const auto& component : name) {
+    if (component.hasWire()) {
+      buf = std::copy(component.begin(), component.end(), buf);
+    }
+    else {
+      buf += writeVarNumber(buf, component.type());
+      buf += writeVarNumber(buf, component.value_size());
+      buf = std::copy(component.value_begin(), component.value_end(), buf);
+    }
+  }
+}
+
+// Whether the Name TLV in [begin, end) holds the components of @p name
+static bool
+isSameName(const uint8_t* begin, const uint8_t* end, const ndn::Name& name)
+{
+  uint64_t type = 0;
+  uint64_t length = 0;
+  if (!ndn::tlv::readVarNumber(begin, end, type) || !ndn::tlv::readVarNumber(begin, end, length)) {
+    return false;
+  }
+  for (const auto& component : name) {
+    if (!ndn::tlv::readVarNumber(begin, end, type) || type != component.type() ||
+        !ndn::tlv::readVarNumber(begin, end, length) || length != component.value_size() ||
+        static_cast<size_t>(end - begin) < length ||
+        !std::equal(begin, begin + length, component.value_begin())) {
+      return false;
+    }
+    begin += length;
+  }
+  return begin == end;
+}
+
+MappedPrefixTable::MappedPrefixTable(const std::string& path, size_t maxPrefixes)
+  : m_path(path)
+{
+  static_assert(sizeof(Header) <= HEADER_SIZE);
+  static_assert(sizeof(Slot) == SLOT_SIZE);
+
+  if (maxPrefixes >= std::numeric_limits<uint32_t>::max() / 2) {
+    NDN_THROW(Error("Too many prefixes for a prefix table"));
+  }
+
+  namespace io = boost::iostreams;
+  io::mapped_file_params params(path);
+  params.flags = io::mapped_file::readwrite;
+
+  bool isNew = !std::ifstream(path).good();
+  if (isNew) {
+    m_nSlots = 16;
+    while (getMaxEntries(m_nSlots) < maxPrefixes) {
+      m_nSlots *= 2;
+    }
+    params.new_file_size = getArenaOffset(m_nSlots) + INITIAL_ARENA_SIZE;
+  }
+
+  try {
+    m_file.open(params);
+  }
+  catch (const std::exception& e) {
+    NDN_THROW(Error("Cannot map " + path + ": " + e.what()));
+  }
+
+  if (isNew) {
+    // The new file is filled with zeros, all slots are EMPTY
+    std::memcpy(header().magic, MAGIC, sizeof(MAGIC));
+    header().nSlots = m_nSlots;
+  }
+  else {
+    if (m_file.size() < HEADER_SIZE || std::memcmp(header().magic, MAGIC, sizeof(MAGIC)) != 0) {
+      NDN_THROW(Error(path + " is not a prefix table"));
+    }
+    m_nSlots = header().nSlots;
+    if (m_nSlots == 0 || (m_nSlots & (m_nSlots - 1)) != 0 ||
+        m_file.size() < getArenaOffset(m_nSlots) + header().arenaSize) {
+      NDN_THROW(Error(path + " is corrupt"));
+    }
+    NDN_LOG_DEBUG("Opened " << path << " with " << header().nEntries << " prefixes");
+  }
+  m_maxEntries = getMaxEntries(m_nSlots);
+  m_arenaOffset = getArenaOffset(m_nSlots);
+}
+
+std::optional<uint64_t>
+MappedPrefixTable::getSeqNo(const ndn::Name& prefix) const
+{
+  size_t pos = findSlot(prefix, murmurHash3(PREFIX_HASH_SEED, prefix));
+  if (pos == m_nSlots) {
+    return std::nullopt;
+  }
+  return slots()[pos].seq;
+}
+
+bool
+MappedPrefixTable::insert(const ndn::Name& prefix)
+{
+  uint32_t prefixHash = murmurHash3(PREFIX_HASH_SEED, prefix);
+  if (findSlot(prefix, prefixHash) != m_nSlots) {
+    return false;
+  }
+  if (header().nEntries >= m_maxEntries) {
+    grow();
+  }
+
+  size_t valueSize = getNameValueSize(prefix);
+  size_t nameSize = getNameSize(valueSize);
+  reserveArena(nameSize);
+  uint64_t offset = header().arenaSize;
+  writeName(arena() + offset, prefix, valueSize);
+  header().arenaSize += nameSize;
+
+  size_t mask = m_nSlots - 1;
+  size_t pos = prefixHash & mask;
+  while (slots()[pos].nameOffset != EMPTY) {
+    pos = (pos + 1) & mask;
+  }
+  slots()[pos] = {offset + 1, 0, prefixHash, 0, static_cast<uint32_t>(nameSize), 0};
+  ++header().nEntries;
+  return true;
+}
+
+bool
+MappedPrefixTable::setSeqNo(const ndn::Name& prefix, uint64_t seq, uint32_t key)
+{
+  size_t pos = findSlot(prefix, murmurHash3(PREFIX_HASH_SEED, prefix));
+  if (pos == m_nSlots) {
+    return false;
+  }
+
+  auto& slot = slots()[pos];
+  if (slot.seq != 0) {
+    eraseKey(slot.key, pos);
+  }
+  slot.seq = seq;
+  slot.key = key;
+  if (seq != 0) {
+    insertKey(key, pos);
+  }
+  return true;
+}
+
+std::optional<uint64_t>
+MappedPrefixTable::erase(const ndn::Name& prefix)
+{
+  size_t pos = findSlot(prefix, murmurHash3(PREFIX_HASH_SEED, prefix));
+  if (pos == m_nSlots) {
+    return std::nullopt;
+  }
+
+  auto& slot = slots()[pos];
+  uint64_t seq = slot.seq;
+  if (seq != 0) {
+    eraseKey(slot.key, pos);
+  }
+  header().deadArenaSize += slot.nameLength;
+  --header().nEntries;
+
+  // Backward shift deletion: move back the slots that could no longer be found past the hole
+  size_t mask = m_nSlots - 1;
+  size_t hole = pos;
+  for (size_t next = (hole + 1) & mask; slots()[next].nameOffset != EMPTY; next = (next + 1) & mask) {
+    auto& moved = slots()[next];
+    if (!isInRange(hole, moved.prefixHash & mask, next)) {
+      if (moved.seq != 0) {
+        moveKey(moved.key, next, hole);
+      }
+      slots()[hole] = moved;
+      hole = next;
+    }
+  }
+  slots()[hole] = Slot{};
+  return seq;
+}
+
+std::optional<ndn::Name>
+MappedPrefixTable::findByKey(uint32_t key) const
+{
+  size_t mask = m_nSlots - 1;
+  for (size_t pos = key & mask, n = 0; n < m_nSlots; pos = (pos + 1) & mask, ++n) {
+    uint32_t value = keyIndex()[pos];
+    if (value == EMPTY_INDEX) {
+      break;
+    }
+    if (slots()[value - 1].key == key) {
+      const auto& slot = slots()[value - 1];
+      return getName(slot).appendNumber(slot.seq);
+    }
+  }
+  return std::nullopt;
+}
+
+void
+MappedPrefixTable::forEach(const std::function<void(const ndn::Name&, uint64_t)>& f) const
+{
+  for (size_t pos = 0; pos < m_nSlots; ++pos) {
+    const auto& slot = slots()[pos];
+    if (slot.nameOffset != EMPTY) {
+      f(getName(slot), slot.seq);
+    }
+  }
+}
+
+void
+MappedPrefixTable::forEachKey(const std::function<void(uint32_t)>& f) const
+{
+  for (size_t pos = 0; pos < m_nSlots; ++pos) {
+    const auto& slot = slots()[pos];
+    if (slot.nameOffset != EMPTY && slot.seq != 0) {
+      f(slot.key);
+    }
+  }
+}
+
+void
+MappedPrefixTable::clear()
+{
+  std::fill_n(slots(), m_nSlots, Slot{});
+  std::fill_n(keyIndex(), m_nSlots, EMPTY_INDEX);
+  header().nEntries = 0;
+  header().arenaSize = 0;
+  header().deadArenaSize = 0;
+  header().numOwnElements = 0;
+}
+
+size_t
+MappedPrefixTable::size() const
+{
+  return header().nEntries;
+}
+
+uint64_t
+MappedPrefixTable::getNumOwnElements() const
+{
+  return header().numOwnElements;
+}
+
+void
+MappedPrefixTable::setNumOwnElements(uint64_t n)
+{
+  header().numOwnElements = n;
+}
+
+ndn::Name
+MappedPrefixTable::getName(const Slot& slot) const
+{
+  return ndn::Name(ndn::Block(ndn::span<const uint8_t>(arena() + slot.nameOffset - 1,
+                                                       slot.nameLength)));
+}
+
+size_t
+MappedPrefixTable::findSlot(const ndn::Name& prefix, uint32_t prefixHash) const
+{
+  size_t nameSize = getNameSize(getNameValueSize(prefix));
+  size_t mask = m_nSlots - 1;
+  for (size_t pos = prefixHash & mask, n = 0; n < m_nSlots; pos = (pos + 1) & mask, ++n) {
+    const auto& slot = slots()[pos];
+    if (slot.nameOffset == EMPTY) {
+      break;
+    }
+    const uint8_t* name = arena() + slot.nameOffset - 1;
+    if (slot.prefixHash == prefixHash && slot.nameLength == nameSize &&
+        isSameName(name, name + nameSize, prefix)) {
+      return pos;
+    }
+  }
+  return m_nSlots;
+}
+
+void
+MappedPrefixTable::insertKey(uint32_t key, size_t slotPos)
+{
+  size_t mask = m_nSlots - 1;
+  size_t pos = key & mask;
+  while (keyIndex()[pos] != EMPTY_INDEX) {
+    if (slots()[keyIndex()[pos] - 1].key == key) {
+      // Same key for another prefix/seq, the first one is kept as in ProducerBase::m_biMap
+      NDN_LOG_WARN("IBF key " << key << " is already in the prefix table");
+      return;
+    }
+    pos = (pos + 1) & mask;
+  }
+  keyIndex()[pos] = static_cast<uint32_t>(slotPos + 1);
+}
+
+size_t
+MappedPrefixTable::findKey(uint32_t key, size_t slotPos) const
+{
+  size_t mask = m_nSlots - 1;
+  for (size_t pos = key & mask; keyIndex()[pos] != EMPTY_INDEX; pos = (pos + 1) & mask) {
+    if (keyIndex()[pos] == slotPos + 1) {
+      return pos;
+    }
+  }
+  return m_nSlots;
+}
+
+void
+MappedPrefixTable::eraseKey(uint32_t key, size_t slotPos)
+{
+  size_t hole = findKey(key, slotPos);
+  if (hole == m_nSlots) {
+    // Not indexed, another prefix/seq has the same key
+    return;
+  }
+
+  // Backward shift deletion, as in erase()
+  size_t mask = m_nSlots - 1;
+  for (size_t next = (hole + 1) & mask; keyIndex()[next] != EMPTY_INDEX; next = (next + 1) & mask) {
+    uint32_t value = keyIndex()[next];
+    if (!isInRange(hole, slots()[value - 1].key & mask, next)) {
+      keyIndex()[hole] = value;
+      hole = next;
+    }
+  }
+  keyIndex()[hole] = EMPTY_INDEX;
+}
+
+void
+MappedPrefixTable::moveKey(uint32_t key, size_t fromSlotPos, size_t toSlotPos)
+{
+  size_t pos = findKey(key, fromSlotPos);
+  if (pos != m_nSlots) {
+    keyIndex()[pos] = static_cast<uint32_t>(toSlotPos + 1);
+  }
+}
+
+void
+MappedPrefixTable::rebuild(size_t nSlots, size_t arenaCapacity)
+{
+  namespace io = boost::iostreams;
+  std::string tmpPath = m_path + ".tmp";
+  std::remove(tmpPath.c_str());
+  io::mapped_file_params params(tmpPath);
+  params.flags = io::mapped_file::readwrite;
+  params.new_file_size = getArenaOffset(nSlots) + arenaCapacity;
+
+  io::mapped_file file;
+  try {
+    file.open(params);
+  }
+  catch (const std::exception& e) {
+    NDN_THROW(Error("Cannot map " + tmpPath + ": " + e.what()));
+  }
+
+  // The old mapping stays open until the new file replaces it
+  auto oldFile = m_file;
+  auto oldNSlots = m_nSlots;
+  auto oldArenaOffset = m_arenaOffset;
+  const Slot* oldSlots = slots();
+  const uint8_t* oldArena = arena();
+  const Header oldHeader = header();
+
+  m_file = file;
+  m_nSlots = nSlots;
+  m_maxEntries = getMaxEntries(m_nSlots);
+  m_arenaOffset = getArenaOffset(m_nSlots);
+  std::memcpy(header().magic, MAGIC, sizeof(MAGIC));
+  header().nSlots = m_nSlots;
+  header().nEntries = oldHeader.nEntries;
+  header().numOwnElements = oldHeader.numOwnElements;
+
+  // Names are copied next to each other, dropping the erased ones
+  size_t mask = m_nSlots - 1;
+  for (size_t oldPos = 0; oldPos < oldNSlots; ++oldPos) {
+    Slot entry = oldSlots[oldPos];
+    if (entry.nameOffset == EMPTY) {
+      continue;
+    }
+    std::memcpy(arena() + header().arenaSize, oldArena + entry.nameOffset - 1, entry.nameLength);
+    entry.nameOffset = header().arenaSize + 1;
+    header().arenaSize += entry.nameLength;
+
+    size_t pos = entry.prefixHash & mask;
+    while (slots()[pos].nameOffset != EMPTY) {
+      pos = (pos + 1) & mask;
+    }
+    slots()[pos] = entry;
+    if (entry.seq != 0) {
+      insertKey(entry.key, pos);
+    }
+  }
+  NDN_LOG_DEBUG("Rebuilt prefix table with " << m_nSlots << " slots, arena from " <<
+                oldHeader.arenaSize << " to " << header().arenaSize << " bytes");
+
+  // The content must be on disk before the rename makes it the table, a crash before
+  // the rename leaves the old file as it was
+  bool isSynced = ::msync(m_file.data(), m_file.size(), MS_SYNC) == 0;
+  m_file.close();
+  if (!isSynced || std::rename(tmpPath.c_str(), m_path.c_str()) != 0) {
+    std::remove(tmpPath.c_str());
+    m_file = oldFile;
+    m_nSlots = oldNSlots;
+    m_maxEntries = getMaxEntries(m_nSlots);
+    m_arenaOffset = oldArenaOffset;
+    NDN_THROW(Error("Cannot replace " + m_path + " with the rebuilt prefix table"));
+  }
+  oldFile.close();
+
+  params.path = m_path;
+  params.new_file_size = 0;
+  try {
+    m_file.open(params);
+  }
+  catch (const std::exception& e) {
+    NDN_THROW(Error("Cannot map " + m_path + ": " + e.what()));
+  }
+}
+
+void
+MappedPrefixTable::grow()
+{
+  if (m_nSlots > std::numeric_limits<uint32_t>::max() / 2) {
+    NDN_THROW(Error("Prefix table is full"));
+  }
+  NDN_LOG_DEBUG("Growing prefix table to " << m_nSlots * 2 << " slots");
+  rebuild(m_nSlots * 2, m_file.size() - m_arenaOffset);
+}
+
+void
+MappedPrefixTable::reserveArena(size_t length)
+{
+  size_t capacity = m_file.size() - m_arenaOffset;
+  if (header().arenaSize + length <= capacity) {
+    return;
+  }
+
+  // Reclaim the names of erased prefixes rather than grow the file, if they are many
+  size_t needed = header().arenaSize + length;
+  if (header().deadArenaSize >= header().arenaSize / 4) {
+    needed -= header().deadArenaSize;
+    rebuild(m_nSlots, needed <= capacity ? capacity : std::max(needed, capacity * 2));
+    return;
+  }
+
+  // Only the arena past its used part changes, so this is safe against a crash
+  try {
+    m_file.resize(m_arenaOffset + std::max(needed, capacity * 2));
+  }
+  catch (const std::exception& e) {
+    NDN_THROW(Error(std::string("Cannot grow prefix table: ") + e.what()));
+  }
+}
+
+} // namespace psync::detail
@@ -0,0 +1,244 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PSYNC_DETAIL_MAPPED_PREFIX_TABLE_HPP
+#define PSYNC_DETAIL_MAPPED_PREFIX_TABLE_HPP
+
+#include "PSync/detail/access-specifiers.hpp"
+
+#include <ndn-cxx/name.hpp>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <functional>
+#include <optional>
+
+namespace psync::detail {
+
+/**
+ * @brief Prefix table of a producer kept in a memory-mapped file
+ *
+ * Maps each prefix to its sequence number and to the IBF key of prefix/seq, like
+ * the prefix map and hash map of ProducerBase. The file holds hash slots, an index
+ * of the slots by IBF key, and an append-only arena of encoded names. The slots and
+ * the index double in size when they are 70% full. Only the pages in use stay resident,
+ * and reopening the file restores the table.
+ *
+ * Both hash tables use linear probing with backward shift deletion, so erasing leaves no
+ * tombstones behind. The names of erased prefixes are reclaimed by compacting the arena
+ * when it would otherwise grow. Growing and compacting write a new file that replaces the
+ * old one by a rename, so a crash in between leaves the old table intact.
+ */
+class MappedPrefixTable
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  /**
+   * @brief Open the table in @p path, or create it with room for @p maxPrefixes prefixes
+   *        before it has to grow
+   *
+   * @throw Error the file cannot be mapped or does not hold a prefix table
+   */
+  MappedPrefixTable(const std::string& path, size_t maxPrefixes);
+
+  std::optional<uint64_t>
+  getSeqNo(const ndn::Name& prefix) const;
+
+  /**
+   * @brief Add @p prefix with sequence number zero
+   *
+   * @return false if @p prefix is already in the table
+   * @throw Error the file cannot grow
+   */
+  bool
+  insert(const ndn::Name& prefix);
+
+  /**
+   * @brief Set the sequence number of @p prefix and the IBF key of prefix/seq
+   *
+   * @return false if @p prefix is not in the table
+   */
+  bool
+  setSeqNo(const ndn::Name& prefix, uint64_t seq, uint32_t key);
+
+  /**
+   * @brief Remove @p prefix
+   *
+   * @return the sequence number of @p prefix, or nullopt if it was not in the table
+   */
+  std::optional<uint64_t>
+  erase(const ndn::Name& prefix);
+
+  /**
+   * @brief Find the prefix whose prefix/seq has IBF key @p key
+   *
+   * @return prefix/seq, or nullopt if not found
+   */
+  std::optional<ndn::Name>
+  findByKey(uint32_t key) const;
+
+  /**
+   * @brief Call @p f with each prefix and its sequence number, in no particular order
+   */
+  void
+  forEach(const std::function<void(const ndn::Name& prefix, uint64_t seq)>& f) const;
+
+  /**
+   * @brief Call @p f with the IBF key of each prefix whose sequence number is not zero
+   *
+   * Does not decode the names, used to rebuild the IBF of a reopened table.
+   */
+  void
+  forEachKey(const std::function<void(uint32_t key)>& f) const;
+
+  void
+  clear();
+
+  size_t
+  size() const;
+
+  /**
+   * @brief Counter kept with the table for the producer, see ProducerBase::m_numOwnElements
+   */
+  uint64_t
+  getNumOwnElements() const;
+
+  void
+  setNumOwnElements(uint64_t n);
+
+PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
+  struct Header
+  {
+    char magic[8];
+    uint64_t nSlots;
+    uint64_t nEntries;
+    uint64_t arenaSize;
+    uint64_t numOwnElements;
+    // Bytes of the arena used by the names of erased prefixes
+    uint64_t deadArenaSize;
+  };
+
+  struct Slot
+  {
+    // Offset of the Name TLV in the arena plus one, or EMPTY
+    uint64_t nameOffset;
+    uint64_t seq;
+    uint32_t prefixHash;
+    // IBF key of prefix/seq, when seq is not zero
+    uint32_t key;
+    uint32_t nameLength;
+    uint32_t padding;
+  };
+
+private:
+  Header&
+  header() const
+  {
+    return *reinterpret_cast<Header*>(m_file.data());
+  }
+
+  Slot*
+  slots() const
+  {
+    return reinterpret_cast<Slot*>(m_file.data() + HEADER_SIZE);
+  }
+
+  // Slot index plus one of each IBF key, or EMPTY_INDEX
+  uint32_t*
+  keyIndex() const
+  {
+    return reinterpret_cast<uint32_t*>(m_file.data() + HEADER_SIZE + m_nSlots * sizeof(Slot));
+  }
+
+  uint8_t*
+  arena() const
+  {
+    return reinterpret_cast<uint8_t*>(m_file.data()) + m_arenaOffset;
+  }
+
+  ndn::Name
+  getName(const Slot& slot) const;
+
+  /**
+   * @brief Returns the position of @p prefix in slots(), or m_nSlots if not found
+   */
+  size_t
+  findSlot(const ndn::Name& prefix, uint32_t prefixHash) const;
+
+  /**
+   * @brief Returns the position in keyIndex() of slot @p slotPos with IBF key @p key,
+   *        or m_nSlots if not found
+   */
+  size_t
+  findKey(uint32_t key, size_t slotPos) const;
+
+  void
+  insertKey(uint32_t key, size_t slotPos);
+
+  void
+  eraseKey(uint32_t key, size_t slotPos);
+
+  /**
+   * @brief Update the index entry of IBF key @p key after its slot was moved
+   */
+  void
+  moveKey(uint32_t key, size_t fromSlotPos, size_t toSlotPos);
+
+  /**
+   * @brief Replace the file with a table of @p nSlots slots and an arena of
+   *        @p arenaCapacity bytes, dropping the names of erased prefixes
+   *
+   * The new table is written to a temporary file that is then renamed over the old one.
+   *
+   * @throw Error the new file cannot be written
+   */
+  void
+  rebuild(size_t nSlots, size_t arenaCapacity);
+
+  /**
+   * @brief Double the number of slots
+   */
+  void
+  grow();
+
+  /**
+   * @brief Grow the file so that the arena has room for @p length more bytes
+   */
+  void
+  reserveArena(size_t length);
+
+PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
+  static constexpr size_t HEADER_SIZE = 64;
+  static constexpr size_t INITIAL_ARENA_SIZE = 1 << 20;
+
+  std::string m_path;
+  boost::iostreams::mapped_file m_file;
+  size_t m_nSlots;
+  size_t m_maxEntries;
+  size_t m_arenaOffset;
+};
+
+} // namespace psync::detail
+
+#endif // PSYNC_DETAIL_MAPPED_PREFIX_TABLE_HPP
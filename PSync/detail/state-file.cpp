@@ -0,0 +1,260 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/detail/state-file.hpp"
+
+#include <ndn-cxx/encoding/block-helpers.hpp>
+#include <ndn-cxx/util/exception.hpp>
+#include <ndn-cxx/util/logger.hpp>
+
+#include <boost/crc.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace psync::detail {
+
+NDN_LOG_INIT(psync.StateFile);
+
+static uint32_t
+computeChecksum(const ndn::Block& block)
+{
+  boost::crc_32_type crc;
+  crc.process_bytes(block.data(), block.size());
+  return crc.checksum();
+}
+
+static std::shared_ptr<ndn::Buffer>
+readFile(std::ifstream& is)
+{
+  return std::make_shared<ndn::Buffer>(std::istreambuf_iterator<char>(is),
+                                       std::istreambuf_iterator<char>());
+}
+
+static bool
+writeAll(int fd, const uint8_t* data, size_t size)
+{
+  while (size > 0) {
+    ssize_t n = ::write(fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Make the creation or renaming of a file in the directory of @p path durable
+static void
+syncDirectory(const std::string& path)
+{
+  auto dir = std::filesystem::path(path).parent_path();
+  if (dir.empty()) {
+    dir = ".";
+  }
+  int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0 || ::fsync(fd) != 0) {
+    // Not supported by all file systems, the file itself is on disk
+    NDN_LOG_WARN("Cannot sync directory " << dir << ": " << std::strerror(errno));
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+void
+writeStateFile(const std::string& path, const ndn::Block& block)
+{
+  auto checksum = ndn::encoding::makeNonNegativeIntegerBlock(tlv::StateChecksum,
+                                                             computeChecksum(block));
+
+  std::string tmpPath = path + ".tmp";
+  int fd = ::open(tmpPath.data(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    NDN_THROW(StateFileError("Cannot create " + tmpPath + ": " + std::strerror(errno)));
+  }
+  // The content must be on disk before the rename makes it the state
+  bool isOk = writeAll(fd, block.data(), block.size()) &&
+              writeAll(fd, checksum.data(), checksum.size()) &&
+              ::fsync(fd) == 0;
+  int error = isOk ? 0 : errno;
+  if (::close(fd) != 0 && isOk) {
+    isOk = false;
+    error = errno;
+  }
+  if (!isOk) {
+    std::remove(tmpPath.data());
+    NDN_THROW(StateFileError("Cannot write " + tmpPath + ": " + std::strerror(error)));
+  }
+
+  if (std::rename(tmpPath.data(), path.data()) != 0) {
+    std::remove(tmpPath.data());
+    NDN_THROW(StateFileError("Cannot rename " + tmpPath + " to " + path));
+  }
+  syncDirectory(path);
+}
+
+std::optional<ndn::Block>
+readStateFile(const std::string& path)
+{
+  std::ifstream is(path, std::ios::binary);
+  if (!is) {
+    return std::nullopt;
+  }
+  auto buffer = readFile(is);
+
+  auto [isOk, block] = ndn::Block::fromBuffer(buffer, 0);
+  if (!isOk) {
+    NDN_THROW(StateFileError(path + " is truncated"));
+  }
+  auto [isChecksumOk, checksum] = ndn::Block::fromBuffer(buffer, block.size());
+  if (!isChecksumOk || checksum.type() != tlv::StateChecksum) {
+    NDN_THROW(StateFileError(path + " has no checksum"));
+  }
+  if (ndn::encoding::readNonNegativeInteger(checksum) != computeChecksum(block)) {
+    NDN_THROW(StateFileError(path + " is corrupt"));
+  }
+  return block;
+}
+
+// Calls @p onRecord for each record of @p buffer up to the first incomplete one,
+// returns the number of records and their size with their checksums
+static std::pair<size_t, size_t>
+readRecords(const std::shared_ptr<ndn::Buffer>& buffer,
+            const std::function<void(const ndn::Block&)>& onRecord)
+{
+  size_t nRecords = 0;
+  size_t offset = 0;
+  while (offset < buffer->size()) {
+    auto [isOk, record] = ndn::Block::fromBuffer(buffer, offset);
+    if (!isOk) {
+      break;
+    }
+    auto [isChecksumOk, checksum] = ndn::Block::fromBuffer(buffer, offset + record.size());
+    if (!isChecksumOk || checksum.type() != tlv::StateChecksum ||
+        ndn::encoding::readNonNegativeInteger(checksum) != computeChecksum(record)) {
+      break;
+    }
+    offset += record.size() + checksum.size();
+    if (onRecord) {
+      onRecord(record);
+    }
+    ++nRecords;
+  }
+  return {nRecords, offset};
+}
+
+StateJournal::StateJournal(const std::string& path)
+  : m_path(path)
+  , m_fd(::open(path.data(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644))
+{
+  if (m_fd < 0) {
+    NDN_THROW(StateFileError("Cannot open " + path + ": " + std::strerror(errno)));
+  }
+
+  std::ifstream is(path, std::ios::binary);
+  auto buffer = readFile(is);
+  m_size = readRecords(buffer, nullptr).second;
+  if (m_size < buffer->size()) {
+    NDN_LOG_WARN("Removing " << buffer->size() - m_size << " bytes of an incomplete record at "
+                 "the end of " << path);
+    if (::ftruncate(m_fd, static_cast<off_t>(m_size)) != 0 || ::fsync(m_fd) != 0) {
+      int error = errno;
+      ::close(m_fd);
+      NDN_THROW(StateFileError("Cannot truncate " + path + ": " + std::strerror(error)));
+    }
+  }
+  syncDirectory(path);
+}
+
+StateJournal::~StateJournal()
+{
+  // Records that were appended without being synced
+  ::fsync(m_fd);
+  ::close(m_fd);
+}
+
+void
+StateJournal::append(const ndn::Block& record, bool shouldSync)
+{
+  auto checksum = ndn::encoding::makeNonNegativeIntegerBlock(tlv::StateChecksum,
+                                                             computeChecksum(record));
+  if (!writeAll(m_fd, record.data(), record.size()) ||
+      !writeAll(m_fd, checksum.data(), checksum.size())) {
+    int error = errno;
+    // Remove the partial record, the records appended later would not be replayed after it
+    if (::ftruncate(m_fd, static_cast<off_t>(m_size)) != 0) {
+      NDN_LOG_ERROR("Cannot truncate " << m_path << ": " << std::strerror(errno));
+    }
+    NDN_THROW(StateFileError("Cannot write to " + m_path + ": " + std::strerror(error)));
+  }
+  m_size += record.size() + checksum.size();
+
+  if (shouldSync) {
+    sync();
+  }
+}
+
+void
+StateJournal::sync()
+{
+  if (::fsync(m_fd) != 0) {
+    NDN_THROW(StateFileError("Cannot sync " + m_path + ": " + std::strerror(errno)));
+  }
+}
+
+void
+StateJournal::truncate()
+{
+  if (::ftruncate(m_fd, 0) != 0 || ::fsync(m_fd) != 0) {
+    NDN_THROW(StateFileError("Cannot truncate " + m_path + ": " + std::strerror(errno)));
+  }
+  m_size = 0;
+}
+
+size_t
+StateJournal::replay(const std::string& path,
+                     const std::function<void(const ndn::Block&)>& onRecord)
+{
+  std::ifstream is(path, std::ios::binary);
+  if (!is) {
+    return 0;
+  }
+  auto buffer = readFile(is);
+
+  auto [nRecords, size] = readRecords(buffer, onRecord);
+  if (size < buffer->size()) {
+    NDN_LOG_WARN("Ignoring " << buffer->size() - size << " bytes of an incomplete record at "
+                 "the end of " << path);
+  }
+  return nRecords;
+}
+
+} // namespace psync::detail
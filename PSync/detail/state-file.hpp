@@ -0,0 +1,147 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PSYNC_DETAIL_STATE_FILE_HPP
+#define PSYNC_DETAIL_STATE_FILE_HPP
+
+#include <ndn-cxx/encoding/block.hpp>
+
+#include <functional>
+#include <optional>
+
+namespace psync::tlv {
+
+// TLV-TYPEs of the producer state saved on disk
+enum : uint32_t {
+  ProducerSnapshot = 140,
+  SnapshotEntry = 141,
+  SeqNo = 142,
+  NumOwnElements = 143,
+  StateChecksum = 144,
+  JournalUpdate = 145,
+  JournalRemoval = 146,
+};
+
+} // namespace psync::tlv
+
+namespace psync::detail {
+
+class StateFileError : public std::runtime_error
+{
+public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief Write @p block and its CRC-32 to @p path
+ *
+ * The file is written and synced to disk under a temporary name that then replaces
+ * @p path, so that @p path holds either its previous content or the new one, even
+ * after a power failure.
+ *
+ * @throw StateFileError the file cannot be written
+ */
+void
+writeStateFile(const std::string& path, const ndn::Block& block);
+
+/**
+ * @brief Read the block written by writeStateFile()
+ *
+ * @return the block, or nullopt if @p path does not exist
+ * @throw StateFileError the file is truncated or its checksum does not match
+ */
+std::optional<ndn::Block>
+readStateFile(const std::string& path);
+
+/**
+ * @brief Append-only file of TLV records
+ *
+ * Each record is followed by its CRC-32. A record cut short or garbled by a crash is
+ * ignored, along with anything after it, when the journal is replayed, and is removed
+ * when the journal is opened again, so that new records are not appended behind it.
+ */
+class StateJournal
+{
+public:
+  /**
+   * @brief Open @p path for appending, creating it if needed
+   *
+   * An incomplete record at the end of the file is removed.
+   *
+   * @throw StateFileError the file cannot be opened
+   */
+  explicit
+  StateJournal(const std::string& path);
+
+  ~StateJournal();
+
+  StateJournal(const StateJournal&) = delete;
+
+  StateJournal&
+  operator=(const StateJournal&) = delete;
+
+  /**
+   * @brief Append @p record, and write it to disk (fsync) if @p shouldSync
+   *
+   * @throw StateFileError the record cannot be written; the file is cut back
+   *        to the records before it
+   */
+  void
+  append(const ndn::Block& record, bool shouldSync = true);
+
+  /**
+   * @brief Write the records appended so far to disk
+   *
+   * @throw StateFileError the file cannot be synced
+   */
+  void
+  sync();
+
+  /**
+   * @brief Remove all records
+   */
+  void
+  truncate();
+
+  const std::string&
+  getPath() const
+  {
+    return m_path;
+  }
+
+  /**
+   * @brief Call @p onRecord for each complete record in @p path, in order
+   *
+   * Stops at the first record that is incomplete or does not match its checksum.
+   *
+   * @return the number of records
+   */
+  static size_t
+  replay(const std::string& path, const std::function<void(const ndn::Block&)>& onRecord);
+
+private:
+  std::string m_path;
+  int m_fd;
+  // Size of the complete records in the file
+  uint64_t m_size = 0;
+};
+
+} // namespace psync::detail
+
+#endif // PSYNC_DETAIL_STATE_FILE_HPP
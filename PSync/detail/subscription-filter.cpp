@@ -0,0 +1,117 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/detail/subscription-filter.hpp"
+#include "PSync/detail/bloom-filter.hpp"
+#include "PSync/detail/cuckoo-filter.hpp"
+#include "PSync/detail/xor-filter.hpp"
+
+#include <ndn-cxx/util/exception.hpp>
+#include <ndn-cxx/util/sha256.hpp>
+
+namespace psync::detail {
+
+static constexpr size_t SUBSCRIPTION_TOKEN_SIZE = 8;
+
+std::unique_ptr<SubscriptionFilter>
+makeSubscriptionFilter(SubscriptionFilterType type, unsigned int count, double falsePositive,
+                       bool isBlocked)
+{
+  switch (type) {
+    case SubscriptionFilterType::BLOOM:
+      return std::make_unique<CountingBloomFilter>(count, falsePositive,
+                                                   isBlocked ? BloomFilter::Layout::BLOCKED
+                                                             : BloomFilter::Layout::CLASSIC);
+    case SubscriptionFilterType::CUCKOO:
+      return std::make_unique<CuckooFilter>(count, falsePositive);
+    case SubscriptionFilterType::XOR:
+      return std::make_unique<XorFilter>(count, falsePositive);
+  }
+  NDN_THROW(std::invalid_argument("Unknown subscription filter type"));
+}
+
+std::unique_ptr<SubscriptionFilter>
+parseSubscriptionFilter(unsigned int count, double falsePositive,
+                        const ndn::name::Component& component)
+{
+  switch (component.type()) {
+    case ndn::tlv::GenericNameComponent:
+    case tlv::BlockedBloomFilterComponent:
+      return std::make_unique<CountingBloomFilter>(BloomFilter(count, falsePositive, component));
+    case tlv::CuckooFilterComponent:
+      return std::make_unique<CuckooFilter>(count, falsePositive, component);
+    case tlv::XorFilterComponent:
+      return std::make_unique<XorFilter>(count, falsePositive, component);
+    default:
+      NDN_THROW(SubscriptionFilter::Error("Unknown subscription filter type " +
+                                          std::to_string(component.type())));
+  }
+}
+
+ndn::name::Component
+makeSubscriptionToken(const ndn::Name& filter)
+{
+  const auto& wire = filter.wireEncode();
+  auto digest = ndn::Sha256::computeDigest(ndn::span<const uint8_t>(wire.value(), wire.value_size()));
+  return ndn::name::Component(tlv::SubscriptionTokenComponent,
+                              ndn::span<const uint8_t>(digest->data(), SUBSCRIPTION_TOKEN_SIZE));
+}
+
+uint64_t
+encodeFalsePositive(double falsePositive)
+{
+  if (!(falsePositive >= 0.0 && falsePositive < 1.0)) {
+    NDN_THROW(SubscriptionFilter::Error("False positive probability must be in [0, 1)"));
+  }
+  return static_cast<uint64_t>(falsePositive * 1000);
+}
+
+std::vector<uint8_t>
+packBits(const std::vector<uint16_t>& values, unsigned int width)
+{
+  std::vector<uint8_t> bytes(getPackedSize(values.size(), width), 0);
+  size_t bitIndex = 0;
+  for (auto value : values) {
+    for (unsigned int i = width; i-- > 0; ++bitIndex) {
+      if ((value >> i) & 1) {
+        bytes[bitIndex / 8] |= static_cast<uint8_t>(0x80 >> (bitIndex % 8));
+      }
+    }
+  }
+  return bytes;
+}
+
+std::vector<uint16_t>
+unpackBits(ndn::span<const uint8_t> bytes, size_t count, unsigned int width)
+{
+  if (bytes.size() != getPackedSize(count, width)) {
+    NDN_THROW(SubscriptionFilter::Error("Packed table has the wrong size"));
+  }
+
+  std::vector<uint16_t> values(count, 0);
+  size_t bitIndex = 0;
+  for (auto& value : values) {
+    for (unsigned int i = 0; i < width; ++i, ++bitIndex) {
+      value = static_cast<uint16_t>((value << 1) | ((bytes[bitIndex / 8] >> (7 - bitIndex % 8)) & 1));
+    }
+  }
+  return values;
+}
+
+} // namespace psync::detail
@@ -0,0 +1,169 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PSYNC_DETAIL_SUBSCRIPTION_FILTER_HPP
+#define PSYNC_DETAIL_SUBSCRIPTION_FILTER_HPP
+
+#include "PSync/common.hpp"
+
+#include <ndn-cxx/name.hpp>
+
+#include <memory>
+
+namespace psync::tlv {
+
+// TLV-TYPE of the name component carrying a subscription filter in a sync Interest.
+// Classic Bloom filters use GenericNameComponent, for compatibility with older consumers.
+enum : uint32_t {
+  CuckooFilterComponent = 129,
+  XorFilterComponent = 130,
+  // Replaces the three filter components once the producer has cached the filter
+  SubscriptionTokenComponent = 131,
+  BlockedBloomFilterComponent = 132,
+};
+
+} // namespace psync::tlv
+
+namespace psync::detail {
+
+class BloomFilter;
+
+/**
+ * @brief Approximate set of the prefixes a Consumer is subscribed to
+ *
+ * A filter is appended to sync Interests as three name components: the count,
+ * the false positive probability * 1000, and the filter itself, whose TLV-TYPE
+ * identifies the kind of filter (see parseSubscriptionFilter).
+ */
+class SubscriptionFilter
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  virtual
+  ~SubscriptionFilter() = default;
+
+  virtual void
+  appendToName(ndn::Name& name) const = 0;
+
+  /**
+   * @brief Add a key to the filter
+   * @throw Error the filter cannot hold any more keys; it is left unchanged
+   */
+  virtual void
+  insert(const ndn::Name& key) = 0;
+
+  /**
+   * @brief Remove a previously inserted key
+   */
+  virtual void
+  erase(const ndn::Name& key) = 0;
+
+  virtual void
+  clear() = 0;
+
+  virtual bool
+  contains(const ndn::Name& key) const = 0;
+
+  /**
+   * @brief Returns the underlying Bloom filter, or nullptr if this is another kind of filter
+   *
+   * Lets PartialProducer index pending Interests by the bits of their Bloom filters.
+   */
+  virtual const BloomFilter*
+  asBloomFilter() const
+  {
+    return nullptr;
+  }
+};
+
+/**
+ * @brief Create an empty subscription filter
+ *
+ * @param type kind of filter
+ * @param count expected number of keys
+ * @param falsePositive false positive probability
+ * @param isBlocked use the blocked layout, for Bloom filters only
+ */
+std::unique_ptr<SubscriptionFilter>
+makeSubscriptionFilter(SubscriptionFilterType type, unsigned int count, double falsePositive,
+                       bool isBlocked = false);
+
+/**
+ * @brief Construct the filter appended to a name by SubscriptionFilter::appendToName
+ *
+ * The kind of filter is determined by the type of @p component.
+ *
+ * @throw std::exception the filter cannot be decoded
+ */
+std::unique_ptr<SubscriptionFilter>
+parseSubscriptionFilter(unsigned int count, double falsePositive,
+                        const ndn::name::Component& component);
+
+/**
+ * @brief Compute the token identifying a subscription filter
+ *
+ * The token holds the first 8 bytes of the SHA-256 digest of the filter, so that
+ * a filter cannot be crafted to take over the token of another one.
+ *
+ * @param filter the three components appended by SubscriptionFilter::appendToName
+ * @return name component of type tlv::SubscriptionTokenComponent
+ */
+ndn::name::Component
+makeSubscriptionToken(const ndn::Name& filter);
+
+/**
+ * @brief Convert a false positive probability to the value appended to names
+ *
+ * @return @p falsePositive * 1000, rounded down
+ * @throw SubscriptionFilter::Error @p falsePositive is not in [0, 1)
+ */
+uint64_t
+encodeFalsePositive(double falsePositive);
+
+/**
+ * @brief Pack the @p width low-order bits of each value, most significant bit first
+ */
+std::vector<uint8_t>
+packBits(const std::vector<uint16_t>& values, unsigned int width);
+
+/**
+ * @brief Reverse of packBits
+ *
+ * @throw SubscriptionFilter::Error @p bytes does not hold exactly @p count values
+ */
+std::vector<uint16_t>
+unpackBits(ndn::span<const uint8_t> bytes, size_t count, unsigned int width);
+
+/**
+ * @brief Number of bytes packBits produces for @p count values of @p width bits
+ */
+inline uint64_t
+getPackedSize(uint64_t count, unsigned int width)
+{
+  return (count * width + 7) / 8;
+}
+
+} // namespace psync::detail
+
+#endif // PSYNC_DETAIL_SUBSCRIPTION_FILTER_HPP
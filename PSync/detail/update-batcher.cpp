@@ -0,0 +1,124 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/detail/update-batcher.hpp"
+
+#include <ndn-cxx/util/logger.hpp>
+#include <ndn-cxx/util/scope.hpp>
+
+#include <algorithm>
+
+namespace psync::detail {
+
+NDN_LOG_INIT(psync.UpdateBatcher);
+
+UpdateBatcher::UpdateBatcher(ndn::Scheduler& scheduler, UpdateCallback onUpdate,
+                             ndn::time::milliseconds interval, size_t batchSize)
+  : m_scheduler(scheduler)
+  , m_onUpdate(std::move(onUpdate))
+  , m_interval(interval)
+  , m_batchSize(batchSize)
+{
+}
+
+void
+UpdateBatcher::add(const std::vector<MissingDataInfo>& updates)
+{
+  if (updates.empty()) {
+    return;
+  }
+  m_stats.nUpdatesReceived += updates.size();
+
+  if (m_interval <= 0_ms) {
+    deliver(updates, 0_ns);
+    return;
+  }
+
+  if (m_queue.empty()) {
+    m_firstQueuedTime = ndn::time::steady_clock::now();
+    m_flushEvent = m_scheduler.schedule(m_interval, [this] { flush(); });
+  }
+
+  for (const auto& update : updates) {
+    auto [it, isNew] = m_positions.try_emplace(update.prefix, m_queue.size());
+    if (isNew) {
+      m_queue.push_back(update);
+      continue;
+    }
+
+    auto& queued = m_queue[it->second];
+    queued.lowSeq = std::min(queued.lowSeq, update.lowSeq);
+    queued.highSeq = std::max(queued.highSeq, update.highSeq);
+    queued.incomingFace = update.incomingFace;
+    ++m_stats.nUpdatesMerged;
+  }
+
+  m_stats.queueDepth = m_queue.size();
+  m_stats.maxQueueDepth = std::max(m_stats.maxQueueDepth, m_stats.queueDepth);
+
+  if (m_batchSize > 0 && m_queue.size() >= m_batchSize) {
+    flush();
+  }
+}
+
+void
+UpdateBatcher::flush()
+{
+  if (m_queue.empty() || m_isDelivering) {
+    return;
+  }
+
+  m_flushEvent.cancel();
+  auto latency = ndn::time::steady_clock::now() - m_firstQueuedTime;
+
+  // The callback may add updates, which go to the other vector
+  m_delivering.swap(m_queue);
+  m_positions.clear();
+  m_stats.queueDepth = 0;
+
+  m_isDelivering = true;
+  // Reset even if the callback throws, so that the later updates are still delivered
+  auto guard = ndn::make_scope_exit([this] {
+    m_isDelivering = false;
+    m_delivering.clear();
+  });
+  deliver(m_delivering, latency);
+}
+
+void
+UpdateBatcher::clear()
+{
+  m_flushEvent.cancel();
+  m_queue.clear();
+  m_positions.clear();
+  m_stats.queueDepth = 0;
+}
+
+void
+UpdateBatcher::deliver(const std::vector<MissingDataInfo>& updates, ndn::time::nanoseconds latency)
+{
+  NDN_LOG_TRACE("Delivering " << updates.size() << " updates after " << latency);
+
+  ++m_stats.nDeliveries;
+  m_stats.lastFlushLatency = latency;
+  m_stats.maxFlushLatency = std::max(m_stats.maxFlushLatency, latency);
+  m_onUpdate(updates);
+}
+
+} // namespace psync::detail
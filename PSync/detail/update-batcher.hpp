@@ -0,0 +1,104 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PSYNC_DETAIL_UPDATE_BATCHER_HPP
+#define PSYNC_DETAIL_UPDATE_BATCHER_HPP
+
+#include "PSync/common.hpp"
+#include "PSync/detail/access-specifiers.hpp"
+
+#include <ndn-cxx/util/scheduler.hpp>
+
+#include <unordered_map>
+
+namespace psync::detail {
+
+/**
+ * @brief Delivers updates to an UpdateCallback, merging those received close together
+ *
+ * With a zero interval, the updates are delivered as soon as they are added.
+ * Otherwise they wait up to the interval, during which the updates of the same prefix
+ * are merged into a single MissingDataInfo covering all their sequence numbers.
+ * The same two vectors are used for all the deliveries, so delivering does not allocate
+ * once they have grown to the usual batch size.
+ */
+class UpdateBatcher
+{
+public:
+  /**
+   * @param onUpdate callback receiving the updates
+   * @param interval how long updates may wait before they are delivered
+   * @param batchSize deliver as soon as the updates of this many prefixes are waiting;
+   *                  zero for no limit
+   */
+  UpdateBatcher(ndn::Scheduler& scheduler, UpdateCallback onUpdate,
+                ndn::time::milliseconds interval, size_t batchSize);
+
+  /**
+   * @brief Deliver @p updates, or queue them with the updates already waiting
+   */
+  void
+  add(const std::vector<MissingDataInfo>& updates);
+
+  /**
+   * @brief Deliver the waiting updates now
+   *
+   * Does nothing when called from the callback, the updates added meanwhile
+   * are delivered at the end of the interval.
+   */
+  void
+  flush();
+
+  /**
+   * @brief Drop the waiting updates
+   */
+  void
+  clear();
+
+  const UpdateDeliveryStats&
+  getStats() const
+  {
+    return m_stats;
+  }
+
+private:
+  void
+  deliver(const std::vector<MissingDataInfo>& updates, ndn::time::nanoseconds latency);
+
+private:
+  ndn::Scheduler& m_scheduler;
+  UpdateCallback m_onUpdate;
+  ndn::time::milliseconds m_interval;
+  size_t m_batchSize;
+
+  // Waiting updates, one per prefix, and the position of each prefix in m_queue
+  std::vector<MissingDataInfo> m_queue;
+  std::unordered_map<ndn::Name, size_t> m_positions;
+  // Updates being delivered, swapped with m_queue to reuse their storage
+  std::vector<MissingDataInfo> m_delivering;
+  bool m_isDelivering = false;
+
+  ndn::time::steady_clock::time_point m_firstQueuedTime;
+  ndn::scheduler::ScopedEventId m_flushEvent;
+  UpdateDeliveryStats m_stats;
+};
+
+} // namespace psync::detail
+
+#endif // PSYNC_DETAIL_UPDATE_BATCHER_HPP
@@ -46,6 +46,16 @@
   #include <boost/iostreams/filter/zstd.hpp>
 #endif
 
+#include <boost/assert.hpp>
+#include <boost/container/small_vector.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __AVX2__
+  #include <immintrin.h>
+#endif
+
 namespace psync::detail {
 
 static inline uint32_t
@@ -113,11 +123,279 @@ murmurHash3(const void* key, size_t len, uint32_t seed)
   return h1;
 }
 
+static inline uint32_t
+mixK1(uint32_t k1)
+{
+  k1 *= 0xcc9e2d51;
+  k1 = ROTL32(k1, 15);
+  k1 *= 0x1b873593;
+  return k1;
+}
+
+void
+MurmurHash3::update(ndn::span<const uint8_t> bytes) noexcept
+{
+  const uint8_t* data = bytes.data();
+  size_t len = bytes.size();
+  m_len += len;
+
+  auto mixBlock = [this] (const uint8_t* block) {
+    // Native byte order, as murmurHash3()
+    uint32_t k1;
+    std::memcpy(&k1, block, sizeof(k1));
+    m_h1 ^= mixK1(k1);
+    m_h1 = ROTL32(m_h1, 13);
+    m_h1 = m_h1 * 5 + 0xe6546b64;
+  };
+
+  if (m_tailSize > 0) {
+    size_t n = std::min(len, sizeof(m_tail) - m_tailSize);
+    std::memcpy(m_tail + m_tailSize, data, n);
+    m_tailSize += n;
+    data += n;
+    len -= n;
+    if (m_tailSize < sizeof(m_tail)) {
+      return;
+    }
+    mixBlock(m_tail);
+    m_tailSize = 0;
+  }
+
+  for (; len >= sizeof(m_tail); data += sizeof(m_tail), len -= sizeof(m_tail)) {
+    mixBlock(data);
+  }
+
+  std::memcpy(m_tail, data, len);
+  m_tailSize = len;
+}
+
+// Writes the @p size low bytes of @p number to @p buf in network byte order
+static void
+writeBigEndian(uint8_t* buf, uint64_t number, size_t size) noexcept
+{
+  for (size_t i = size; i > 0; --i) {
+    buf[i - 1] = static_cast<uint8_t>(number);
+    number >>= 8;
+  }
+}
+
+size_t
+writeVarNumber(uint8_t* buf, uint64_t number) noexcept
+{
+  if (number < 253) {
+    buf[0] = static_cast<uint8_t>(number);
+    return 1;
+  }
+  if (number <= 0xFFFF) {
+    buf[0] = 253;
+    writeBigEndian(buf + 1, number, 2);
+    return 3;
+  }
+  if (number <= 0xFFFFFFFF) {
+    buf[0] = 254;
+    writeBigEndian(buf + 1, number, 4);
+    return 5;
+  }
+  buf[0] = 255;
+  writeBigEndian(buf + 1, number, 8);
+  return 9;
+}
+
+void
+MurmurHash3::updateVarNumber(uint64_t number) noexcept
+{
+  uint8_t buf[9];
+  update({buf, writeVarNumber(buf, number)});
+}
+
+void
+MurmurHash3::update(const ndn::name::Component& component)
+{
+  if (component.hasWire()) {
+    update({component.data(), component.size()});
+    return;
+  }
+  updateVarNumber(component.type());
+  updateVarNumber(component.value_size());
+  update(component.value_bytes());
+}
+
+void
+MurmurHash3::update(const ndn::Name& name)
+{
+  if (name.hasWire()) {
+    update(name.wireEncode().value_bytes());
+    return;
+  }
+  for (const auto& component : name) {
+    update(component);
+  }
+}
+
+void
+MurmurHash3::updateNumberComponent(uint64_t number) noexcept
+{
+  // NonNegativeInteger encoding, as ndn::encoding::makeNonNegativeIntegerBlock
+  size_t size = number <= 0xFF ? 1 : number <= 0xFFFF ? 2 : number <= 0xFFFFFFFF ? 4 : 8;
+  uint8_t buf[8];
+  writeBigEndian(buf, number, size);
+  updateVarNumber(ndn::tlv::GenericNameComponent);
+  updateVarNumber(size);
+  update({buf, size});
+}
+
+uint32_t
+MurmurHash3::finalize() const noexcept
+{
+  uint32_t h1 = m_h1;
+
+  uint32_t k1 = 0;
+  switch (m_tailSize) {
+    case 3: k1 ^= m_tail[2] << 16;
+            [[fallthrough]];
+    case 2: k1 ^= m_tail[1] << 8;
+            [[fallthrough]];
+    case 1: k1 ^= m_tail[0];
+            h1 ^= mixK1(k1);
+  }
+
+  h1 ^= m_len;
+  h1 ^= h1 >> 16;
+  h1 *= 0x85ebca6b;
+  h1 ^= h1 >> 13;
+  h1 *= 0xc2b2ae35;
+  h1 ^= h1 >> 16;
+
+  return h1;
+}
+
 uint32_t
 murmurHash3(uint32_t seed, const ndn::Name& name)
 {
-  const auto& wire = name.wireEncode();
-  return murmurHash3(wire.value(), wire.value_size(), seed);
+  if (name.hasWire()) {
+    const auto& wire = name.wireEncode();
+    return murmurHash3(wire.value(), wire.value_size(), seed);
+  }
+
+  MurmurHash3 hasher(seed);
+  hasher.update(name);
+  return hasher.finalize();
+}
+
+uint32_t
+murmurHash3(uint32_t seed, const ndn::Name& prefix, uint64_t seq)
+{
+  MurmurHash3 hasher(seed);
+  hasher.update(prefix);
+  hasher.updateNumberComponent(seq);
+  return hasher.finalize();
+}
+
+// Hashes MURMUR_HASH3_LANES seeds at once. The mixed key blocks do not depend on the
+// seed, so each one is computed once and only the hash states are per lane.
+static void
+murmurHash3Lanes(const uint8_t* data, size_t len, const uint32_t* seeds, uint32_t* out) noexcept
+{
+  const size_t nblocks = len / 4;
+  const uint8_t* tail = data + nblocks * 4;
+
+  uint32_t tailK1 = 0;
+  switch (len & 3) {
+    case 3: tailK1 ^= tail[2] << 16;
+            [[fallthrough]];
+    case 2: tailK1 ^= tail[1] << 8;
+            [[fallthrough]];
+    case 1: tailK1 ^= tail[0];
+            tailK1 = mixK1(tailK1);
+  }
+
+#ifdef __AVX2__
+  static_assert(MURMUR_HASH3_LANES == 8);
+  __m256i h1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(seeds));
+  for (size_t i = 0; i < nblocks; i++) {
+    uint32_t k1;
+    std::memcpy(&k1, data + i * 4, sizeof(k1));
+    h1 = _mm256_xor_si256(h1, _mm256_set1_epi32(static_cast<int>(mixK1(k1))));
+    h1 = _mm256_or_si256(_mm256_slli_epi32(h1, 13), _mm256_srli_epi32(h1, 19));
+    h1 = _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(h1, 2), h1),
+                          _mm256_set1_epi32(static_cast<int>(0xe6546b64)));
+  }
+  h1 = _mm256_xor_si256(h1, _mm256_set1_epi32(static_cast<int>(tailK1 ^ static_cast<uint32_t>(len))));
+  h1 = _mm256_xor_si256(h1, _mm256_srli_epi32(h1, 16));
+  h1 = _mm256_mullo_epi32(h1, _mm256_set1_epi32(static_cast<int>(0x85ebca6b)));
+  h1 = _mm256_xor_si256(h1, _mm256_srli_epi32(h1, 13));
+  h1 = _mm256_mullo_epi32(h1, _mm256_set1_epi32(static_cast<int>(0xc2b2ae35)));
+  h1 = _mm256_xor_si256(h1, _mm256_srli_epi32(h1, 16));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), h1);
+#else
+  // Fixed-count loops over the lanes, which compilers turn into SSE2 or NEON code
+  uint32_t h1[MURMUR_HASH3_LANES];
+  std::copy_n(seeds, MURMUR_HASH3_LANES, h1);
+  for (size_t i = 0; i < nblocks; i++) {
+    uint32_t k1;
+    std::memcpy(&k1, data + i * 4, sizeof(k1));
+    k1 = mixK1(k1);
+    for (size_t lane = 0; lane < MURMUR_HASH3_LANES; lane++) {
+      h1[lane] ^= k1;
+      h1[lane] = ROTL32(h1[lane], 13);
+      h1[lane] = h1[lane] * 5 + 0xe6546b64;
+    }
+  }
+  for (size_t lane = 0; lane < MURMUR_HASH3_LANES; lane++) {
+    uint32_t h = h1[lane] ^ tailK1 ^ static_cast<uint32_t>(len);
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    out[lane] = h;
+  }
+#endif
+}
+
+void
+murmurHash3xN(const void* key, size_t len, ndn::span<const uint32_t> seeds,
+              ndn::span<uint32_t> hashes) noexcept
+{
+  BOOST_ASSERT(hashes.size() >= seeds.size());
+  const uint8_t* data = static_cast<const uint8_t*>(key);
+
+  size_t i = 0;
+  for (; i + MURMUR_HASH3_LANES <= seeds.size(); i += MURMUR_HASH3_LANES) {
+    murmurHash3Lanes(data, len, &seeds[i], &hashes[i]);
+  }
+  if (i < seeds.size()) {
+    uint32_t laneSeeds[MURMUR_HASH3_LANES] = {};
+    uint32_t laneHashes[MURMUR_HASH3_LANES];
+    std::copy(seeds.begin() + i, seeds.end(), laneSeeds);
+    murmurHash3Lanes(data, len, laneSeeds, laneHashes);
+    std::copy_n(laneHashes, seeds.size() - i, hashes.begin() + i);
+  }
+}
+
+void
+murmurHash3xN(const ndn::Name& name, ndn::span<const uint32_t> seeds, ndn::span<uint32_t> hashes)
+{
+  if (name.hasWire()) {
+    const auto& wire = name.wireEncode();
+    murmurHash3xN(wire.value(), wire.value_size(), seeds, hashes);
+    return;
+  }
+
+  // The TLV-VALUE of the Name, on the stack for most Names
+  boost::container::small_vector<uint8_t, 256> value;
+  for (const auto& component : name) {
+    if (component.hasWire()) {
+      value.insert(value.end(), component.data(), component.data() + component.size());
+      continue;
+    }
+    uint8_t buf[18];
+    size_t size = writeVarNumber(buf, component.type());
+    size += writeVarNumber(buf + size, component.value_size());
+    value.insert(value.end(), buf, buf + size);
+    value.insert(value.end(), component.value_begin(), component.value_end());
+  }
+  murmurHash3xN(value.data(), value.size(), seeds, hashes);
 }
 
 std::shared_ptr<ndn::Buffer>
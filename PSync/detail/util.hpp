@@ -30,18 +30,118 @@ namespace psync::detail {
 uint32_t
 murmurHash3(const void* key, size_t len, uint32_t seed);
 
+/**
+ * @brief Write the TLV VAR-NUMBER encoding of @p number to @p buf
+ *
+ * @param buf must have room for 9 octets
+ * @return the number of octets written
+ */
+size_t
+writeVarNumber(uint8_t* buf, uint64_t number) noexcept;
+
+/**
+ * @brief Incremental 32-bit MurmurHash3
+ *
+ * Bytes fed in any number of pieces hash to the same value as murmurHash3() of their
+ * concatenation, so Names can be hashed component by component without being encoded.
+ */
+class MurmurHash3
+{
+public:
+  explicit
+  MurmurHash3(uint32_t seed) noexcept
+    : m_h1(seed)
+  {
+  }
+
+  void
+  update(ndn::span<const uint8_t> bytes) noexcept;
+
+  /**
+   * @brief Feed the TLV of @p component, its cached wire if it has one
+   */
+  void
+  update(const ndn::name::Component& component);
+
+  /**
+   * @brief Feed the TLV-VALUE of @p name, its cached wire if it has one
+   */
+  void
+  update(const ndn::Name& name);
+
+  /**
+   * @brief Feed the TLV of the component that ndn::Name::appendNumber(@p number) appends
+   */
+  void
+  updateNumberComponent(uint64_t number) noexcept;
+
+  uint32_t
+  finalize() const noexcept;
+
+private:
+  void
+  updateVarNumber(uint64_t number) noexcept;
+
+private:
+  uint32_t m_h1;
+  size_t m_len = 0;
+  // bytes not yet mixed, fewer than a block
+  uint8_t m_tail[4] = {};
+  size_t m_tailSize = 0;
+};
+
 /**
  * @brief Compute 32-bit MurmurHash3 of Name TLV-VALUE.
+ *
+ * The Name is not encoded if it has no wire yet.
  */
 uint32_t
 murmurHash3(uint32_t seed, const ndn::Name& name);
 
+/**
+ * @brief Compute 32-bit MurmurHash3 of the TLV-VALUE of @p prefix with @p seq appended,
+ *        without making that Name
+ *
+ * Equal to murmurHash3(seed, ndn::Name(prefix).appendNumber(seq)).
+ */
+uint32_t
+murmurHash3(uint32_t seed, const ndn::Name& prefix, uint64_t seq);
+
 inline uint32_t
 murmurHash3(uint32_t seed, uint32_t value)
 {
   return murmurHash3(&value, sizeof(value), seed);
 }
 
+/**
+ * @brief Number of seeds that murmurHash3xN() hashes together
+ */
+inline constexpr size_t MURMUR_HASH3_LANES = 8;
+
+/**
+ * @brief Compute 32-bit MurmurHash3 of @p key with each of @p seeds
+ *
+ * Gives the same values as murmurHash3(key, len, seed) for each seed, but the key is
+ * read once for up to MURMUR_HASH3_LANES seeds, which are hashed in SIMD lanes.
+ *
+ * @param hashes receives the hash of each seed, must be at least as long as @p seeds
+ */
+void
+murmurHash3xN(const void* key, size_t len, ndn::span<const uint32_t> seeds,
+              ndn::span<uint32_t> hashes) noexcept;
+
+/**
+ * @brief Compute 32-bit MurmurHash3 of Name TLV-VALUE with each of @p seeds
+ */
+void
+murmurHash3xN(const ndn::Name& name, ndn::span<const uint32_t> seeds, ndn::span<uint32_t> hashes);
+
+inline void
+murmurHash3xN(uint32_t value, ndn::span<const uint32_t> seeds, ndn::span<uint32_t> hashes) noexcept
+{
+  murmurHash3xN(&value, sizeof(value), seeds, hashes);
+}
+
 std::shared_ptr<ndn::Buffer>
 compress(CompressionScheme scheme, ndn::span<const uint8_t> buffer);
 
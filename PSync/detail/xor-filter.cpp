@@ -0,0 +1,279 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/detail/xor-filter.hpp"
+#include "PSync/detail/util.hpp"
+
+#include <ndn-cxx/util/exception.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace psync::detail {
+
+static constexpr uint32_t HASH_HIGH_SEED = 0x9E3779B9;
+static constexpr uint32_t HASH_LOW_SEED = 0x7F4A7C15;
+static constexpr uint64_t INITIAL_SEED = 0x726B2B9D438B9D4DULL;
+static constexpr unsigned int MAX_BUILD_ATTEMPTS = 100;
+static constexpr size_t SEED_SIZE = sizeof(uint64_t);
+
+static uint64_t
+hashKey(const ndn::Name& key)
+{
+  return (static_cast<uint64_t>(murmurHash3(HASH_HIGH_SEED, key)) << 32) |
+         murmurHash3(HASH_LOW_SEED, key);
+}
+
+/**
+ * @brief MurmurHash3 64-bit finalizer of @p h + @p seed, a bijection
+ */
+static uint64_t
+mix(uint64_t h, uint64_t seed)
+{
+  h += seed;
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+static uint64_t
+rotateLeft(uint64_t x, unsigned int n)
+{
+  return (x << n) | (x >> (64 - n));
+}
+
+static unsigned int
+computeFingerprintSize(uint64_t falsePositive1000)
+{
+  if (falsePositive1000 == 0) {
+    return 16;
+  }
+  // A lookup matches a fingerprint with probability 2^-size
+  auto size = std::ceil(std::log2(1000.0 / falsePositive1000));
+  return std::clamp(static_cast<unsigned int>(size), 1U, 16U);
+}
+
+static size_t
+getCapacity(size_t nKeys)
+{
+  size_t capacity = 32 + static_cast<size_t>(std::ceil(1.23 * nKeys));
+  // Three segments of equal length
+  return capacity + (3 - capacity % 3) % 3;
+}
+
+/**
+ * @brief Positions of the three entries whose xor is the fingerprint of @p h, one per segment
+ */
+static std::array<size_t, 3>
+getPositions(uint64_t h, size_t segmentLength)
+{
+  auto reduce = [segmentLength] (uint64_t x) {
+    return static_cast<size_t>(((x & 0xFFFFFFFF) * segmentLength) >> 32);
+  };
+  return {reduce(h),
+          segmentLength + reduce(rotateLeft(h, 21)),
+          2 * segmentLength + reduce(rotateLeft(h, 42))};
+}
+
+static uint16_t
+getFingerprint(uint64_t h, unsigned int size)
+{
+  return static_cast<uint16_t>((h ^ (h >> 32)) & ((1U << size) - 1));
+}
+
+XorFilter::XorFilter(unsigned int, double falsePositive)
+  : m_falsePositive1000(encodeFalsePositive(falsePositive))
+  , m_fingerprintSize(computeFingerprintSize(m_falsePositive1000))
+{
+}
+
+XorFilter::XorFilter(unsigned int count, double falsePositive,
+                     const ndn::name::Component& component)
+  : m_falsePositive1000(encodeFalsePositive(falsePositive))
+  , m_fingerprintSize(computeFingerprintSize(m_falsePositive1000))
+  , m_isFromName(true)
+  , m_isStale(false)
+  , m_nKeys(count)
+{
+  // Checked before allocating, the count comes from the network
+  size_t capacity = getCapacity(count);
+  if (component.type() != tlv::XorFilterComponent ||
+      component.value_size() != SEED_SIZE + getPackedSize(capacity, m_fingerprintSize)) {
+    NDN_THROW(Error("Xor filter cannot be decoded!"));
+  }
+
+  const uint8_t* value = component.value();
+  for (size_t i = 0; i < SEED_SIZE; ++i) {
+    m_seed = (m_seed << 8) | value[i];
+  }
+  m_fingerprints = unpackBits({value + SEED_SIZE, component.value_size() - SEED_SIZE},
+                              capacity, m_fingerprintSize);
+}
+
+void
+XorFilter::appendToName(ndn::Name& name) const
+{
+  build();
+
+  std::vector<uint8_t> value;
+  value.reserve(SEED_SIZE + getPackedSize(m_fingerprints.size(), m_fingerprintSize));
+  for (size_t i = 0; i < SEED_SIZE; ++i) {
+    value.push_back(static_cast<uint8_t>(m_seed >> (8 * (SEED_SIZE - 1 - i))));
+  }
+  auto table = packBits(m_fingerprints, m_fingerprintSize);
+  value.insert(value.end(), table.begin(), table.end());
+
+  name.appendNumber(m_nKeys);
+  name.appendNumber(m_falsePositive1000);
+  name.append(ndn::name::Component(tlv::XorFilterComponent, value));
+}
+
+void
+XorFilter::insert(const ndn::Name& key)
+{
+  checkModifiable();
+  ++m_keys[hashKey(key)];
+  m_isStale = true;
+}
+
+void
+XorFilter::erase(const ndn::Name& key)
+{
+  checkModifiable();
+  auto it = m_keys.find(hashKey(key));
+  if (it == m_keys.end()) {
+    return;
+  }
+  if (--it->second == 0) {
+    m_keys.erase(it);
+  }
+  m_isStale = true;
+}
+
+void
+XorFilter::clear()
+{
+  m_isFromName = false;
+  m_keys.clear();
+  m_isStale = true;
+}
+
+bool
+XorFilter::contains(const ndn::Name& key) const
+{
+  build();
+
+  uint64_t h = mix(hashKey(key), m_seed);
+  auto pos = getPositions(h, m_fingerprints.size() / 3);
+  return getFingerprint(h, m_fingerprintSize) ==
+         (m_fingerprints[pos[0]] ^ m_fingerprints[pos[1]] ^ m_fingerprints[pos[2]]);
+}
+
+void
+XorFilter::build() const
+{
+  if (!m_isStale) {
+    return;
+  }
+
+  const size_t capacity = getCapacity(m_keys.size());
+  const size_t segmentLength = capacity / 3;
+  // Number of keys mapped to each entry and xor of their hashes
+  std::vector<uint32_t> counts(capacity);
+  std::vector<uint64_t> xors(capacity);
+  std::vector<size_t> queue;
+  // Hash of each key with the entry it was peeled from, in peeling order
+  std::vector<std::pair<uint64_t, size_t>> peeled;
+  peeled.reserve(m_keys.size());
+
+  auto peel = [&] (uint64_t seed) {
+    std::fill(counts.begin(), counts.end(), 0);
+    std::fill(xors.begin(), xors.end(), 0);
+    peeled.clear();
+
+    for (const auto& item : m_keys) {
+      uint64_t h = mix(item.first, seed);
+      for (auto pos : getPositions(h, segmentLength)) {
+        ++counts[pos];
+        xors[pos] ^= h;
+      }
+    }
+
+    for (size_t pos = 0; pos < capacity; ++pos) {
+      if (counts[pos] == 1) {
+        queue.push_back(pos);
+      }
+    }
+
+    // Repeatedly remove a key that is alone in one of its entries
+    while (!queue.empty()) {
+      size_t i = queue.back();
+      queue.pop_back();
+      if (counts[i] != 1) {
+        continue;
+      }
+
+      uint64_t h = xors[i];
+      peeled.emplace_back(h, i);
+      for (auto pos : getPositions(h, segmentLength)) {
+        xors[pos] ^= h;
+        if (--counts[pos] == 1) {
+          queue.push_back(pos);
+        }
+      }
+    }
+
+    return peeled.size() == m_keys.size();
+  };
+
+  uint64_t seed = INITIAL_SEED;
+  for (unsigned int attempt = 1; !peel(seed); ++attempt) {
+    if (attempt == MAX_BUILD_ATTEMPTS) {
+      NDN_THROW(Error("Xor filter cannot be built"));
+    }
+    seed = mix(INITIAL_SEED, attempt);
+  }
+
+  // In reverse peeling order, the entry a key was peeled from is not used by any later key
+  m_fingerprints.assign(capacity, 0);
+  for (auto it = peeled.rbegin(); it != peeled.rend(); ++it) {
+    auto [h, i] = *it;
+    auto pos = getPositions(h, segmentLength);
+    m_fingerprints[i] = getFingerprint(h, m_fingerprintSize) ^
+                        m_fingerprints[pos[0]] ^ m_fingerprints[pos[1]] ^ m_fingerprints[pos[2]];
+  }
+
+  m_nKeys = m_keys.size();
+  m_seed = seed;
+  m_isStale = false;
+}
+
+void
+XorFilter::checkModifiable() const
+{
+  if (m_isFromName) {
+    NDN_THROW(Error("Cannot modify a xor filter decoded from a name"));
+  }
+}
+
+} // namespace psync::detail
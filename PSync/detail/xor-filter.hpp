@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PSYNC_DETAIL_XOR_FILTER_HPP
+#define PSYNC_DETAIL_XOR_FILTER_HPP
+
+#include "PSync/detail/subscription-filter.hpp"
+
+#include <map>
+#include <vector>
+
+namespace psync::detail {
+
+/**
+ * @brief Xor filter, a static filter taking about 1.23 fingerprints per key
+ *
+ * The fingerprint of a key is the xor of three table entries. The table can only be
+ * computed from the whole set of keys, so a filter built locally keeps the hashes of
+ * its keys and recomputes the table when it is needed after a change.
+ *
+ * Based on T. M. Graf and D. Lemire, "Xor Filters: Faster and Smaller Than Bloom and
+ * Cuckoo Filters", ACM JEA 2020.
+ */
+class XorFilter : public SubscriptionFilter
+{
+public:
+  /**
+   * @param count unused, the table is sized after the keys actually inserted
+   * @param falsePositive false positive probability
+   */
+  XorFilter(unsigned int count, double falsePositive);
+
+  /**
+   * @brief Construct a copy of a xor filter appended to a name by appendToName
+   *
+   * Keys cannot be inserted into or erased from such a copy.
+   */
+  XorFilter(unsigned int count, double falsePositive, const ndn::name::Component& component);
+
+  /**
+   * @brief Append the number of keys, the false positive probability, and the table
+   *
+   * The seed and the table are appended as a name component of type tlv::XorFilterComponent.
+   */
+  void
+  appendToName(ndn::Name& name) const final;
+
+  void
+  insert(const ndn::Name& key) final;
+
+  void
+  erase(const ndn::Name& key) final;
+
+  void
+  clear() final;
+
+  bool
+  contains(const ndn::Name& key) const final;
+
+  unsigned int
+  getFingerprintSize() const
+  {
+    return m_fingerprintSize;
+  }
+
+private:
+  /**
+   * @brief Recompute the table from m_keys if they have changed
+   */
+  void
+  build() const;
+
+  void
+  checkModifiable() const;
+
+private:
+  uint64_t m_falsePositive1000;
+  unsigned int m_fingerprintSize;
+  bool m_isFromName = false;
+  // Hash of each inserted key => number of times it has been inserted
+  std::map<uint64_t, uint32_t> m_keys;
+
+  mutable bool m_isStale = true;
+  // Number of keys, seed and table of the last build
+  mutable size_t m_nKeys = 0;
+  mutable uint64_t m_seed = 0;
+  mutable std::vector<uint16_t> m_fingerprints;
+};
+
+} // namespace psync::detail
+
+#endif // PSYNC_DETAIL_XOR_FILTER_HPP
@@ -25,6 +25,7 @@
 #include <ndn-cxx/security/validator-null.hpp>
 #include <ndn-cxx/util/logger.hpp>
 
+#include <algorithm>
 #include <cstring>
 
 namespace psync {
@@ -39,7 +40,13 @@ FullProducer::FullProducer(ndn::Face& face,
                  opts.ibfCompression, opts.contentCompression)
   , m_syncInterestLifetime(opts.syncInterestLifetime)
   , m_onUpdate(opts.onUpdate)
+  , m_updateBatcher(m_scheduler, [this] (const auto& updates) { m_onUpdate(updates); },
+                    opts.updateBatchInterval, opts.updateBatchSize)
 {
+  if (!opts.prefixTableFile.empty()) {
+    usePrefixTableFile(opts.prefixTableFile, opts.prefixTableCapacity);
+  }
+
   m_registeredPrefix = m_face.setInterestFilter(ndn::InterestFilter(m_syncPrefix).allowLoopback(false),
     [this] (auto&&... args) { onSyncInterest(std::forward<decltype(args)>(args)...); },
     [] (auto&&... args) { onRegisterFailed(std::forward<decltype(args)>(args)...); });
@@ -76,12 +83,13 @@ FullProducer::~FullProducer()
 void
 FullProducer::publishName(const ndn::Name& prefix, std::optional<uint64_t> seq)
 {
-  if (m_prefixes.find(prefix) == m_prefixes.end()) {
+  auto oldSeq = getSeqNo(prefix);
+  if (!oldSeq) {
     NDN_LOG_WARN("Prefix not added: " << prefix);
     return;
   }
 
-  uint64_t newSeq = seq.value_or(m_prefixes[prefix] + 1);
+  uint64_t newSeq = seq.value_or(*oldSeq + 1);
   NDN_LOG_INFO("Publish: " << prefix << "/" << newSeq);
   updateSeqNo(prefix, newSeq);
 
@@ -216,8 +224,17 @@ FullProducer::scheduleProcessWaitingInterests()
     auto after = ndn::time::milliseconds(m_jitter(m_rng));
     NDN_LOG_TRACE("Setting a timer to processes waiting Interest(s) in: " << after);
 
+    auto deadline = ndn::time::steady_clock::now() + after;
     m_interestDelayTimerId = m_scheduler.schedule(after, [=] {
       NDN_LOG_TRACE("Timer has expired, trying to process waiting Interest(s)");
+      if (m_tracer != nullptr) {
+        auto now = ndn::time::steady_clock::now();
+        for (const auto& waiting : m_waitingForProcessing) {
+          auto tag = std::hash<ndn::Name>{}(waiting.first);
+          m_tracer->begin(TraceStage::QUEUEING, tag, deadline);
+          m_tracer->end(TraceStage::QUEUEING, tag, now);
+        }
+      }
       processWaitingInterests();
       scheduleProcessWaitingInterests();
     });
@@ -237,7 +254,8 @@ FullProducer::onSyncInterest(const ndn::Name& prefixName, const ndn::Interest& i
     NDN_LOG_TRACE("Delayed Interest being processed now");
   }
 
-  if (m_segmentPublisher.replyFromStore(interestName)) {
+  // Interests processed again were counted when they were received
+  if (replyFromStore(interestName, false, !isTimedProcessing)) {
     NDN_LOG_DEBUG("Answer from memory");
     return;
   }
@@ -262,6 +280,7 @@ FullProducer::onSyncInterest(const ndn::Name& prefixName, const ndn::Interest& i
 
   detail::IBLT iblt(m_expectedNumEntries, m_ibltCompression);
   try {
+    TraceScope trace(m_tracer, TraceStage::IBF_DECOMPRESS, interestNameHash);
     iblt.initialize(ibltName);
   }
   catch (const std::exception& e) {
@@ -269,7 +288,7 @@ FullProducer::onSyncInterest(const ndn::Name& prefixName, const ndn::Interest& i
     return;
   }
 
-  auto diff = m_iblt - iblt;
+  auto diff = decodeDifference(iblt, interestNameHash, !isTimedProcessing);
 
   NDN_LOG_TRACE("Decode, positive: " << diff.positive.size()
                 << " negative: " << diff.negative.size() << " m_threshold: "
@@ -311,11 +330,11 @@ FullProducer::onSyncInterest(const ndn::Name& prefixName, const ndn::Interest& i
       }
 
       detail::State state;
-      for (const auto& content : m_prefixes) {
-        if (content.second != 0) {
-          state.addContent(ndn::Name(content.first).appendNumber(content.second));
+      forEachPrefix([&state] (const ndn::Name& prefix, uint64_t seq) {
+        if (seq != 0) {
+          state.addContent(ndn::Name(prefix).appendNumber(seq));
         }
-      }
+      });
 #ifdef PSYNC_WITH_TESTS
             ++nIbfDecodeFailuresAboveThreshold;
 #endif // PSYNC_WITH_TESTS
@@ -323,7 +342,7 @@ FullProducer::onSyncInterest(const ndn::Name& prefixName, const ndn::Interest& i
       if (!state.getContent().empty()) {
         NDN_LOG_DEBUG("Sending entire state: " << state);
         // Want low freshness when potentially sending large content to clear it quickly from the network
-        sendSyncData(interestName, state.wireEncode(), 10_ms);
+        sendSyncData(interestName, encodeState(state, interestNameHash), 10_ms, true);
         // Since we're directly sending the data, we need to clear pending interests here
         deletePendingInterests(interestName);
       }
@@ -382,20 +401,16 @@ FullProducer::onSyncInterest(const ndn::Name& prefixName, const ndn::Interest& i
   if (diff.positive.size() > 0) {
     detail::State state;
     for (const auto& hash : diff.positive) {
-      auto nameIt = m_biMap.left.find(hash);
-      if (nameIt != m_biMap.left.end()) {
-        ndn::Name nameWithoutSeq = nameIt->second.getPrefix(-1);
-        // Don't sync up sequence number zero
-        if (m_prefixes[nameWithoutSeq] != 0 &&
-            !isFutureHash(nameWithoutSeq.toUri(), diff.negative)) {
-          state.addContent(nameIt->second);
-        }
+      auto name = findNameByHash(hash);
+      // Sequence number zero has no IBF key, so it is never synced up
+      if (name && !isFutureHash(hash, diff.negative)) {
+        state.addContent(*name);
       }
     }
 
     if (!state.getContent().empty()) {
       NDN_LOG_DEBUG("Sending sync content: " << state);
-      sendSyncData(interestName, state.wireEncode(), m_syncReplyFreshness);
+      sendSyncData(interestName, encodeState(state, interestNameHash), m_syncReplyFreshness);
 
       // Timed processing or not - if we are answering it, it should not go in waiting Interests
       if (waitingIt != m_waitingForProcessing.end()) {
@@ -407,7 +422,7 @@ FullProducer::onSyncInterest(const ndn::Name& prefixName, const ndn::Interest& i
 
 void
 FullProducer::sendSyncData(const ndn::Name& name, const ndn::Block& block,
-                           ndn::time::milliseconds syncReplyFreshness)
+                           ndn::time::milliseconds syncReplyFreshness, bool isFullState)
 {
   bool isSatisfyingOwnInterest = m_outstandingInterestName == name;
   if (isSatisfyingOwnInterest && m_fetcher) {
@@ -417,8 +432,17 @@ FullProducer::sendSyncData(const ndn::Name& name, const ndn::Block& block,
   }
 
   NDN_LOG_DEBUG("Sending sync Data");
-  auto content = detail::compress(m_contentCompression, block);
-  m_segmentPublisher.publish(name, name, *content, syncReplyFreshness);
+  auto tag = getTraceTag(name);
+  ndn::ConstBufferPtr content;
+  {
+    TraceScope trace(m_tracer, TraceStage::CONTENT_COMPRESS, tag);
+    content = detail::compress(m_contentCompression, block);
+  }
+  {
+    TraceScope trace(m_tracer, TraceStage::SEGMENT_PUBLISH, tag);
+    m_segmentPublisher.publish(name, name, *content, syncReplyFreshness);
+  }
+  recordReply(content->size(), block.size(), isFullState);
   if (isSatisfyingOwnInterest) {
     NDN_LOG_DEBUG("Renewing sync interest");
     sendSyncInterest();
@@ -447,8 +471,19 @@ FullProducer::onSyncData(const ndn::Interest& interest, const ndn::ConstBufferPt
     ndn::Name prefix = content.getPrefix(-1);
     uint64_t seq = content.get(content.size() - 1).toNumber();
 
-    if (m_prefixes.find(prefix) == m_prefixes.end() || m_prefixes[prefix] < seq) {
-      updates.push_back({prefix, m_prefixes[prefix] + 1, seq, m_incomingFace});
+    auto oldSeq = getSeqNo(prefix);
+    if (!oldSeq || *oldSeq < seq) {
+      if (!oldSeq) {
+        try {
+          addUserNode(prefix);
+        }
+        catch (const Error& e) {
+          // The prefix table cannot grow, a later sync Data may bring the prefix again
+          NDN_LOG_ERROR("Cannot add " << prefix << ": " << e.what());
+          continue;
+        }
+      }
+      updates.push_back({prefix, oldSeq.value_or(0) + 1, seq, m_incomingFace});
       updateSeqNo(prefix, seq);
       // We should not call satisfyPendingSyncInterests here because we just
       // got data and deleted pending interest by calling deletePendingFullSyncInterests
@@ -458,7 +493,7 @@ FullProducer::onSyncData(const ndn::Interest& interest, const ndn::ConstBufferPt
   }
 
   if (!updates.empty()) {
-    m_onUpdate(updates);
+    m_updateBatcher.add(updates);
     // Wait a bit to let neighbors get the data too
     auto after = ndn::time::milliseconds(m_jitter(m_rng));
     m_scheduledSyncInterestId = m_scheduler.schedule(after, [this] {
@@ -494,20 +529,21 @@ FullProducer::satisfyPendingInterests(const ndn::Name& updatedPrefixWithSeq)
 
   for (auto it = m_pendingEntries.begin(); it != m_pendingEntries.end();) {
     NDN_LOG_TRACE("Satisfying pending Interest: " << std::hash<ndn::Name>{}(it->first.getPrefix(-1)));
+    auto tag = getTraceTag(it->first);
     const auto& entry = it->second;
-    auto diff = m_iblt - entry.iblt;
+    auto diff = decodeDifference(entry.iblt, tag);
     NDN_LOG_TRACE("Decoded: " << diff.canDecode << " positive: " << diff.positive.size() <<
                   " negative: " << diff.negative.size());
 
     detail::State state;
     bool publishedPrefixInDiff = false;
     for (const auto& hash : diff.positive) {
-      auto nameIt = m_biMap.left.find(hash);
-      if (nameIt != m_biMap.left.end()) {
-        if (updatedPrefixWithSeq == nameIt->second) {
+      auto name = findNameByHash(hash);
+      if (name) {
+        if (updatedPrefixWithSeq == *name) {
           publishedPrefixInDiff = true;
         }
-        state.addContent(nameIt->second);
+        state.addContent(*name);
       }
     }
 
@@ -516,17 +552,16 @@ FullProducer::satisfyPendingInterests(const ndn::Name& updatedPrefixWithSeq)
     }
 
     NDN_LOG_DEBUG("Satisfying sync content: " << state);
-    sendSyncData(it->first, state.wireEncode(), m_syncReplyFreshness);
+    sendSyncData(it->first, encodeState(state, tag), m_syncReplyFreshness);
     it = m_pendingEntries.erase(it);
   }
 }
 
 bool
-FullProducer::isFutureHash(const ndn::Name& prefix, const std::set<uint32_t>& negative)
+FullProducer::isFutureHash(uint32_t hash, const detail::IBLTDiff::Keys& negative) const
 {
-  auto nextHash = detail::murmurHash3(detail::N_HASHCHECK,
-                                      ndn::Name(prefix).appendNumber(m_prefixes[prefix] + 1));
-  return negative.find(nextHash) != negative.end();
+  auto nextHash = getNextSeqHash(hash);
+  return nextHash && std::binary_search(negative.begin(), negative.end(), *nextHash);
 }
 
 void
@@ -21,6 +21,7 @@
 #define PSYNC_FULL_PRODUCER_HPP
 
 #include "PSync/producer-base.hpp"
+#include "PSync/detail/update-batcher.hpp"
 
 #include <random>
 #include <set>
@@ -58,6 +59,24 @@ public:
     ndn::time::milliseconds syncDataFreshness = SYNC_REPLY_FRESHNESS;
     /// Compression scheme to use for Data content.
     CompressionScheme contentCompression = CompressionScheme::DEFAULT;
+    /**
+     * @brief How long updates may wait before UpdateCallback is called.
+     *
+     * The updates received meanwhile are merged, one MissingDataInfo per prefix.
+     * Zero calls UpdateCallback for each sync Data.
+     */
+    ndn::time::milliseconds updateBatchInterval = 0_ms;
+    /// Call UpdateCallback before updateBatchInterval once updates of this many prefixes wait; zero for no limit.
+    size_t updateBatchSize = 0;
+    /**
+     * @brief File in which to keep the prefixes, memory-mapped, instead of on the heap.
+     *
+     * For sync groups with millions of prefixes. If the file exists, its prefixes are restored.
+     * Empty keeps the prefixes on the heap.
+     */
+    std::string prefixTableFile;
+    /// Number of prefixes the prefix table file can hold, if it is created.
+    size_t prefixTableCapacity = 1000000;
   };
 
   /**
@@ -101,6 +120,24 @@ public:
   void
   publishName(const ndn::Name& prefix, std::optional<uint64_t> seq = std::nullopt);
 
+  const UpdateDeliveryStats&
+  getUpdateDeliveryStats() const
+  {
+    return m_updateBatcher.getStats();
+  }
+
+  /**
+   * @brief Returns the counters of this producer since it was created
+   */
+  ProducerStats
+  getStats() const
+  {
+    auto stats = m_stats;
+    stats.nPendingInterests = m_pendingEntries.size();
+    stats.nWaitingInterests = m_waitingForProcessing.size();
+    return stats;
+  }
+
 PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
   /**
    * @brief Send sync interest for full synchronization
@@ -147,10 +184,11 @@ PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
    * @param name name to be set as data name
    * @param block the content of the data
    * @param syncReplyFreshness the freshness to use for the sync data; defaults to @p SYNC_REPLY_FRESHNESS
+   * @param isFullState whether @p block holds the whole state, for the statistics
    */
   void
   sendSyncData(const ndn::Name& name, const ndn::Block& block,
-               ndn::time::milliseconds syncReplyFreshness);
+               ndn::time::milliseconds syncReplyFreshness, bool isFullState = false);
 
   /**
    * @brief Process sync data
@@ -170,7 +208,7 @@ PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
   void
   onSyncData(const ndn::Interest& interest, const ndn::ConstBufferPtr& bufferPtr);
 
-private:
+PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
   /**
    * @brief Satisfy pending sync interests
    *
@@ -189,14 +227,18 @@ private:
   void
   deletePendingInterests(const ndn::Name& interestName);
 
+PSYNC_PUBLIC_WITH_TESTS_ELSE_PROTECTED:
   /**
-   * @brief Check if hash(prefix + 1) is in negative
+   * @brief Check if the IBF key of the next sequence number after @p hash is in negative
    *
    * Sometimes what happens is that interest from other side
    * gets to us before the data
+   *
+   * @param hash IBF key of one of our prefix/seq
+   * @param negative sorted keys, as in detail::IBLTDiff
    */
   bool
-  isFutureHash(const ndn::Name& prefix, const std::set<uint32_t>& negative);
+  isFutureHash(uint32_t hash, const detail::IBLTDiff::Keys& negative) const;
 
 #ifdef PSYNC_WITH_TESTS
 public:
@@ -219,6 +261,7 @@ private:
 
   ndn::time::milliseconds m_syncInterestLifetime;
   UpdateCallback m_onUpdate;
+  detail::UpdateBatcher m_updateBatcher;
   ndn::scheduler::ScopedEventId m_scheduledSyncInterestId;
   static constexpr int MIN_JITTER = 100;
   static constexpr int MAX_JITTER = 500;
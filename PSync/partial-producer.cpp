@@ -19,6 +19,7 @@
 
 #include "PSync/partial-producer.hpp"
 #include "PSync/detail/state.hpp"
+#include "PSync/detail/util.hpp"
 
 #include <ndn-cxx/util/logger.hpp>
 
@@ -37,8 +38,13 @@ PartialProducer::PartialProducer(ndn::Face& face,
                                  const Options& opts)
   : ProducerBase(face, keyChain, opts.ibfCount, syncPrefix, opts.syncDataFreshness,
                  opts.ibfCompression, CompressionScheme::NONE)
+  , m_subscriptionTokenCacheSize(opts.subscriptionTokenCacheSize)
   , m_helloReplyFreshness(opts.helloDataFreshness)
 {
+  if (!opts.prefixTableFile.empty()) {
+    usePrefixTableFile(opts.prefixTableFile, opts.prefixTableCapacity);
+  }
+
   m_registeredPrefix = m_face.registerPrefix(m_syncPrefix,
     [this] (const auto&) {
       m_face.setInterestFilter(ndn::Name(m_syncPrefix).append(HELLO),
@@ -67,11 +73,12 @@ PartialProducer::PartialProducer(ndn::Face& face,
 void
 PartialProducer::publishName(const ndn::Name& prefix, std::optional<uint64_t> seq)
 {
-  if (m_prefixes.find(prefix) == m_prefixes.end()) {
+  auto oldSeq = getSeqNo(prefix);
+  if (!oldSeq) {
     return;
   }
 
-  uint64_t newSeq = seq.value_or(m_prefixes[prefix] + 1);
+  uint64_t newSeq = seq.value_or(*oldSeq + 1);
   NDN_LOG_INFO("Publish: " << prefix << "/" << newSeq);
   updateSeqNo(prefix, newSeq);
   satisfyPendingSyncInterests(prefix);
@@ -81,7 +88,7 @@ void
 PartialProducer::onHelloInterest(const ndn::Name& prefix, const ndn::Interest& interest)
 {
   const auto& name = interest.getName();
-  if (m_segmentPublisher.replyFromStore(name)) {
+  if (replyFromStore(name, true)) {
     return;
   }
 
@@ -93,37 +100,58 @@ PartialProducer::onHelloInterest(const ndn::Name& prefix, const ndn::Interest& i
 
   NDN_LOG_DEBUG("Hello Interest Received, nonce: " << interest);
 
-  detail::State state;
-  for (const auto& p : m_prefixes) {
-    state.addContent(ndn::Name(p.first).appendNumber(p.second));
+  if (m_helloReplyVersion == m_stateVersion) {
+    NDN_LOG_DEBUG("State unchanged, sending cached hello reply");
+    m_segmentPublisher.publish(name, m_helloReply, m_helloReplyFreshness);
+    ++m_stats.nReplies;
+    ++m_stats.nFullStateReplies;
+    return;
   }
+
+  detail::State state;
+  forEachPrefix([&state] (const ndn::Name& p, uint64_t seq) {
+    state.addContent(ndn::Name(p).appendNumber(seq));
+  });
   NDN_LOG_DEBUG("sending content p: " << state);
 
   ndn::Name helloDataName = prefix;
   m_iblt.appendToName(helloDataName);
 
-  m_segmentPublisher.publish(interest.getName(), helloDataName,
-                             state.wireEncode(), m_helloReplyFreshness);
+  auto tag = getTraceTag(name);
+  auto content = encodeState(state, tag);
+  {
+    TraceScope trace(m_tracer, TraceStage::SEGMENT_PUBLISH, tag);
+    m_helloReply = m_segmentPublisher.publish(name, helloDataName, content, m_helloReplyFreshness);
+  }
+  recordReply(content.size(), content.size(), true);
+  m_helloReplyVersion = m_stateVersion;
+  ++m_nHelloReplyBuilds;
 }
 
 void
 PartialProducer::onSyncInterest(const ndn::Name& prefix, const ndn::Interest& interest)
 {
-  if (m_segmentPublisher.replyFromStore(interest.getName())) {
+  if (replyFromStore(interest.getName())) {
     return;
   }
 
   NDN_LOG_DEBUG("Sync Interest Received, nonce: " << interest.getNonce() <<
                 " hash: " << std::hash<ndn::Name>{}(interest.getName()));
+  auto tag = getTraceTag(interest.getName());
 
   ndn::Name nameWithoutSyncPrefix = interest.getName().getSubName(prefix.size());
   ndn::Name interestName;
 
-  if (nameWithoutSyncPrefix.size() == 4) {
-    // Get /<prefix>/BF/IBF/ from /<prefix>/BF/IBF (3 components of BF + 1 for IBF)
+  // The subscription filter takes 3 components, or 1 if replaced by a token
+  bool hasToken = !nameWithoutSyncPrefix.empty() &&
+                  nameWithoutSyncPrefix[0].type() == tlv::SubscriptionTokenComponent;
+  size_t nFilterComponents = hasToken ? 1 : 3;
+
+  if (nameWithoutSyncPrefix.size() == nFilterComponents + 1) {
+    // Get /<prefix>/BF/IBF/ from /<prefix>/BF/IBF
     interestName = interest.getName();
   }
-  else if (nameWithoutSyncPrefix.size() == 6) {
+  else if (nameWithoutSyncPrefix.size() == nFilterComponents + 3) {
     // Get <prefix>/BF/IBF/ from /<prefix>/BF/IBF/<version>/<segment-no>
     interestName = interest.getName().getPrefix(-2);
   }
@@ -131,38 +159,64 @@ PartialProducer::onSyncInterest(const ndn::Name& prefix, const ndn::Interest& in
     return;
   }
 
-  ndn::name::Component bfName, ibltName;
-  unsigned int projectedCount;
-  double falsePositiveProb;
+  std::shared_ptr<const detail::SubscriptionFilter> filter;
+  FilterParams filterParams;
+  detail::IBLT iblt(m_expectedNumEntries, m_ibltCompression);
   try {
-    projectedCount = interestName.get(interestName.size()-4).toNumber();
-    falsePositiveProb = interestName.get(interestName.size()-3).toNumber()/1000.;
-    bfName = interestName.get(interestName.size()-2);
+    const auto& ibltName = interestName.get(interestName.size()-1);
+
+    if (hasToken) {
+      const auto* cached = findSubscriptionFilter(interestName.get(interestName.size()-2));
+      if (cached == nullptr) {
+        NDN_LOG_DEBUG("Unknown subscription token, sending application Nack");
+        sendApplicationNack(interestName);
+        return;
+      }
+      filter = cached->filter;
+      filterParams = cached->filterParams;
+    }
+    else {
+      ndn::Name filterName = interestName.getSubName(interestName.size()-4, 3);
+      uint32_t filterHash = 0;
+      const CachedSubscriptionFilter* cached = nullptr;
+      if (m_subscriptionTokenCacheSize > 0) {
+        // Consumers that do not use tokens benefit from the cache too, but the token
+        // (a SHA-256 digest) is only computed to cache a filter that was not found
+        filterHash = detail::murmurHash3(detail::N_HASHCHECK, filterName);
+        cached = findSubscriptionFilter(filterName, filterHash);
+      }
 
-    ibltName = interestName.get(interestName.size()-1);
-  }
-  catch (const std::exception& e) {
-    NDN_LOG_ERROR("Cannot extract bloom filter and IBF from sync interest: " << e.what());
-    NDN_LOG_ERROR("Format: /<syncPrefix>/sync/<BF-count>/<BF-false-positive-probability>/<BF>/<IBF>");
-    return;
-  }
+      if (cached != nullptr) {
+        filter = cached->filter;
+        filterParams = cached->filterParams;
+      }
+      else {
+        filterParams = {filterName.get(0).toNumber(), filterName.get(1).toNumber(),
+                        filterName.get(2).type()};
+        filter = detail::parseSubscriptionFilter(std::get<0>(filterParams),
+                                                 std::get<1>(filterParams) / 1000.,
+                                                 filterName.get(2));
+        if (m_subscriptionTokenCacheSize > 0) {
+          cacheSubscriptionFilter(detail::makeSubscriptionToken(filterName), filterName, filterHash,
+                                  filter, filterParams);
+        }
+      }
+    }
 
-  detail::BloomFilter bf;
-  detail::IBLT iblt(m_expectedNumEntries, m_ibltCompression);
-  try {
-    bf = detail::BloomFilter(projectedCount, falsePositiveProb, bfName);
+    TraceScope trace(m_tracer, TraceStage::IBF_DECOMPRESS, tag);
     iblt.initialize(ibltName);
   }
   catch (const std::exception& e) {
-    NDN_LOG_WARN(e.what());
+    NDN_LOG_WARN("Cannot extract subscription filter and IBF from sync interest: " << e.what());
+    NDN_LOG_WARN("Format: /<syncPrefix>/sync/<BF-count>/<BF-false-positive-probability>/<BF>/<IBF>");
     return;
   }
 
   // get the difference
   // non-empty positive means we have some elements that the others don't
-  auto diff = m_iblt - iblt;
+  auto diff = decodeDifference(iblt, tag);
 
-  NDN_LOG_TRACE("Number elements in IBF: " << m_prefixes.size());
+  NDN_LOG_TRACE("Number elements in IBF: " << getNumPrefixes());
 
   NDN_LOG_TRACE("diff.canDecode: " << diff.canDecode);
 
@@ -177,12 +231,12 @@ PartialProducer::onSyncInterest(const ndn::Name& prefix, const ndn::Interest& in
   NDN_LOG_TRACE("Size of positive set " << diff.positive.size());
   NDN_LOG_TRACE("Size of negative set " << diff.negative.size());
   for (const auto& hash : diff.positive) {
-    auto nameIt = m_biMap.left.find(hash);
-    if (nameIt != m_biMap.left.end()) {
-      if (bf.contains(nameIt->second.getPrefix(-1))) {
+    auto name = findNameByHash(hash);
+    if (name) {
+      if (filter->contains(name->getPrefix(-1))) {
         // generate data
-        state.addContent(nameIt->second);
-        NDN_LOG_DEBUG("Content: " << nameIt->second << " " << nameIt->first);
+        state.addContent(*name);
+        NDN_LOG_DEBUG("Content: " << *name << " " << hash);
       }
     }
   }
@@ -195,62 +249,287 @@ PartialProducer::onSyncInterest(const ndn::Name& prefix, const ndn::Interest& in
     ndn::Name syncDataName = interestName;
     m_iblt.appendToName(syncDataName);
 
-    m_segmentPublisher.publish(interest.getName(), syncDataName,
-                               state.wireEncode(), m_syncReplyFreshness);
+    auto content = encodeState(state, tag);
+    {
+      TraceScope trace(m_tracer, TraceStage::SEGMENT_PUBLISH, tag);
+      m_segmentPublisher.publish(interest.getName(), syncDataName, content, m_syncReplyFreshness);
+    }
+    recordReply(content.size(), content.size(), false);
     return;
   }
 
-  auto& entry = m_pendingEntries.emplace(interestName, PendingEntryInfo{bf, iblt, {}}).first->second;
-  entry.expirationEvent = m_scheduler.schedule(interest.getInterestLifetime(),
-                          [this, interest] {
-                            NDN_LOG_TRACE("Erase Pending Interest " << interest.getNonce());
-                            m_pendingEntries.erase(interest.getName());
-                          });
+  addPendingEntry(interestName, PendingEntryInfo{filter, iblt, {}, filterParams},
+                  diff.positive.size() + diff.negative.size(), interest.getInterestLifetime());
 }
 
 void
 PartialProducer::satisfyPendingSyncInterests(const ndn::Name& prefix) {
   NDN_LOG_TRACE("size of pending interest: " << m_pendingEntries.size());
 
-  for (auto it = m_pendingEntries.begin(); it != m_pendingEntries.end();) {
-    const PendingEntryInfo& entry = it->second;
+  // Only the entries whose Bloom filter may contain prefix and the entries whose
+  // IBF difference may have reached m_threshold can be answered.
+  // The value tells whether the entry is subscribed to prefix.
+  std::map<PendingEntry*, bool> candidates;
+  for (auto& item : m_subscriptionGroups) {
+    auto& group = item.second;
+    auto positions = group.hasher.getBitPositions(prefix);
+    const std::set<PendingEntry*>* smallest = nullptr;
+    for (auto pos : positions) {
+      auto bitIt = group.entriesByBit.find(pos);
+      if (bitIt == group.entriesByBit.end()) {
+        smallest = nullptr;
+        break;
+      }
+      if (smallest == nullptr || bitIt->second.size() < smallest->size()) {
+        smallest = &bitIt->second;
+      }
+    }
+    if (smallest == nullptr) {
+      continue;
+    }
+    for (auto* pending : *smallest) {
+      if (pending->second.filter->asBloomFilter()->containsBits(positions)) {
+        candidates.emplace(pending, true);
+      }
+    }
+  }
+  for (auto* pending : m_unindexedEntries) {
+    if (pending->second.filter->contains(prefix)) {
+      candidates.emplace(pending, true);
+    }
+  }
+  for (auto it = m_thresholdQueue.begin();
+       it != m_thresholdQueue.end() && it->first <= m_stateVersion; ++it) {
+    candidates.emplace(it->second, false);
+  }
 
-    auto diff = m_iblt - entry.iblt;
+  NDN_LOG_TRACE("number of candidate pending interests: " << candidates.size());
 
-    NDN_LOG_TRACE("diff.canDecode: " << diff.canDecode);
+  for (const auto& [pending, isSubscribed] : candidates) {
+    checkPendingEntry(*pending, isSubscribed, prefix);
+  }
+}
 
-    NDN_LOG_TRACE("Number elements in IBF: " << m_prefixes.size());
-    NDN_LOG_TRACE("m_threshold: " << m_threshold << " Total: " << diff.positive.size() + diff.negative.size());
+void
+PartialProducer::afterBulkChange()
+{
+  // The difference of any pending entry may have reached m_threshold or become
+  // undecodable, however far its threshold version is
+  std::vector<PendingEntry*> pendings;
+  pendings.reserve(m_thresholdQueue.size());
+  for (const auto& item : m_thresholdQueue) {
+    pendings.push_back(item.second);
+  }
+  NDN_LOG_TRACE("Checking " << pendings.size() << " pending interests after a bulk change");
 
-    if (!diff.canDecode) {
-      NDN_LOG_TRACE("Decoding of differences with stored IBF unsuccessful, deleting pending interest");
-      m_pendingEntries.erase(it++);
-      continue;
-    }
+  for (auto* pending : pendings) {
+    checkPendingEntry(*pending, false, {});
+  }
+}
 
-    detail::State state;
-    if (entry.bf.contains(prefix) || diff.positive.size() + diff.negative.size() >= m_threshold) {
-      if (entry.bf.contains(prefix)) {
-        state.addContent(ndn::Name(prefix).appendNumber(m_prefixes[prefix]));
-        NDN_LOG_DEBUG("sending sync content " << prefix << " " << std::to_string(m_prefixes[prefix]));
-      }
-      else {
-        NDN_LOG_DEBUG("Sending with empty content to send latest IBF to consumer");
-      }
+void
+PartialProducer::checkPendingEntry(PendingEntry& pending, bool isSubscribed, const ndn::Name& prefix)
+{
+  auto it = m_pendingEntries.find(pending.first);
+  const PendingEntryInfo& entry = it->second;
+
+  auto tag = getTraceTag(it->first);
+  auto diff = decodeDifference(entry.iblt, tag);
+  size_t diffSize = diff.positive.size() + diff.negative.size();
+
+  NDN_LOG_TRACE("diff.canDecode: " << diff.canDecode);
 
-      // generate sync data and cancel the event
-      ndn::Name syncDataName = it->first;
-      m_iblt.appendToName(syncDataName);
+  NDN_LOG_TRACE("Number elements in IBF: " << getNumPrefixes());
+  NDN_LOG_TRACE("m_threshold: " << m_threshold << " Total: " << diffSize);
 
-      m_segmentPublisher.publish(it->first, syncDataName,
-                                 state.wireEncode(), m_syncReplyFreshness);
+  if (!diff.canDecode) {
+    NDN_LOG_TRACE("Decoding of differences with stored IBF unsuccessful, deleting pending interest");
+    erasePendingEntry(it);
+    return;
+  }
 
-      m_pendingEntries.erase(it++);
+  detail::State state;
+  if (isSubscribed || diffSize >= m_threshold) {
+    if (isSubscribed) {
+      uint64_t seq = getSeqNo(prefix).value_or(0);
+      state.addContent(ndn::Name(prefix).appendNumber(seq));
+      NDN_LOG_DEBUG("sending sync content " << prefix << " " << std::to_string(seq));
     }
     else {
-      ++it;
+      NDN_LOG_DEBUG("Sending with empty content to send latest IBF to consumer");
+    }
+
+    // generate sync data and cancel the event
+    ndn::Name syncDataName = it->first;
+    m_iblt.appendToName(syncDataName);
+
+    auto content = encodeState(state, tag);
+    {
+      TraceScope trace(m_tracer, TraceStage::SEGMENT_PUBLISH, tag);
+      m_segmentPublisher.publish(it->first, syncDataName, content, m_syncReplyFreshness);
+    }
+    recordReply(content.size(), content.size(), false);
+
+    erasePendingEntry(it);
+  }
+  else {
+    NDN_LOG_TRACE("Difference still below threshold, keeping pending interest");
+    armThresholdCheck(*it, diffSize);
+  }
+}
+
+const PartialProducer::CachedSubscriptionFilter*
+PartialProducer::findSubscriptionFilter(const ndn::name::Component& token)
+{
+  auto it = m_subscriptionTokens.find(token);
+  if (it == m_subscriptionTokens.end()) {
+    return nullptr;
+  }
+  m_subscriptionTokenLru.splice(m_subscriptionTokenLru.begin(), m_subscriptionTokenLru, it->second.lruIt);
+  return &it->second;
+}
+
+const PartialProducer::CachedSubscriptionFilter*
+PartialProducer::findSubscriptionFilter(const ndn::Name& filterName, uint32_t filterHash)
+{
+  auto it = m_subscriptionTokensByFilter.find(filterHash);
+  if (it == m_subscriptionTokensByFilter.end()) {
+    return nullptr;
+  }
+  auto cached = findSubscriptionFilter(it->second);
+  // Different filters may have the same hash
+  if (cached == nullptr || cached->filterName != filterName) {
+    return nullptr;
+  }
+  return cached;
+}
+
+void
+PartialProducer::cacheSubscriptionFilter(const ndn::name::Component& token,
+                                         const ndn::Name& filterName, uint32_t filterHash,
+                                         std::shared_ptr<const detail::SubscriptionFilter> filter,
+                                         const FilterParams& filterParams)
+{
+  if (m_subscriptionTokens.count(token) > 0) {
+    return;
+  }
+
+  if (m_subscriptionTokens.size() >= m_subscriptionTokenCacheSize) {
+    NDN_LOG_TRACE("Evicting subscription token " << m_subscriptionTokenLru.back());
+    auto evicted = m_subscriptionTokens.find(m_subscriptionTokenLru.back());
+    auto byFilter = m_subscriptionTokensByFilter.find(evicted->second.filterHash);
+    if (byFilter != m_subscriptionTokensByFilter.end() && byFilter->second == evicted->first) {
+      m_subscriptionTokensByFilter.erase(byFilter);
     }
+    m_subscriptionTokens.erase(evicted);
+    m_subscriptionTokenLru.pop_back();
   }
+
+  m_subscriptionTokenLru.push_front(token);
+  // Encoding the filter name copies it out of the Interest, which is not kept alive
+  m_subscriptionTokens.emplace(token, CachedSubscriptionFilter{std::move(filter), filterParams,
+                                                               ndn::Name(filterName.wireEncode()),
+                                                               filterHash,
+                                                               m_subscriptionTokenLru.begin()});
+  m_subscriptionTokensByFilter[filterHash] = token;
+}
+
+void
+PartialProducer::addPendingEntry(const ndn::Name& interestName, PendingEntryInfo info,
+                                 size_t diffSize, ndn::time::milliseconds lifetime)
+{
+  auto [it, isNew] = m_pendingEntries.emplace(interestName, std::move(info));
+  it->second.expirationEvent = m_scheduler.schedule(lifetime, [this, interestName] {
+    NDN_LOG_TRACE("Erase Pending Interest " << std::hash<ndn::Name>{}(interestName));
+    auto entryIt = m_pendingEntries.find(interestName);
+    if (entryIt != m_pendingEntries.end()) {
+      erasePendingEntry(entryIt);
+    }
+  });
+
+  if (!isNew) {
+    // Same name means same Bloom filter and IBF, already indexed
+    return;
+  }
+
+  const auto* bf = it->second.filter->asBloomFilter();
+  if (bf == nullptr) {
+    m_unindexedEntries.insert(&*it);
+  }
+  else {
+    auto groupIt = m_subscriptionGroups.find(it->second.filterParams);
+    if (groupIt == m_subscriptionGroups.end()) {
+      // Filters with the same parameters hash keys identically
+      detail::BloomFilter hasher = *bf;
+      hasher.clear();
+      groupIt = m_subscriptionGroups.emplace(it->second.filterParams,
+                                             SubscriptionGroup{std::move(hasher)}).first;
+    }
+    auto& group = groupIt->second;
+    for (auto pos : bf->getSetBits()) {
+      group.entriesByBit[pos].insert(&*it);
+    }
+    ++group.nEntries;
+  }
+
+  armThresholdCheck(*it, diffSize);
+}
+
+void
+PartialProducer::armThresholdCheck(PendingEntry& pending, size_t diffSize)
+{
+  auto& entry = pending.second;
+  auto range = m_thresholdQueue.equal_range(entry.thresholdVersion);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == &pending) {
+      m_thresholdQueue.erase(it);
+      break;
+    }
+  }
+
+  // Each state change adds or removes at most two elements to or from the IBF,
+  // so the difference cannot reach m_threshold before this many changes
+  BOOST_ASSERT(diffSize < m_threshold);
+  entry.thresholdVersion = m_stateVersion + (m_threshold - diffSize + 1) / 2;
+  m_thresholdQueue.emplace(entry.thresholdVersion, &pending);
+}
+
+void
+PartialProducer::erasePendingEntry(std::map<ndn::Name, PendingEntryInfo>::iterator it)
+{
+  auto* pending = &*it;
+  const auto& entry = it->second;
+
+  const auto* bf = entry.filter->asBloomFilter();
+  auto groupIt = m_subscriptionGroups.find(entry.filterParams);
+  if (bf == nullptr) {
+    m_unindexedEntries.erase(pending);
+  }
+  else if (groupIt != m_subscriptionGroups.end()) {
+    auto& group = groupIt->second;
+    for (auto pos : bf->getSetBits()) {
+      auto bitIt = group.entriesByBit.find(pos);
+      if (bitIt != group.entriesByBit.end()) {
+        bitIt->second.erase(pending);
+        if (bitIt->second.empty()) {
+          group.entriesByBit.erase(bitIt);
+        }
+      }
+    }
+    if (--group.nEntries == 0) {
+      m_subscriptionGroups.erase(groupIt);
+    }
+  }
+
+  auto range = m_thresholdQueue.equal_range(entry.thresholdVersion);
+  for (auto qIt = range.first; qIt != range.second; ++qIt) {
+    if (qIt->second == pending) {
+      m_thresholdQueue.erase(qIt);
+      break;
+    }
+  }
+
+  m_pendingEntries.erase(it);
 }
 
 } // namespace psync
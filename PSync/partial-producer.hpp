@@ -23,6 +23,11 @@
 #include "PSync/producer-base.hpp"
 #include "PSync/detail/bloom-filter.hpp"
 
+#include <list>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+
 namespace psync {
 
 /**
@@ -49,6 +54,22 @@ public:
     ndn::time::milliseconds helloDataFreshness = HELLO_REPLY_FRESHNESS;
     /// FreshnessPeriod of sync Data.
     ndn::time::milliseconds syncDataFreshness = SYNC_REPLY_FRESHNESS;
+    /**
+     * @brief Number of subscription filters cached for sync Interests that carry a token.
+     *
+     * Tokens of evicted filters are answered with an application Nack,
+     * upon which consumers send their filter again.
+     */
+    size_t subscriptionTokenCacheSize = 1024;
+    /**
+     * @brief File in which to keep the prefixes, memory-mapped, instead of on the heap.
+     *
+     * For sync groups with millions of prefixes. If the file exists, its prefixes are restored.
+     * Empty keeps the prefixes on the heap.
+     */
+    std::string prefixTableFile;
+    /// Number of prefixes the prefix table file can hold, if it is created.
+    size_t prefixTableCapacity = 1000000;
   };
 
   /**
@@ -88,6 +109,29 @@ public:
   void
   publishName(const ndn::Name& prefix, std::optional<uint64_t> seq = std::nullopt);
 
+  /**
+   * @brief Returns how many times the hello reply has been built
+   *
+   * Hello Interests arriving while the state is unchanged are answered
+   * with the cached reply and do not increase this counter.
+   */
+  uint64_t
+  getNumHelloReplyBuilds() const
+  {
+    return m_nHelloReplyBuilds;
+  }
+
+  /**
+   * @brief Returns the counters of this producer since it was created
+   */
+  ProducerStats
+  getStats() const
+  {
+    auto stats = m_stats;
+    stats.nPendingInterests = m_pendingEntries.size();
+    return stats;
+  }
+
 private:
   /**
    * @brief Satisfy any pending interest that have subscription for prefix
@@ -97,6 +141,12 @@ private:
   void
   satisfyPendingSyncInterests(const ndn::Name& prefix);
 
+  /**
+   * @brief Check every pending interest again, the IBF may have changed a lot
+   */
+  void
+  afterBulkChange() final;
+
 PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
   /**
    * @brief Receive hello interest from consumer and respond with hello data
@@ -116,22 +166,142 @@ PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
    * store sync interest in m_pendingEntries
    *
    * Sync data's name format is: /\<syncPrefix\>/sync/\<BF\>/\<old-IBF\>/\<current-IBF\>
-   * (BF has 3 components).
+   * (BF has 3 components). The subscription filter may be a Bloom, cuckoo, or xor filter,
+   * told apart by the TLV-TYPE of its last component.
+   * The BF may also be replaced by the single token component of a cached filter.
    */
   void
   onSyncInterest(const ndn::Name& prefix, const ndn::Interest& interest);
 
 PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
+  // Subscription filter count, false positive probability * 1000, and TLV-TYPE of the
+  // filter component, as carried in the sync Interest
+  using FilterParams = std::tuple<uint64_t, uint64_t, uint32_t>;
+
   struct PendingEntryInfo
   {
-    detail::BloomFilter bf;
+    std::shared_ptr<const detail::SubscriptionFilter> filter;
     detail::IBLT iblt;
     ndn::scheduler::ScopedEventId expirationEvent;
+    FilterParams filterParams;
+    // State version at which the IBF difference may have reached m_threshold
+    uint64_t thresholdVersion = 0;
   };
 
+  using PendingEntry = std::pair<const ndn::Name, PendingEntryInfo>;
+
+  /**
+   * @brief Pending entries whose Bloom filters share the same parameters
+   *
+   * Indexed by bit position, so that a published prefix is hashed once per group
+   * and only the entries whose filter may contain it are examined.
+   */
+  struct SubscriptionGroup
+  {
+    // Empty filter with the parameters of the group, used to hash published prefixes
+    detail::BloomFilter hasher;
+    std::unordered_map<uint32_t, std::set<PendingEntry*>> entriesByBit;
+    size_t nEntries = 0;
+  };
+
+  struct CachedSubscriptionFilter
+  {
+    std::shared_ptr<const detail::SubscriptionFilter> filter;
+    FilterParams filterParams;
+    // Components of the filter in the Interest name, and their hash
+    ndn::Name filterName;
+    uint32_t filterHash;
+    // Position in m_subscriptionTokenLru
+    std::list<ndn::name::Component>::iterator lruIt;
+  };
+
+PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
+  /**
+   * @brief Look up the filter cached under @p token and mark it as recently used
+   *
+   * @return the cached filter, or nullptr if there is none
+   */
+  const CachedSubscriptionFilter*
+  findSubscriptionFilter(const ndn::name::Component& token);
+
+  /**
+   * @brief Look up the filter cached for the filter components @p filterName
+   *
+   * Used for sync Interests without a token, so that a hit does not compute the token.
+   *
+   * @param filterName the filter components of the sync Interest
+   * @param filterHash murmurHash3() of @p filterName with seed N_HASHCHECK
+   * @return the cached filter, or nullptr if there is none
+   */
+  const CachedSubscriptionFilter*
+  findSubscriptionFilter(const ndn::Name& filterName, uint32_t filterHash);
+
+  /**
+   * @brief Cache @p filter under @p token, evicting the least recently used filter if full
+   */
+  void
+  cacheSubscriptionFilter(const ndn::name::Component& token,
+                          const ndn::Name& filterName, uint32_t filterHash,
+                          std::shared_ptr<const detail::SubscriptionFilter> filter,
+                          const FilterParams& filterParams);
+
+  /**
+   * @brief Store a sync Interest that could not be answered yet
+   *
+   * @param interestName name of the sync Interest, without version and segment
+   * @param entry parsed subscription filter and IBF of the Interest
+   * @param diffSize size of the difference between our IBF and the one in the Interest
+   * @param lifetime how long to keep the entry
+   */
+  void
+  addPendingEntry(const ndn::Name& interestName, PendingEntryInfo entry, size_t diffSize,
+                  ndn::time::milliseconds lifetime);
+
+  /**
+   * @brief (Re)compute when the IBF difference of @p pending may reach m_threshold
+   *
+   * @param pending the pending entry
+   * @param diffSize current size of the difference, must be below m_threshold
+   */
+  void
+  armThresholdCheck(PendingEntry& pending, size_t diffSize);
+
+  /**
+   * @brief Answer @p pending if it is subscribed or its difference reached m_threshold
+   *
+   * Erases the entry if its difference cannot be decoded, and arms its threshold check
+   * again if it is kept.
+   *
+   * @param pending the pending entry
+   * @param isSubscribed whether the filter of the entry contains @p prefix
+   * @param prefix the published prefix, used if @p isSubscribed
+   */
+  void
+  checkPendingEntry(PendingEntry& pending, bool isSubscribed, const ndn::Name& prefix);
+
+  void
+  erasePendingEntry(std::map<ndn::Name, PendingEntryInfo>::iterator it);
+
+PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
   std::map<ndn::Name, PendingEntryInfo> m_pendingEntries;
+  std::map<FilterParams, SubscriptionGroup> m_subscriptionGroups;
+  // Pending entries whose filters are not Bloom filters, which are checked one by one
+  std::set<PendingEntry*> m_unindexedEntries;
+  // Pending entries ordered by PendingEntryInfo::thresholdVersion
+  std::multimap<uint64_t, PendingEntry*> m_thresholdQueue;
+  // Parsed subscription filters by token, and tokens from most to least recently used
+  std::map<ndn::name::Component, CachedSubscriptionFilter> m_subscriptionTokens;
+  std::list<ndn::name::Component> m_subscriptionTokenLru;
+  // Tokens by hash of the filter components, for sync Interests without a token
+  std::unordered_map<uint32_t, ndn::name::Component> m_subscriptionTokensByFilter;
+  size_t m_subscriptionTokenCacheSize;
   ndn::ScopedRegisteredPrefixHandle m_registeredPrefix;
   ndn::time::milliseconds m_helloReplyFreshness;
+
+  // Signed segments of the last hello reply and the state version they were built from
+  SegmentPublisher::Segments m_helloReply;
+  std::optional<uint64_t> m_helloReplyVersion;
+  uint64_t m_nHelloReplyBuilds = 0;
 };
 
 } // namespace psync
@@ -18,15 +18,29 @@
  */
 
 #include "PSync/producer-base.hpp"
+#include "PSync/detail/state.hpp"
 #include "PSync/detail/util.hpp"
 
+#include <ndn-cxx/encoding/block-helpers.hpp>
 #include <ndn-cxx/util/exception.hpp>
 #include <ndn-cxx/util/logger.hpp>
 
+#include <algorithm>
+#include <thread>
+
 namespace psync {
 
 NDN_LOG_INIT(psync.ProducerBase);
 
+// Fewer entries are hashed faster than threads are started
+const size_t MIN_ENTRIES_PER_THREAD = 4096;
+
+static uint32_t
+computeNextSeqHash(const ndn::Name& prefix, uint64_t seq)
+{
+  return detail::murmurHash3(detail::N_HASHCHECK, prefix, seq + 1);
+}
+
 ProducerBase::ProducerBase(ndn::Face& face,
                            ndn::KeyChain& keyChain,
                            size_t expectedNumEntries,
@@ -52,29 +66,58 @@ ProducerBase::ProducerBase(ndn::Face& face,
 bool
 ProducerBase::addUserNode(const ndn::Name& prefix)
 {
-  if (m_prefixes.find(prefix) == m_prefixes.end()) {
+  if (m_prefixTable) {
+    try {
+      if (!m_prefixTable->insert(prefix)) {
+        return false;
+      }
+    }
+    catch (const detail::MappedPrefixTable::Error& e) {
+      NDN_THROW(Error(e.what()));
+    }
+  }
+  else if (m_prefixes.find(prefix) == m_prefixes.end()) {
     m_prefixes[prefix] = 0;
-    return true;
   }
   else {
     return false;
   }
+
+  ++m_stateVersion;
+  appendToJournal(tlv::JournalUpdate, prefix, 0);
+  return true;
 }
 
 void
 ProducerBase::removeUserNode(const ndn::Name& prefix)
 {
+  if (m_prefixTable) {
+    auto seqNo = m_prefixTable->erase(prefix);
+    if (!seqNo) {
+      return;
+    }
+    ++m_stateVersion;
+    if (*seqNo != 0) {
+      m_iblt.erase(detail::murmurHash3(detail::N_HASHCHECK, prefix, *seqNo));
+    }
+    appendToJournal(tlv::JournalRemoval, prefix, std::nullopt);
+    return;
+  }
+
   auto it = m_prefixes.find(prefix);
   if (it != m_prefixes.end()) {
     uint64_t seqNo = it->second;
     m_prefixes.erase(it);
+    ++m_stateVersion;
 
     ndn::Name prefixWithSeq = ndn::Name(prefix).appendNumber(seqNo);
     auto hashIt = m_biMap.right.find(prefixWithSeq);
     if (hashIt != m_biMap.right.end()) {
       m_iblt.erase(hashIt->second);
+      m_nextSeqHashes.erase(hashIt->second);
       m_biMap.right.erase(hashIt);
     }
+    appendToJournal(tlv::JournalRemoval, prefix, std::nullopt);
   }
 }
 
@@ -83,40 +126,391 @@ ProducerBase::updateSeqNo(const ndn::Name& prefix, uint64_t seq)
 {
   NDN_LOG_DEBUG("UpdateSeq: " << prefix << " " << seq);
 
-  uint64_t oldSeq;
-  auto it = m_prefixes.find(prefix);
-  if (it != m_prefixes.end()) {
-    oldSeq = it->second;
-  }
-  else {
+  auto oldSeq = getSeqNo(prefix);
+  if (!oldSeq) {
     NDN_LOG_WARN("Prefix not found in m_prefixes");
     return;
   }
 
-  if (oldSeq >= seq) {
+  if (*oldSeq >= seq) {
     NDN_LOG_WARN("Update has lower/equal seq no for prefix, doing nothing!");
     return;
   }
 
-  // Delete the last sequence prefix from the iblt
-  // Because we don't insert zeroth prefix in IBF so no need to delete that
-  if (oldSeq != 0) {
-    ndn::Name prefixWithSeq = ndn::Name(prefix).appendNumber(oldSeq);
-    auto hashIt = m_biMap.right.find(prefixWithSeq);
-    if (hashIt != m_biMap.right.end()) {
-      m_iblt.erase(hashIt->second);
-      m_biMap.right.erase(hashIt);
+  auto newHash = detail::murmurHash3(detail::N_HASHCHECK, prefix, seq);
+
+  if (m_prefixTable) {
+    if (*oldSeq != 0) {
+      m_iblt.erase(detail::murmurHash3(detail::N_HASHCHECK, prefix, *oldSeq));
+    }
+    m_prefixTable->setSeqNo(prefix, seq, newHash);
+    m_iblt.insert(newHash);
+  }
+  else {
+    // Delete the last sequence prefix from the iblt
+    // Because we don't insert zeroth prefix in IBF so no need to delete that
+    if (*oldSeq != 0) {
+      auto hashIt = m_biMap.right.find(ndn::Name(prefix).appendNumber(*oldSeq));
+      if (hashIt != m_biMap.right.end()) {
+        m_iblt.erase(hashIt->second);
+        m_nextSeqHashes.erase(hashIt->second);
+        m_biMap.right.erase(hashIt);
+      }
+    }
+
+    // Insert the new seq no in m_prefixes, m_biMap, and m_iblt
+    m_prefixes[prefix] = seq;
+    m_biMap.insert({newHash, ndn::Name(prefix).appendNumber(seq)});
+    m_nextSeqHashes[newHash] = computeNextSeqHash(prefix, seq);
+    m_iblt.insert(newHash);
+  }
+
+  m_numOwnElements += (seq - *oldSeq);
+  if (m_prefixTable) {
+    m_prefixTable->setNumOwnElements(m_numOwnElements);
+  }
+  ++m_stateVersion;
+  appendToJournal(tlv::JournalUpdate, prefix, seq);
+}
+
+void
+ProducerBase::loadState(ndn::span<const std::pair<ndn::Name, uint64_t>> state, size_t nThreads)
+{
+  try {
+    applyState(state, nThreads);
+  }
+  catch (const Error&) {
+    afterBulkChange();
+    throw;
+  }
+  afterBulkChange();
+}
+
+void
+ProducerBase::applyState(ndn::span<const std::pair<ndn::Name, uint64_t>> state, size_t nThreads)
+{
+  // IBF key of prefix/seq for each entry with a sequence number, and without a prefix
+  // table, prefix/seq and the IBF key of prefix/seq+1
+  std::vector<uint32_t> hashes(state.size());
+  std::vector<ndn::Name> namesWithSeq(m_prefixTable ? 0 : state.size());
+  std::vector<uint32_t> nextHashes(m_prefixTable ? 0 : state.size());
+  auto computeHashes = [&] (size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const auto& [prefix, seq] = state[i];
+      if (seq != 0) {
+        hashes[i] = detail::murmurHash3(detail::N_HASHCHECK, prefix, seq);
+        if (!m_prefixTable) {
+          namesWithSeq[i] = ndn::Name(prefix).appendNumber(seq);
+          nextHashes[i] = computeNextSeqHash(prefix, seq);
+        }
+      }
+    }
+  };
+
+  nThreads = std::clamp<size_t>(state.size() / MIN_ENTRIES_PER_THREAD, 1, std::max<size_t>(nThreads, 1));
+  size_t chunkSize = state.size() / nThreads;
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < nThreads; ++i) {
+    size_t end = i + 1 < nThreads ? (i + 1) * chunkSize : state.size();
+    threads.emplace_back(computeHashes, i * chunkSize, end);
+  }
+  computeHashes(0, nThreads > 1 ? chunkSize : state.size());
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  if (!m_prefixTable) {
+    m_biMap.left.rehash(m_biMap.size() + state.size());
+    m_biMap.right.rehash(m_biMap.size() + state.size());
+    m_nextSeqHashes.reserve(m_nextSeqHashes.size() + state.size());
+  }
+
+  for (size_t i = 0; i < state.size(); ++i) {
+    const auto& [prefix, seq] = state[i];
+    auto oldSeq = getSeqNo(prefix);
+    if (oldSeq && *oldSeq >= seq) {
+      continue;
+    }
+
+    if (oldSeq && *oldSeq != 0) {
+      auto oldHash = detail::murmurHash3(detail::N_HASHCHECK, prefix, *oldSeq);
+      m_iblt.erase(oldHash);
+      if (!m_prefixTable) {
+        m_nextSeqHashes.erase(oldHash);
+        m_biMap.left.erase(oldHash);
+      }
+    }
+
+    if (m_prefixTable) {
+      try {
+        m_prefixTable->insert(prefix);
+      }
+      catch (const detail::MappedPrefixTable::Error& e) {
+        // The entries before this one are loaded, so the state has changed all the same
+        m_prefixTable->setNumOwnElements(m_numOwnElements);
+        ++m_stateVersion;
+        NDN_THROW(Error(e.what()));
+      }
+      m_prefixTable->setSeqNo(prefix, seq, hashes[i]);
+    }
+    else {
+      m_prefixes.insert_or_assign(prefix, seq);
+      if (seq != 0) {
+        m_biMap.insert({hashes[i], std::move(namesWithSeq[i])});
+        m_nextSeqHashes[hashes[i]] = nextHashes[i];
+      }
+    }
+
+    if (seq != 0) {
+      m_iblt.insert(hashes[i]);
+    }
+    m_numOwnElements += seq - oldSeq.value_or(0);
+  }
+
+  if (m_prefixTable) {
+    m_prefixTable->setNumOwnElements(m_numOwnElements);
+  }
+  ++m_stateVersion;
+  NDN_LOG_DEBUG("Loaded " << state.size() << " prefixes with " << nThreads << " threads");
+}
+
+void
+ProducerBase::usePrefixTableFile(const std::string& path, size_t maxPrefixes)
+{
+  if (getNumPrefixes() > 0) {
+    NDN_THROW(Error("The prefix table file must be set before adding prefixes"));
+  }
+
+  try {
+    m_prefixTable = std::make_unique<detail::MappedPrefixTable>(path, maxPrefixes);
+  }
+  catch (const detail::MappedPrefixTable::Error& e) {
+    NDN_THROW(Error(e.what()));
+  }
+
+  m_prefixTable->forEachKey([this] (uint32_t key) { m_iblt.insert(key); });
+  m_numOwnElements = m_prefixTable->getNumOwnElements();
+  ++m_stateVersion;
+  afterBulkChange();
+  NDN_LOG_DEBUG("Using prefix table " << path << " with " << m_prefixTable->size() << " prefixes");
+}
+
+void
+ProducerBase::forEachPrefix(const std::function<void(const ndn::Name&, uint64_t)>& f) const
+{
+  if (m_prefixTable) {
+    m_prefixTable->forEach(f);
+    return;
+  }
+
+  for (const auto& [prefix, seq] : m_prefixes) {
+    f(prefix, seq);
+  }
+}
+
+std::optional<ndn::Name>
+ProducerBase::findNameByHash(uint32_t hash) const
+{
+  if (m_prefixTable) {
+    return m_prefixTable->findByKey(hash);
+  }
+
+  auto it = m_biMap.left.find(hash);
+  if (it == m_biMap.left.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+std::optional<uint32_t>
+ProducerBase::getNextSeqHash(uint32_t hash) const
+{
+  if (m_prefixTable) {
+    auto name = m_prefixTable->findByKey(hash);
+    if (!name) {
+      return std::nullopt;
     }
+    return computeNextSeqHash(name->getPrefix(-1), name->get(-1).toNumber());
+  }
+
+  auto it = m_nextSeqHashes.find(hash);
+  if (it == m_nextSeqHashes.end()) {
+    return std::nullopt;
   }
+  return it->second;
+}
+
+void
+ProducerBase::saveSnapshot(const std::string& path)
+{
+  ndn::EncodingBuffer buffer;
+  size_t totalLength = 0;
 
-  // Insert the new seq no in m_prefixes, m_biMap, and m_iblt
-  it->second = seq;
-  ndn::Name prefixWithSeq = ndn::Name(prefix).appendNumber(seq);
-  auto newHash = detail::murmurHash3(detail::N_HASHCHECK, prefixWithSeq);
-  m_biMap.insert({newHash, prefixWithSeq});
-  m_iblt.insert(newHash);
+  forEachPrefix([&] (const ndn::Name& prefix, uint64_t seq) {
+    size_t entryLength = ndn::encoding::prependNonNegativeIntegerBlock(buffer, tlv::SeqNo, seq);
+    entryLength += prefix.wireEncode(buffer);
+    entryLength += buffer.prependVarNumber(entryLength);
+    entryLength += buffer.prependVarNumber(tlv::SnapshotEntry);
+    totalLength += entryLength;
+  });
 
-  m_numOwnElements += (seq - oldSeq);
+  ndn::Name ibf;
+  m_iblt.appendToName(ibf);
+  totalLength += ibf[0].wireEncode(buffer);
+  totalLength += ndn::encoding::prependNonNegativeIntegerBlock(buffer, tlv::NumOwnElements,
+                                                               m_numOwnElements);
+  totalLength += buffer.prependVarNumber(totalLength);
+  totalLength += buffer.prependVarNumber(tlv::ProducerSnapshot);
+
+  try {
+    detail::writeStateFile(path, buffer.block());
+    if (m_journal) {
+      m_journal->truncate();
+    }
+  }
+  catch (const detail::StateFileError& e) {
+    NDN_THROW(Error(e.what()));
+  }
+  NDN_LOG_DEBUG("Saved " << getNumPrefixes() << " prefixes to " << path);
+}
+
+bool
+ProducerBase::restoreSnapshot(const std::string& path)
+{
+  std::optional<ndn::Block> snapshot;
+  try {
+    snapshot = detail::readStateFile(path);
+  }
+  catch (const detail::StateFileError& e) {
+    NDN_THROW(Error(e.what()));
+  }
+
+  if (snapshot) {
+    // Decode everything before replacing the current state
+    detail::IBLT iblt(m_expectedNumEntries, m_ibltCompression);
+    uint64_t numOwnElements = 0;
+    std::vector<std::pair<ndn::Name, uint64_t>> entries;
+    try {
+      if (snapshot->type() != tlv::ProducerSnapshot) {
+        NDN_THROW(ndn::tlv::Error("ProducerSnapshot", snapshot->type()));
+      }
+      snapshot->parse();
+      numOwnElements = ndn::encoding::readNonNegativeInteger(snapshot->get(tlv::NumOwnElements));
+      iblt.initialize(ndn::name::Component(snapshot->get(ndn::tlv::GenericNameComponent)));
+      for (const auto& element : snapshot->elements()) {
+        if (element.type() != tlv::SnapshotEntry) {
+          continue;
+        }
+        element.parse();
+        entries.emplace_back(ndn::Name(element.get(ndn::tlv::Name)),
+                             ndn::encoding::readNonNegativeInteger(element.get(tlv::SeqNo)));
+      }
+    }
+    catch (const std::exception& e) {
+      NDN_THROW(Error("Cannot restore " + path + ": " + e.what()));
+    }
+
+    m_prefixes.clear();
+    m_biMap.clear();
+    m_nextSeqHashes.clear();
+    if (m_prefixTable) {
+      m_prefixTable->clear();
+    }
+    m_iblt = detail::IBLT(m_expectedNumEntries, m_ibltCompression);
+    applyState(entries, 1);
+    // The saved IBF is the one peers last saw
+    m_iblt = std::move(iblt);
+    m_numOwnElements = numOwnElements;
+    if (m_prefixTable) {
+      m_prefixTable->setNumOwnElements(m_numOwnElements);
+    }
+    NDN_LOG_DEBUG("Restored " << getNumPrefixes() << " prefixes from " << path);
+  }
+
+  if (m_journal) {
+    // Replayed changes are already in the journal
+    auto journal = std::move(m_journal);
+    auto nRecords = detail::StateJournal::replay(journal->getPath(),
+                                                 [this] (const auto& r) { applyJournalRecord(r); });
+    m_journal = std::move(journal);
+    NDN_LOG_DEBUG("Replayed " << nRecords << " journal records");
+  }
+
+  ++m_stateVersion;
+  afterBulkChange();
+  return snapshot.has_value();
+}
+
+void
+ProducerBase::setJournal(const std::string& path, ndn::time::milliseconds syncInterval)
+{
+  try {
+    m_journal = std::make_unique<detail::StateJournal>(path);
+  }
+  catch (const detail::StateFileError& e) {
+    NDN_THROW(Error(e.what()));
+  }
+  m_journalSyncInterval = syncInterval;
+  m_journalSyncEvent.cancel();
+}
+
+void
+ProducerBase::appendToJournal(uint32_t type, const ndn::Name& prefix, std::optional<uint64_t> seq)
+{
+  if (!m_journal) {
+    return;
+  }
+
+  ndn::EncodingBuffer buffer;
+  size_t totalLength = 0;
+  if (seq) {
+    totalLength += ndn::encoding::prependNonNegativeIntegerBlock(buffer, tlv::SeqNo, *seq);
+  }
+  totalLength += prefix.wireEncode(buffer);
+  totalLength += buffer.prependVarNumber(totalLength);
+  totalLength += buffer.prependVarNumber(type);
+
+  bool shouldSync = m_journalSyncInterval == 0_ms;
+  try {
+    m_journal->append(buffer.block(), shouldSync);
+  }
+  catch (const detail::StateFileError& e) {
+    NDN_THROW(Error(e.what()));
+  }
+
+  // One fsync for all the records appended until it runs
+  if (!shouldSync && !m_journalSyncEvent) {
+    m_journalSyncEvent = m_scheduler.schedule(m_journalSyncInterval, [this] {
+      try {
+        m_journal->sync();
+      }
+      catch (const detail::StateFileError& e) {
+        NDN_THROW(Error(e.what()));
+      }
+    });
+  }
+}
+
+void
+ProducerBase::applyJournalRecord(const ndn::Block& record)
+{
+  try {
+    record.parse();
+    ndn::Name prefix(record.get(ndn::tlv::Name));
+    if (record.type() == tlv::JournalRemoval) {
+      removeUserNode(prefix);
+      return;
+    }
+
+    auto seq = ndn::encoding::readNonNegativeInteger(record.get(tlv::SeqNo));
+    addUserNode(prefix);
+    if (seq > getSeqNo(prefix).value_or(0)) {
+      updateSeqNo(prefix, seq);
+    }
+  }
+  catch (const ndn::tlv::Error& e) {
+    NDN_LOG_WARN("Skipping journal record: " << e.what());
+  }
 }
 
 void
@@ -134,6 +528,38 @@ ProducerBase::sendApplicationNack(const ndn::Name& name)
 
   m_keyChain.sign(data);
   m_face.put(data);
+  ++m_stats.nNacks;
+}
+
+detail::IBLTDiff
+ProducerBase::decodeDifference(const detail::IBLT& iblt, size_t tag, bool isCounted)
+{
+  TraceScope trace(m_tracer, TraceStage::IBF_DECODE, tag);
+  auto diff = m_iblt - iblt;
+  if (isCounted) {
+    recordDecode(diff);
+  }
+  return diff;
+}
+
+ndn::Block
+ProducerBase::encodeState(const detail::State& state, size_t tag) const
+{
+  TraceScope trace(m_tracer, TraceStage::STATE_ENCODE, tag);
+  return state.wireEncode();
+}
+
+bool
+ProducerBase::replyFromStore(const ndn::Name& interestName, bool isHello, bool isCounted)
+{
+  if (isCounted) {
+    ++(isHello ? m_stats.nHelloInterests : m_stats.nSyncInterests);
+  }
+  if (m_segmentPublisher.replyFromStore(interestName)) {
+    ++m_stats.nRepliesFromStore;
+    return true;
+  }
+  return false;
 }
 
 void
@@ -23,7 +23,11 @@
 #include "PSync/common.hpp"
 #include "PSync/detail/access-specifiers.hpp"
 #include "PSync/detail/iblt.hpp"
+#include "PSync/detail/mapped-prefix-table.hpp"
+#include "PSync/detail/state-file.hpp"
 #include "PSync/segment-publisher.hpp"
+#include "PSync/stats.hpp"
+#include "PSync/trace.hpp"
 
 #include <ndn-cxx/face.hpp>
 #include <ndn-cxx/security/key-chain.hpp>
@@ -34,11 +38,16 @@
 #include <boost/bimap/unordered_set_of.hpp>
 
 #include <map>
+#include <unordered_map>
 
 namespace psync {
 
 namespace bm = boost::bimaps;
 
+namespace detail {
+class State;
+} // namespace detail
+
 /**
  * @brief Base class for PartialProducer and FullProducer
  *
@@ -74,6 +83,9 @@ PSYNC_PUBLIC_WITH_TESTS_ELSE_PROTECTED:
                CompressionScheme contentCompression = CompressionScheme::NONE);
 
 public:
+  virtual
+  ~ProducerBase() = default;
+
   /**
    * @brief Returns the current sequence number of the given prefix
    *
@@ -82,6 +94,10 @@ public:
   std::optional<uint64_t>
   getSeqNo(const ndn::Name& prefix) const
   {
+    if (m_prefixTable) {
+      return m_prefixTable->getSeqNo(prefix);
+    }
+
     auto it = m_prefixes.find(prefix);
     if (it == m_prefixes.end()) {
       return std::nullopt;
@@ -113,6 +129,75 @@ public:
   void
   removeUserNode(const ndn::Name& prefix);
 
+  /**
+   * @brief Add many prefixes with their sequence numbers at once
+   *
+   * Meant for startup, when the prefixes are recovered from application storage.
+   * Equivalent to addUserNode() and updateSeqNo() for each entry, but the hash
+   * tables are sized once, the IBF keys are computed in one pass, and nothing
+   * is logged or sent per prefix. A prefix that already has a higher or equal
+   * sequence number keeps it. The changes are not written to the journal,
+   * call saveSnapshot() to persist them.
+   *
+   * @param state prefixes and their sequence numbers
+   * @param nThreads number of threads computing the IBF keys
+   * @throw Error the prefix table file cannot grow; the entries before the one
+   *        that did not fit are loaded
+   */
+  void
+  loadState(ndn::span<const std::pair<ndn::Name, uint64_t>> state, size_t nThreads = 1);
+
+  /**
+   * @brief Save the prefixes, their sequence numbers and the IBF to @p path
+   *
+   * The snapshot is written under a temporary name that then replaces @p path,
+   * so that @p path always holds a complete snapshot. The journal, if any, is emptied.
+   *
+   * @throw Error the snapshot cannot be written
+   */
+  void
+  saveSnapshot(const std::string& path);
+
+  /**
+   * @brief Replace the state with the snapshot in @p path, then apply the journal
+   *
+   * Meant to be called right after construction, so that a restarted producer
+   * syncs with the IBF its peers last saw instead of an empty one.
+   * The producer must have the IBF size with which the snapshot was saved.
+   *
+   * @return whether @p path exists
+   * @throw Error the snapshot is corrupt or has another IBF size
+   */
+  bool
+  restoreSnapshot(const std::string& path);
+
+  /**
+   * @brief Record each change of the state in the journal @p path
+   *
+   * restoreSnapshot() then also recovers the changes made after the last snapshot.
+   * The methods that change the state throw Error if the journal cannot be written.
+   *
+   * @param syncInterval zero to write each record to disk before the change returns.
+   *        Otherwise the records appended within @p syncInterval are written to disk
+   *        together, from the scheduler, and a power failure loses at most the last
+   *        @p syncInterval of changes.
+   * @throw Error the journal cannot be opened
+   */
+  void
+  setJournal(const std::string& path, ndn::time::milliseconds syncInterval = 0_ms);
+
+  /**
+   * @brief Report the stages of the processing of sync Interests to @p tracer
+   *
+   * Null, the default, disables tracing. The tracer must outlive the producer,
+   * or be replaced before it is destroyed.
+   */
+  void
+  setTracer(Tracer* tracer)
+  {
+    m_tracer = tracer;
+  }
+
 PSYNC_PUBLIC_WITH_TESTS_ELSE_PROTECTED:
   /**
    * @brief Update m_prefixes and IBF with the given prefix and seq
@@ -131,9 +216,48 @@ PSYNC_PUBLIC_WITH_TESTS_ELSE_PROTECTED:
   bool
   isUserNode(const ndn::Name& prefix) const
   {
-    return m_prefixes.find(prefix) != m_prefixes.end();
+    return getSeqNo(prefix).has_value();
+  }
+
+  /**
+   * @brief Keep the prefixes in the memory-mapped file @p path instead of m_prefixes and m_biMap
+   *
+   * Must be called before any prefix is added. If @p path holds the table of a previous
+   * run, its prefixes are kept and the IBF is rebuilt from them.
+   *
+   * @param maxPrefixes number of prefixes the table holds before it grows, if it is created
+   * @throw Error the file cannot be mapped or does not hold a prefix table
+   */
+  void
+  usePrefixTableFile(const std::string& path, size_t maxPrefixes);
+
+  size_t
+  getNumPrefixes() const
+  {
+    return m_prefixTable ? m_prefixTable->size() : m_prefixes.size();
   }
 
+  /**
+   * @brief Call @p f with each prefix and its sequence number
+   */
+  void
+  forEachPrefix(const std::function<void(const ndn::Name& prefix, uint64_t seq)>& f) const;
+
+  /**
+   * @brief Find the prefix/seq name whose IBF key is @p hash
+   */
+  std::optional<ndn::Name>
+  findNameByHash(uint32_t hash) const;
+
+  /**
+   * @brief Find the IBF key of the next sequence number of the prefix whose IBF key is @p hash
+   *
+   * The keys are computed when the sequence numbers are updated, unless a prefix table file
+   * is used.
+   */
+  std::optional<uint32_t>
+  getNextSeqHash(uint32_t hash) const;
+
   /**
    * @brief Sends a data packet with content type nack
    *
@@ -145,12 +269,95 @@ PSYNC_PUBLIC_WITH_TESTS_ELSE_PROTECTED:
   void
   sendApplicationNack(const ndn::Name& name);
 
+  /**
+   * @brief Reply to @p interestName from m_segmentPublisher, counting the Interest in m_stats
+   *
+   * @param isCounted false for an Interest processed again, which was counted already
+   * @return whether the reply was found in memory
+   */
+  bool
+  replyFromStore(const ndn::Name& interestName, bool isHello = false, bool isCounted = true);
+
+  /**
+   * @brief Returns the tag of the sync Interest @p name for m_tracer, or 0 if tracing is disabled
+   */
+  size_t
+  getTraceTag(const ndn::Name& name) const
+  {
+    return m_tracer != nullptr ? std::hash<ndn::Name>{}(name) : 0;
+  }
+
+  /**
+   * @brief Compute the difference of m_iblt and @p iblt, for the sync Interest with hash @p tag
+   *
+   * The decoding is traced and, if @p isCounted, counted in m_stats.
+   */
+  detail::IBLTDiff
+  decodeDifference(const detail::IBLT& iblt, size_t tag, bool isCounted = true);
+
+  /**
+   * @brief Encode @p state, for the sync Interest with hash @p tag
+   */
+  ndn::Block
+  encodeState(const detail::State& state, size_t tag) const;
+
+  void
+  recordDecode(const detail::IBLTDiff& diff) noexcept
+  {
+    if (diff.canDecode) {
+      ++m_stats.nDecodeSuccesses;
+      m_stats.diffSize.record(diff.positive.size() + diff.negative.size());
+    }
+    else {
+      ++m_stats.nDecodeFailures;
+    }
+  }
+
+  /**
+   * @brief Count a reply whose content has @p size bytes, @p uncompressedSize before compression
+   */
+  void
+  recordReply(size_t size, size_t uncompressedSize, bool isFullState) noexcept
+  {
+    ++m_stats.nReplies;
+    m_stats.nFullStateReplies += isFullState;
+    m_stats.replySize.record(size);
+    m_stats.nBytesBeforeCompression += uncompressedSize;
+    m_stats.nBytesAfterCompression += size;
+  }
+
   /**
    * @brief Logs a message and throws if setting an interest filter fails
    */
   [[noreturn]] static void
   onRegisterFailed(const ndn::Name& prefix, const std::string& msg);
 
+private:
+  void
+  appendToJournal(uint32_t type, const ndn::Name& prefix, std::optional<uint64_t> seq);
+
+  void
+  applyJournalRecord(const ndn::Block& record);
+
+  /**
+   * @brief Load @p state as loadState() does, without calling afterBulkChange()
+   */
+  void
+  applyState(ndn::span<const std::pair<ndn::Name, uint64_t>> state, size_t nThreads);
+
+protected:
+  /**
+   * @brief Called after loadState(), restoreSnapshot() and usePrefixTableFile()
+   *
+   * These change any number of IBF elements at once, while the producers expect each
+   * state version to change at most two, so pending Interests must be checked again.
+   * Also called when loadState() throws, after the entries that were loaded.
+   */
+  virtual void
+  afterBulkChange()
+  {
+  }
+
 PSYNC_PUBLIC_WITH_TESTS_ELSE_PROTECTED:
   ndn::Face& m_face;
   ndn::KeyChain& m_keyChain;
@@ -165,6 +372,8 @@ PSYNC_PUBLIC_WITH_TESTS_ELSE_PROTECTED:
   using HashNameBiMap = bm::bimap<bm::unordered_set_of<uint32_t>,
                                   bm::unordered_set_of<ndn::Name, std::hash<ndn::Name>>>;
   HashNameBiMap m_biMap;
+  // IBF key of prefix/seq+1, by IBF key of prefix/seq, for each prefix in m_biMap
+  std::unordered_map<uint32_t, uint32_t> m_nextSeqHashes;
 
   SegmentPublisher m_segmentPublisher;
 
@@ -177,6 +386,16 @@ PSYNC_PUBLIC_WITH_TESTS_ELSE_PROTECTED:
   const CompressionScheme m_ibltCompression;
   const CompressionScheme m_contentCompression;
   uint64_t m_numOwnElements = 0;
+  // Incremented whenever m_prefixes or m_iblt changes, so that
+  // replies derived from the whole state can be cached.
+  uint64_t m_stateVersion = 0;
+  std::unique_ptr<detail::StateJournal> m_journal;
+  ndn::time::milliseconds m_journalSyncInterval = 0_ms;
+  ndn::scheduler::ScopedEventId m_journalSyncEvent;
+  // Replaces m_prefixes and m_biMap when set
+  std::unique_ptr<detail::MappedPrefixTable> m_prefixTable;
+  ProducerStats m_stats;
+  Tracer* m_tracer = nullptr;
 };
 
 } // namespace psync
@@ -0,0 +1,142 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/publication-store.hpp"
+#include "PSync/full-producer.hpp"
+#include "PSync/partial-producer.hpp"
+
+#include <ndn-cxx/util/exception.hpp>
+#include <ndn-cxx/util/logger.hpp>
+
+#include <algorithm>
+
+namespace psync {
+
+NDN_LOG_INIT(psync.PublicationStore);
+
+PublicationStore::PublicationStore(ndn::Face& face, ndn::KeyChain& keyChain,
+                                   FullProducer& producer, const Options& opts)
+  : PublicationStore(face, keyChain, producer,
+                     [&producer] (const auto& prefix, auto seq) { producer.publishName(prefix, seq); },
+                     opts)
+{
+}
+
+PublicationStore::PublicationStore(ndn::Face& face, ndn::KeyChain& keyChain,
+                                   PartialProducer& producer, const Options& opts)
+  : PublicationStore(face, keyChain, producer,
+                     [&producer] (const auto& prefix, auto seq) { producer.publishName(prefix, seq); },
+                     opts)
+{
+}
+
+PublicationStore::PublicationStore(ndn::Face& face, ndn::KeyChain& keyChain,
+                                   ProducerBase& producer, PublishFunction publishName,
+                                   const Options& opts)
+  : m_face(face)
+  , m_keyChain(keyChain)
+  , m_producer(producer)
+  , m_publishName(std::move(publishName))
+  , m_signingInfo(opts.signingInfo)
+  , m_dataFreshness(opts.dataFreshness)
+  , m_maxPublicationsPerPrefix(std::max<size_t>(opts.maxPublicationsPerPrefix, 1))
+  , m_registerPrefixes(opts.registerPrefixes)
+{
+}
+
+uint64_t
+PublicationStore::publish(const ndn::Name& prefix, ndn::span<const uint8_t> content)
+{
+  m_producer.addUserNode(prefix);
+  uint64_t seq = m_producer.getSeqNo(prefix).value_or(0) + 1;
+
+  auto [it, isNew] = m_entries.try_emplace(prefix);
+  auto& entry = it->second;
+  if (isNew) {
+    entry.ring.resize(m_maxPublicationsPerPrefix);
+    auto onInterest = [this, &name = it->first] (const auto&, const auto& interest) {
+      this->onInterest(name, interest);
+    };
+    if (m_registerPrefixes) {
+      entry.registeredPrefix = m_face.setInterestFilter(prefix, onInterest,
+        [] (const auto& p, const auto& msg) {
+          NDN_LOG_ERROR("onRegisterFailed(" << p << "): " << msg);
+          NDN_THROW(Error(msg));
+        });
+    }
+    else {
+      entry.interestFilter = m_face.setInterestFilter(prefix, onInterest);
+    }
+  }
+
+  auto data = std::make_shared<ndn::Data>(ndn::Name(prefix).appendNumber(seq));
+  data->setContent(content);
+  data->setFreshnessPeriod(m_dataFreshness);
+  // Signing also encodes the Data, its wire is then reused for every reply
+  m_keyChain.sign(*data, m_signingInfo);
+
+  entry.ring[seq % entry.ring.size()] = {seq, std::move(data)};
+
+  NDN_LOG_DEBUG("Publish: " << prefix << "/" << seq);
+  m_publishName(prefix, seq);
+  return seq;
+}
+
+std::shared_ptr<const ndn::Data>
+PublicationStore::find(const ndn::Name& prefix, uint64_t seq) const
+{
+  auto it = m_entries.find(prefix);
+  if (it == m_entries.end()) {
+    return nullptr;
+  }
+
+  const auto& publication = it->second.ring[seq % it->second.ring.size()];
+  if (publication.data == nullptr || publication.seq != seq) {
+    return nullptr;
+  }
+  return publication.data;
+}
+
+void
+PublicationStore::erase(const ndn::Name& prefix)
+{
+  m_entries.erase(prefix);
+}
+
+void
+PublicationStore::onInterest(const ndn::Name& prefix, const ndn::Interest& interest)
+{
+  const auto& name = interest.getName();
+  // Interests for longer prefixes are served by their own filter
+  if (name.size() != prefix.size() + 1 || !name[-1].isNumber()) {
+    return;
+  }
+
+  auto data = find(prefix, name[-1].toNumber());
+  if (data == nullptr) {
+    NDN_LOG_TRACE("No Data for " << name);
+    return;
+  }
+
+  NDN_LOG_TRACE("Serving " << name);
+  ++m_nInterestsServed;
+  m_face.put(*data);
+}
+
+} // namespace psync
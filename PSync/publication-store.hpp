@@ -0,0 +1,150 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PSYNC_PUBLICATION_STORE_HPP
+#define PSYNC_PUBLICATION_STORE_HPP
+
+#include "PSync/common.hpp"
+#include "PSync/detail/access-specifiers.hpp"
+
+#include <ndn-cxx/face.hpp>
+#include <ndn-cxx/security/key-chain.hpp>
+
+#include <map>
+
+namespace psync {
+
+class FullProducer;
+class PartialProducer;
+class ProducerBase;
+
+/**
+ * @brief Publishes application Data and the sync update announcing it
+ *
+ * publish() assigns the next sequence number of the prefix, signs the Data
+ * /\<prefix\>/\<seq\> and publishes the sequence number with the producer.
+ * The last Data of each prefix are kept encoded in a ring buffer and put directly
+ * in reply to matching Interests, so the application does not have to serve them.
+ */
+class PublicationStore
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  /**
+   * @brief Constructor options.
+   */
+  struct Options
+  {
+    /// How to sign the Data.
+    ndn::security::SigningInfo signingInfo;
+    /// FreshnessPeriod of the Data.
+    ndn::time::milliseconds dataFreshness = 1_s;
+    /// Number of Data kept per prefix, older ones are no longer served.
+    size_t maxPublicationsPerPrefix = 64;
+    /**
+     * @brief Whether to register each prefix with the forwarder.
+     *
+     * If false, the application must register a prefix covering them.
+     */
+    bool registerPrefixes = true;
+  };
+
+  /**
+   * @brief Constructor.
+   *
+   * @param face Application face.
+   * @param keyChain KeyChain instance to use for signing.
+   * @param producer Producer announcing the publications.
+   * @param opts Options.
+   */
+  PublicationStore(ndn::Face& face, ndn::KeyChain& keyChain, FullProducer& producer,
+                   const Options& opts);
+
+  PublicationStore(ndn::Face& face, ndn::KeyChain& keyChain, PartialProducer& producer,
+                   const Options& opts);
+
+  /**
+   * @brief Publish @p content under the next sequence number of @p prefix
+   *
+   * The prefix is added to the producer if needed.
+   *
+   * @return the sequence number of the Data
+   */
+  uint64_t
+  publish(const ndn::Name& prefix, ndn::span<const uint8_t> content);
+
+  /**
+   * @brief Returns the stored Data of @p seq, or nullptr if it is not kept
+   */
+  std::shared_ptr<const ndn::Data>
+  find(const ndn::Name& prefix, uint64_t seq) const;
+
+  /**
+   * @brief Drop the Data of @p prefix and stop serving it
+   *
+   * The prefix remains in the producer.
+   */
+  void
+  erase(const ndn::Name& prefix);
+
+private:
+  using PublishFunction = std::function<void(const ndn::Name& prefix, uint64_t seq)>;
+
+  PublicationStore(ndn::Face& face, ndn::KeyChain& keyChain, ProducerBase& producer,
+                   PublishFunction publishName, const Options& opts);
+
+  void
+  onInterest(const ndn::Name& prefix, const ndn::Interest& interest);
+
+PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
+  struct Publication
+  {
+    uint64_t seq = 0;
+    std::shared_ptr<const ndn::Data> data;
+  };
+
+  struct PrefixEntry
+  {
+    // Publication of seq at index seq % size
+    std::vector<Publication> ring;
+    ndn::ScopedRegisteredPrefixHandle registeredPrefix;
+    ndn::ScopedInterestFilterHandle interestFilter;
+  };
+
+  ndn::Face& m_face;
+  ndn::KeyChain& m_keyChain;
+  ProducerBase& m_producer;
+  PublishFunction m_publishName;
+  ndn::security::SigningInfo m_signingInfo;
+  ndn::time::milliseconds m_dataFreshness;
+  size_t m_maxPublicationsPerPrefix;
+  bool m_registerPrefixes;
+
+  std::map<ndn::Name, PrefixEntry> m_entries;
+  uint64_t m_nInterestsServed = 0;
+};
+
+} // namespace psync
+
+#endif // PSYNC_PUBLICATION_STORE_HPP
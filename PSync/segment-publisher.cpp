@@ -30,12 +30,20 @@ SegmentPublisher::SegmentPublisher(ndn::Face& face, ndn::KeyChain& keyChain,
 {
 }
 
-void
+SegmentPublisher::Segments
 SegmentPublisher::publish(const ndn::Name& interestName, const ndn::Name& dataName,
                           ndn::span<const uint8_t> buffer, ndn::time::milliseconds freshness)
 {
   auto segments = m_segmenter.segment(buffer, ndn::Name(dataName).appendVersion(),
                                       ndn::MAX_NDN_PACKET_SIZE >> 1, freshness);
+  publish(interestName, segments, freshness);
+  return segments;
+}
+
+void
+SegmentPublisher::publish(const ndn::Name& interestName, const Segments& segments,
+                          ndn::time::milliseconds freshness)
+{
   for (const auto& data : segments) {
     m_ims.insert(*data, freshness);
     m_scheduler.schedule(freshness, [this, name = data->getName()] { m_ims.erase(name); });
@@ -39,6 +39,8 @@ public:
                    const ndn::security::SigningInfo& signingInfo = ndn::security::SigningInfo(),
                    size_t imsLimit = 100);
 
+  using Segments = std::vector<std::shared_ptr<ndn::Data>>;
+
   /**
    * @brief Put all the segments in memory.
    *
@@ -46,11 +48,25 @@ public:
    * @param dataName the data name, has components after interest name
    * @param buffer the content of the data
    * @param freshness freshness period of the segments
+   * @return the signed segments, which can be passed to the other overload to publish them again
    */
-  void
+  Segments
   publish(const ndn::Name& interestName, const ndn::Name& dataName,
           ndn::span<const uint8_t> buffer, ndn::time::milliseconds freshness);
 
+  /**
+   * @brief Put already signed segments in memory.
+   *
+   * Used to serve a previously built reply again without re-encoding and re-signing it.
+   *
+   * @param interestName the interest name, to determine the sequence to be answered immediately
+   * @param segments the segments returned by an earlier publish()
+   * @param freshness how long to keep the segments in memory
+   */
+  void
+  publish(const ndn::Name& interestName, const Segments& segments,
+          ndn::time::milliseconds freshness);
+
   /**
    * @brief Try to reply from memory, return false if we cannot find the segment.
    *
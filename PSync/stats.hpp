@@ -0,0 +1,195 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PSYNC_STATS_HPP
+#define PSYNC_STATS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace psync {
+
+/**
+ * @brief Histogram with power-of-two buckets
+ *
+ * Bucket 0 counts the zeros, and bucket i > 0 counts the values in [2^(i-1), 2^i).
+ * Recording a value only increments a few counters, so it can stay enabled in production.
+ */
+class LogHistogram
+{
+public:
+  static constexpr size_t N_BUCKETS = 65;
+
+  void
+  record(uint64_t value) noexcept
+  {
+    ++m_buckets[getBucketIndex(value)];
+    ++m_count;
+    m_sum += value;
+    if (value > m_max) {
+      m_max = value;
+    }
+  }
+
+  uint64_t
+  getCount() const noexcept
+  {
+    return m_count;
+  }
+
+  uint64_t
+  getSum() const noexcept
+  {
+    return m_sum;
+  }
+
+  uint64_t
+  getMax() const noexcept
+  {
+    return m_max;
+  }
+
+  double
+  getMean() const noexcept
+  {
+    return m_count == 0 ? 0.0 : static_cast<double>(m_sum) / m_count;
+  }
+
+  uint64_t
+  getBucket(size_t i) const
+  {
+    return m_buckets.at(i);
+  }
+
+  /**
+   * @brief Returns the largest value that falls in bucket @p i
+   */
+  static constexpr uint64_t
+  getBucketUpperBound(size_t i) noexcept
+  {
+    return i == 0 ? 0 : (i >= 64 ? UINT64_MAX : (uint64_t(1) << i) - 1);
+  }
+
+  /**
+   * @brief Returns an upper bound of the @p q quantile, 0 <= q <= 1
+   *
+   * The bound is the upper bound of the bucket holding the quantile, capped by getMax().
+   */
+  uint64_t
+  getQuantile(double q) const noexcept
+  {
+    uint64_t rank = static_cast<uint64_t>(q * m_count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < N_BUCKETS; ++i) {
+      seen += m_buckets[i];
+      if (seen > rank || seen == m_count) {
+        uint64_t bound = getBucketUpperBound(i);
+        return bound < m_max ? bound : m_max;
+      }
+    }
+    return m_max;
+  }
+
+  static constexpr size_t
+  getBucketIndex(uint64_t value) noexcept
+  {
+    size_t i = 0;
+    for (; value >= 256; value >>= 8) {
+      i += 8;
+    }
+    for (; value != 0; value >>= 1) {
+      ++i;
+    }
+    return i;
+  }
+
+private:
+  std::array<uint64_t, N_BUCKETS> m_buckets{};
+  uint64_t m_count = 0;
+  uint64_t m_sum = 0;
+  uint64_t m_max = 0;
+};
+
+/**
+ * @brief Counters of a FullProducer or PartialProducer
+ *
+ * The counters that do not apply to a kind of producer stay zero.
+ */
+struct ProducerStats
+{
+  /// Number of sync Interests received, including those answered from memory
+  uint64_t nSyncInterests = 0;
+  /// Number of hello Interests received, including those answered from memory (PartialProducer)
+  uint64_t nHelloInterests = 0;
+  /// Number of Interests answered with Data kept in memory
+  uint64_t nRepliesFromStore = 0;
+  /// Number of IBF differences decoded
+  uint64_t nDecodeSuccesses = 0;
+  /// Number of IBF differences that could not be decoded
+  uint64_t nDecodeFailures = 0;
+  /// Number of elements in each decoded IBF difference
+  LogHistogram diffSize;
+  /// Number of sync and hello Data replies
+  uint64_t nReplies = 0;
+  /// Number of replies carrying the whole state (FullProducer after a decode failure, hello Data)
+  uint64_t nFullStateReplies = 0;
+  /// Size in bytes of the content of each reply encoded, after compression
+  LogHistogram replySize;
+  /// Total content bytes of the replies encoded, before compression
+  uint64_t nBytesBeforeCompression = 0;
+  /// Total content bytes of the replies encoded, after compression
+  uint64_t nBytesAfterCompression = 0;
+  /// Number of application Nacks sent
+  uint64_t nNacks = 0;
+  /// Number of sync Interests waiting for new data, when getStats() was called
+  size_t nPendingInterests = 0;
+  /// Number of sync Interests waiting to be processed again (FullProducer), when getStats() was called
+  size_t nWaitingInterests = 0;
+};
+
+/**
+ * @brief Counters of a Consumer
+ */
+struct ConsumerStats
+{
+  /// Number of hello Interests sent, not counting retransmissions of a segment
+  uint64_t nHelloInterests = 0;
+  /// Number of sync Interests sent, not counting retransmissions of a segment
+  uint64_t nSyncInterests = 0;
+  /// Number of hello Data received
+  uint64_t nHelloData = 0;
+  /// Number of sync Data received
+  uint64_t nSyncData = 0;
+  /// Number of application Nacks received
+  uint64_t nNacks = 0;
+  /// Number of hello or sync Data that could not be fetched
+  uint64_t nFetchErrors = 0;
+  /// Size in bytes of the content of each sync Data
+  LogHistogram syncDataSize;
+  /// Number of new sequence numbers in each sync Data
+  LogHistogram updatesPerSyncData;
+  /// Microseconds from sending a sync Interest to receiving all of its Data,
+  /// including the time the producer kept it pending
+  LogHistogram syncRoundTimeUs;
+};
+
+} // namespace psync
+
+#endif // PSYNC_STATS_HPP
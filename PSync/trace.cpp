@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/trace.hpp"
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <tuple>
+
+namespace psync {
+
+const char*
+getTraceStageName(TraceStage stage)
+{
+  switch (stage) {
+    case TraceStage::QUEUEING:
+      return "queueing";
+    case TraceStage::IBF_DECOMPRESS:
+      return "ibf-decompress";
+    case TraceStage::IBF_DECODE:
+      return "ibf-decode";
+    case TraceStage::STATE_ENCODE:
+      return "state-encode";
+    case TraceStage::CONTENT_COMPRESS:
+      return "content-compress";
+    case TraceStage::SEGMENT_PUBLISH:
+      return "segment-publish";
+  }
+  return "unknown";
+}
+
+RingBufferTracer::RingBufferTracer(size_t capacity)
+  : m_capacity(std::max<size_t>(capacity, 1))
+{
+  m_events.reserve(m_capacity);
+}
+
+void
+RingBufferTracer::begin(TraceStage stage, size_t tag, TimePoint time)
+{
+  add({stage, true, tag, time});
+}
+
+void
+RingBufferTracer::end(TraceStage stage, size_t tag, TimePoint time)
+{
+  add({stage, false, tag, time});
+}
+
+void
+RingBufferTracer::add(const Event& event)
+{
+  if (m_events.size() < m_capacity) {
+    m_events.push_back(event);
+    return;
+  }
+  m_events[m_next] = event;
+  m_next = (m_next + 1) % m_capacity;
+}
+
+std::vector<RingBufferTracer::Event>
+RingBufferTracer::getEvents() const
+{
+  std::vector<Event> events;
+  events.reserve(m_events.size());
+  events.insert(events.end(), m_events.begin() + m_next, m_events.end());
+  events.insert(events.end(), m_events.begin(), m_events.begin() + m_next);
+  return events;
+}
+
+void
+RingBufferTracer::clear()
+{
+  m_events.clear();
+  m_next = 0;
+}
+
+void
+RingBufferTracer::writeChromeTrace(std::ostream& os) const
+{
+  using ndn::time::duration_cast;
+  using ndn::time::microseconds;
+
+  // Stages that have begun and not ended yet, by stage and tag
+  std::multimap<std::tuple<TraceStage, size_t>, TimePoint> open;
+  bool isFirst = true;
+
+  os << "{\"traceEvents\": [";
+  for (const auto& event : getEvents()) {
+    auto key = std::make_tuple(event.stage, event.tag);
+    if (event.isBegin) {
+      open.emplace(key, event.time);
+      continue;
+    }
+
+    // The beginning was overwritten
+    auto it = open.find(key);
+    if (it == open.end()) {
+      continue;
+    }
+    auto ts = duration_cast<microseconds>(it->second.time_since_epoch()).count();
+    auto dur = duration_cast<microseconds>(event.time - it->second).count();
+    open.erase(it);
+
+    os << (isFirst ? "\n" : ",\n")
+       << "{\"name\": \"" << getTraceStageName(event.stage) << "\", \"cat\": \"psync\", "
+       << "\"ph\": \"X\", \"ts\": " << ts << ", \"dur\": " << dur << ", "
+       << "\"pid\": 1, \"tid\": 1, \"args\": {\"tag\": \"" << event.tag << "\"}}";
+    isFirst = false;
+  }
+  os << "\n]}\n";
+}
+
+} // namespace psync
@@ -0,0 +1,165 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PSYNC_TRACE_HPP
+#define PSYNC_TRACE_HPP
+
+#include <ndn-cxx/util/time.hpp>
+
+#include <iosfwd>
+#include <vector>
+
+namespace psync {
+
+/**
+ * @brief Stages of the processing of a sync Interest by a producer
+ */
+enum class TraceStage {
+  /// Time a delayed sync Interest waited on the io_context past its scheduled time
+  QUEUEING,
+  /// Decompressing and parsing the IBF of a sync Interest, IBLT::initialize()
+  IBF_DECOMPRESS,
+  /// Peeling the difference of two IBFs, IBLT operator-
+  IBF_DECODE,
+  /// Encoding the State of a reply
+  STATE_ENCODE,
+  /// Compressing the content of a reply
+  CONTENT_COMPRESS,
+  /// Segmenting and signing a reply, SegmentPublisher::publish()
+  SEGMENT_PUBLISH,
+};
+
+const char*
+getTraceStageName(TraceStage stage);
+
+/**
+ * @brief Receives the beginning and the end of each stage
+ *
+ * The tag is the hash of the sync Interest name, as printed in the logs.
+ * Both calls of a stage come from the thread that runs the producer's io_context.
+ */
+class Tracer
+{
+public:
+  using TimePoint = ndn::time::steady_clock::time_point;
+
+  virtual
+  ~Tracer() = default;
+
+  virtual void
+  begin(TraceStage stage, size_t tag, TimePoint time) = 0;
+
+  virtual void
+  end(TraceStage stage, size_t tag, TimePoint time) = 0;
+};
+
+/**
+ * @brief Calls Tracer::begin() on construction and Tracer::end() on destruction
+ *
+ * Does nothing, not even reading the clock, when the tracer is null.
+ */
+class TraceScope
+{
+public:
+  TraceScope(Tracer* tracer, TraceStage stage, size_t tag)
+    : m_tracer(tracer)
+    , m_stage(stage)
+    , m_tag(tag)
+  {
+    if (m_tracer != nullptr) {
+      m_tracer->begin(m_stage, m_tag, ndn::time::steady_clock::now());
+    }
+  }
+
+  ~TraceScope()
+  {
+    if (m_tracer != nullptr) {
+      m_tracer->end(m_stage, m_tag, ndn::time::steady_clock::now());
+    }
+  }
+
+  TraceScope(const TraceScope&) = delete;
+
+  TraceScope&
+  operator=(const TraceScope&) = delete;
+
+private:
+  Tracer* m_tracer;
+  TraceStage m_stage;
+  size_t m_tag;
+};
+
+/**
+ * @brief Tracer keeping the last events in memory
+ *
+ * Once full, each event replaces the oldest one. writeChromeTrace() exports
+ * the stages whose beginning and end are both kept.
+ */
+class RingBufferTracer : public Tracer
+{
+public:
+  struct Event
+  {
+    TraceStage stage;
+    bool isBegin;
+    size_t tag;
+    TimePoint time;
+  };
+
+  explicit
+  RingBufferTracer(size_t capacity = 65536);
+
+  void
+  begin(TraceStage stage, size_t tag, TimePoint time) override;
+
+  void
+  end(TraceStage stage, size_t tag, TimePoint time) override;
+
+  /**
+   * @brief Returns the kept events, oldest first
+   */
+  std::vector<Event>
+  getEvents() const;
+
+  void
+  clear();
+
+  /**
+   * @brief Write the kept stages in the Chrome trace event format
+   *
+   * The output can be opened in chrome://tracing or Perfetto. Each stage is a
+   * complete event named after the stage, with the tag in its arguments.
+   */
+  void
+  writeChromeTrace(std::ostream& os) const;
+
+private:
+  void
+  add(const Event& event);
+
+private:
+  std::vector<Event> m_events;
+  size_t m_capacity;
+  // Position of the oldest event once m_events is full
+  size_t m_next = 0;
+};
+
+} // namespace psync
+
+#endif // PSYNC_TRACE_HPP
@@ -0,0 +1,251 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/update-fetcher.hpp"
+
+#include <ndn-cxx/util/logger.hpp>
+
+#include <algorithm>
+
+namespace psync {
+
+NDN_LOG_INIT(psync.UpdateFetcher);
+
+UpdateFetcher::UpdateFetcher(ndn::Face& face, const Options& opts)
+  : m_face(face)
+  , m_onData(opts.onData)
+  , m_onFailure(opts.onFailure)
+  , m_makeName(opts.makeName)
+  , m_interestLifetime(opts.interestLifetime)
+  , m_maxRetries(opts.maxRetries)
+  , m_aiStep(opts.aiStep)
+  , m_mdCoef(opts.mdCoef)
+  , m_maxBacklogPerPrefix(opts.maxBacklogPerPrefix)
+  , m_cwnd(std::max(opts.initCwnd, 1.0))
+  , m_ssthresh(opts.initSsthresh)
+{
+}
+
+void
+UpdateFetcher::fetch(const std::vector<MissingDataInfo>& updates)
+{
+  for (const auto& update : updates) {
+    fetch(update);
+  }
+}
+
+void
+UpdateFetcher::fetch(const MissingDataInfo& update)
+{
+  if (update.lowSeq > update.highSeq) {
+    return;
+  }
+
+  auto [it, isNew] = m_prefixes.try_emplace(update.prefix);
+  auto& state = it->second;
+  if (isNew) {
+    state.nextToDeliver = state.nextToRequest = update.lowSeq;
+    state.highSeq = update.highSeq;
+  }
+  else if (update.highSeq > state.highSeq) {
+    // Sequence numbers are consecutive, only those after highSeq are new
+    state.highSeq = update.highSeq;
+  }
+  else {
+    NDN_LOG_TRACE("Already fetching " << update.prefix << " up to " << state.highSeq);
+    return;
+  }
+
+  NDN_LOG_DEBUG("Fetching " << update.prefix << " up to " << state.highSeq);
+
+  if (m_maxBacklogPerPrefix > 0 && state.highSeq - state.nextToRequest >= m_maxBacklogPerPrefix) {
+    uint64_t firstSkipped = state.nextToRequest;
+    state.nextToRequest = state.highSeq - m_maxBacklogPerPrefix + 1;
+    NDN_LOG_DEBUG("Skipping " << update.prefix << " " << firstSkipped << " to " <<
+                  state.nextToRequest - 1);
+    state.skipped.emplace(firstSkipped, state.nextToRequest - 1);
+  }
+
+  if (state.orderIt) {
+    m_requestOrder.splice(m_requestOrder.begin(), m_requestOrder, *state.orderIt);
+  }
+  else {
+    state.orderIt = m_requestOrder.insert(m_requestOrder.begin(), &it->first);
+  }
+
+  deliver(update.prefix);
+  sendInterests();
+}
+
+void
+UpdateFetcher::stop()
+{
+  m_inFlight.clear();
+  m_retransmissions.clear();
+  m_requestOrder.clear();
+  m_prefixes.clear();
+}
+
+void
+UpdateFetcher::sendInterests()
+{
+  while (m_inFlight.size() < static_cast<size_t>(m_cwnd)) {
+    // Retransmissions first, they hold back the delivery of their prefix
+    if (!m_retransmissions.empty()) {
+      auto retx = std::move(m_retransmissions.front());
+      m_retransmissions.pop_front();
+      sendInterest(retx.prefix, retx.seq, retx.nRetries);
+      continue;
+    }
+
+    if (m_requestOrder.empty()) {
+      break;
+    }
+
+    const ndn::Name& prefix = *m_requestOrder.front();
+    auto& state = m_prefixes.at(prefix);
+    sendInterest(prefix, state.nextToRequest++, 0);
+    if (state.nextToRequest > state.highSeq) {
+      m_requestOrder.pop_front();
+      state.orderIt.reset();
+    }
+  }
+}
+
+void
+UpdateFetcher::sendInterest(const ndn::Name& prefix, uint64_t seq, int nRetries)
+{
+  ndn::Interest interest(m_makeName(prefix, seq));
+  interest.setInterestLifetime(m_interestLifetime);
+
+  uint64_t id = m_nextId++;
+  NDN_LOG_TRACE("Send Interest " << interest << " #" << id << " retries: " << nRetries);
+
+  m_inFlight.emplace(id, m_face.expressInterest(interest,
+    [this, id, prefix, seq] (const auto&, const auto& data) {
+      onData(id, prefix, seq, data);
+    },
+    [this, id, prefix, seq, nRetries] (const auto&, const auto& nack) {
+      NDN_LOG_TRACE("Nack for " << prefix << " " << seq << ": " << nack.getReason());
+      onLoss(id, prefix, seq, nRetries, nack.getReason() == ndn::lp::NackReason::CONGESTION);
+    },
+    [this, id, prefix, seq, nRetries] (const auto&) {
+      NDN_LOG_TRACE("Timeout for " << prefix << " " << seq);
+      onLoss(id, prefix, seq, nRetries, true);
+    }));
+}
+
+void
+UpdateFetcher::onData(uint64_t id, const ndn::Name& prefix, uint64_t seq, const ndn::Data& data)
+{
+  m_inFlight.erase(id);
+
+  if (m_cwnd < m_ssthresh) {
+    m_cwnd += m_aiStep;
+  }
+  else {
+    m_cwnd += m_aiStep / m_cwnd;
+  }
+
+  auto it = m_prefixes.find(prefix);
+  if (it != m_prefixes.end()) {
+    it->second.received.emplace(seq, data);
+    deliver(prefix);
+  }
+  sendInterests();
+}
+
+void
+UpdateFetcher::onLoss(uint64_t id, const ndn::Name& prefix, uint64_t seq, int nRetries,
+                      bool isCongestion)
+{
+  m_inFlight.erase(id);
+
+  if (isCongestion) {
+    decreaseWindow(id);
+  }
+
+  auto it = m_prefixes.find(prefix);
+  if (it != m_prefixes.end()) {
+    if (nRetries < m_maxRetries) {
+      m_retransmissions.push_back({prefix, seq, nRetries + 1});
+    }
+    else {
+      NDN_LOG_DEBUG("Giving up " << prefix << " " << seq << " after " << nRetries << " retries");
+      it->second.received.emplace(seq, std::nullopt);
+      deliver(prefix);
+    }
+  }
+  sendInterests();
+}
+
+void
+UpdateFetcher::decreaseWindow(uint64_t id)
+{
+  // The window was already decreased for the losses of this window
+  if (id < m_recoveryPoint) {
+    return;
+  }
+
+  m_ssthresh = std::max(2.0, m_cwnd * m_mdCoef);
+  m_cwnd = m_ssthresh;
+  m_recoveryPoint = m_nextId;
+  NDN_LOG_DEBUG("Window decreased to " << m_cwnd);
+}
+
+void
+UpdateFetcher::deliver(const ndn::Name& prefix)
+{
+  auto& state = m_prefixes.at(prefix);
+
+  while (true) {
+    auto receivedIt = state.received.begin();
+    if (receivedIt != state.received.end() && receivedIt->first == state.nextToDeliver) {
+      uint64_t seq = state.nextToDeliver++;
+      auto data = std::move(receivedIt->second);
+      state.received.erase(receivedIt);
+      if (data) {
+        m_onData(prefix, seq, *data);
+      }
+      else {
+        m_onFailure(prefix, seq, seq);
+      }
+      continue;
+    }
+
+    auto skippedIt = state.skipped.begin();
+    if (skippedIt != state.skipped.end() && skippedIt->first == state.nextToDeliver) {
+      auto [lowSeq, highSeq] = *skippedIt;
+      state.skipped.erase(skippedIt);
+      state.nextToDeliver = highSeq + 1;
+      m_onFailure(prefix, lowSeq, highSeq);
+      continue;
+    }
+
+    break;
+  }
+
+  // Nothing is left to request, in flight or waiting for delivery
+  if (state.nextToDeliver > state.highSeq) {
+    NDN_LOG_TRACE("Done fetching " << prefix << " up to " << state.highSeq);
+    m_prefixes.erase(prefix);
+  }
+}
+
+} // namespace psync
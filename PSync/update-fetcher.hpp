@@ -0,0 +1,207 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PSYNC_UPDATE_FETCHER_HPP
+#define PSYNC_UPDATE_FETCHER_HPP
+
+#include "PSync/common.hpp"
+#include "PSync/detail/access-specifiers.hpp"
+
+#include <ndn-cxx/face.hpp>
+
+#include <deque>
+#include <limits>
+#include <list>
+#include <map>
+#include <optional>
+#include <unordered_map>
+
+namespace psync {
+
+/**
+ * @brief Fetches the application Data announced by sync updates
+ *
+ * The application passes the MissingDataInfo received from FullProducer or Consumer to
+ * fetch(), which can be used as the UpdateCallback directly. The Data of each sequence
+ * number is then fetched and passed to Options::onData, in sequence number order for
+ * each prefix. Sequence numbers announced more than once are fetched once.
+ *
+ * All Interests share a congestion window, adjusted with AIMD like ndn::SegmentFetcher:
+ * it grows on each Data and shrinks, at most once per window, on timeout or congestion Nack.
+ * The prefix with the most recent update is served first. Within a prefix, sequence numbers
+ * are requested in increasing order, so that Data can be delivered as it arrives.
+ *
+ * The Data is not validated, the application is expected to do it in Options::onData.
+ */
+class UpdateFetcher
+{
+public:
+  using DataCallback = std::function<void(const ndn::Name& prefix, uint64_t seq,
+                                          const ndn::Data& data)>;
+  using FailureCallback = std::function<void(const ndn::Name& prefix, uint64_t lowSeq,
+                                             uint64_t highSeq)>;
+  using NameFunction = std::function<ndn::Name(const ndn::Name& prefix, uint64_t seq)>;
+
+  /**
+   * @brief Constructor options.
+   */
+  struct Options
+  {
+    /// Callback to give the Data of a sequence number to the application.
+    DataCallback onData = [] (const auto&, auto, const auto&) {};
+    /// Callback for sequence numbers whose Data cannot be fetched or was skipped.
+    FailureCallback onFailure = [] (const auto&, auto, auto) {};
+    /// Name of the Data of a sequence number, /<prefix>/<seq> by default.
+    NameFunction makeName = [] (const ndn::Name& prefix, uint64_t seq) {
+      return ndn::Name(prefix).appendNumber(seq);
+    };
+    /// Lifetime of data Interests, after which they are retransmitted.
+    ndn::time::milliseconds interestLifetime = 1_s;
+    /// Number of retransmissions before a sequence number is given up.
+    int maxRetries = 3;
+    /// Initial congestion window, in Interests.
+    double initCwnd = 1.0;
+    /// Initial slow start threshold.
+    double initSsthresh = std::numeric_limits<double>::max();
+    /// Window increase per window of Data after slow start.
+    double aiStep = 1.0;
+    /// Multiplicative decrease coefficient.
+    double mdCoef = 0.5;
+    /**
+     * @brief Most sequence numbers of a prefix waiting to be requested; zero for no limit.
+     *
+     * When an update goes beyond, the oldest sequence numbers are given up without being
+     * requested, so that a client far behind catches up with the newest Data first.
+     */
+    uint64_t maxBacklogPerPrefix = 0;
+  };
+
+  /**
+   * @brief Constructor.
+   *
+   * @param face Application face.
+   * @param opts Options.
+   */
+  UpdateFetcher(ndn::Face& face, const Options& opts);
+
+  /**
+   * @brief Fetch the Data of the sequence numbers in @p updates
+   *
+   * Sequence numbers being fetched, or delivered since the prefix was last idle, are
+   * ignored. A prefix is forgotten once all its sequence numbers have been delivered,
+   * so later updates are fetched from their MissingDataInfo::lowSeq.
+   */
+  void
+  fetch(const std::vector<MissingDataInfo>& updates);
+
+  void
+  fetch(const MissingDataInfo& update);
+
+  /**
+   * @brief Cancel all Interests and forget all prefixes
+   *
+   * Must not be called from the callbacks.
+   */
+  void
+  stop();
+
+  double
+  getCwnd() const
+  {
+    return m_cwnd;
+  }
+
+  size_t
+  getNumInFlight() const
+  {
+    return m_inFlight.size();
+  }
+
+private:
+  void
+  sendInterests();
+
+  void
+  sendInterest(const ndn::Name& prefix, uint64_t seq, int nRetries);
+
+  void
+  onData(uint64_t id, const ndn::Name& prefix, uint64_t seq, const ndn::Data& data);
+
+  void
+  onLoss(uint64_t id, const ndn::Name& prefix, uint64_t seq, int nRetries, bool isCongestion);
+
+  void
+  decreaseWindow(uint64_t id);
+
+  /**
+   * @brief Pass the Data and failures that follow the last delivered sequence number
+   */
+  void
+  deliver(const ndn::Name& prefix);
+
+PSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
+  struct PrefixState
+  {
+    // Next sequence number to pass to the application
+    uint64_t nextToDeliver = 0;
+    // Sequence numbers not requested yet are [nextToRequest, highSeq]
+    uint64_t nextToRequest = 0;
+    uint64_t highSeq = 0;
+    // Data received ahead of nextToDeliver, or nullopt if given up
+    std::map<uint64_t, std::optional<ndn::Data>> received;
+    // Ranges given up without being requested, by first sequence number
+    std::map<uint64_t, uint64_t> skipped;
+    // Position in m_requestOrder, if there are sequence numbers to request
+    std::optional<std::list<const ndn::Name*>::iterator> orderIt;
+  };
+
+  struct Retransmission
+  {
+    ndn::Name prefix;
+    uint64_t seq;
+    int nRetries;
+  };
+
+  ndn::Face& m_face;
+  DataCallback m_onData;
+  FailureCallback m_onFailure;
+  NameFunction m_makeName;
+  ndn::time::milliseconds m_interestLifetime;
+  int m_maxRetries;
+  double m_aiStep;
+  double m_mdCoef;
+  uint64_t m_maxBacklogPerPrefix;
+
+  std::map<ndn::Name, PrefixState> m_prefixes;
+  // Prefixes with sequence numbers to request, most recently updated first
+  std::list<const ndn::Name*> m_requestOrder;
+  std::deque<Retransmission> m_retransmissions;
+
+  double m_cwnd;
+  double m_ssthresh;
+  // Interests are numbered in sending order, the window is decreased once for the
+  // Interests sent before a decrease
+  uint64_t m_nextId = 0;
+  uint64_t m_recoveryPoint = 0;
+  std::unordered_map<uint64_t, ndn::ScopedPendingInterestHandle> m_inFlight;
+};
+
+} // namespace psync
+
+#endif // PSYNC_UPDATE_FETCHER_HPP
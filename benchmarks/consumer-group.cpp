@@ -0,0 +1,148 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE PSync Consumer Group Benchmark
+
+#include "PSync/consumer-group.hpp"
+
+#include "tests/allocation-counter.hpp"
+#include "tests/boost-test.hpp"
+#include "tests/io-fixture.hpp"
+#include "tests/key-chain-fixture.hpp"
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <chrono>
+#include <iostream>
+
+namespace psync::benchmarks {
+
+using ndn::Name;
+
+/**
+ * @brief Cost of following many sync groups with a ConsumerGroup or with independent Consumers
+ *
+ * Each of N_GROUPS sync groups gets one subscription and sends a hello Interest that no
+ * producer answers, so that the hello Interests time out and are retried for a while.
+ * The heap allocations of the setup, the number of schedulers (one asio timer each), and
+ * the wall time of the retries are reported for both ways. The group must make fewer
+ * allocations: each sync group saves the scheduler of a Consumer with its timer, and its
+ * Consumer is kept in the node of the group rather than allocated on its own.
+ */
+class ConsumerGroupFixture : public tests::IoFixture, public tests::KeyChainFixture
+{
+protected:
+  static constexpr size_t N_GROUPS = 1000;
+  static constexpr ndn::time::seconds RETRY_DURATION = 10_s;
+
+  static Name
+  makeSyncPrefix(size_t i)
+  {
+    return "/psync-" + std::to_string(i);
+  }
+
+  static Consumer::Options
+  makeConsumerOptions()
+  {
+    Consumer::Options opts;
+    opts.helloInterestLifetime = 1_s;
+    return opts;
+  }
+
+  /**
+   * @brief Reports the cost of @p setup and of the retries that follow
+   *
+   * @return the number of heap allocations of @p setup
+   */
+  template<typename Setup>
+  size_t
+  run(const std::string& mode, size_t nSchedulers, Setup&& setup)
+  {
+    tests::AllocationCounter counter;
+    auto wallStart = std::chrono::steady_clock::now();
+    setup();
+    double setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                        wallStart).count();
+    counter.stop();
+
+    wallStart = std::chrono::steady_clock::now();
+    advanceClocks(10_ms, RETRY_DURATION);
+    double retrySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                        wallStart).count();
+
+    std::cout << "{\"benchmark\": \"consumer-group\", "
+              << "\"mode\": \"" << mode << "\", "
+              << "\"groups\": " << N_GROUPS << ", "
+              << "\"schedulers\": " << nSchedulers << ", "
+              << "\"setupAllocations\": " << counter.getNAllocations() << ", "
+              << "\"setupBytes\": " << counter.getNBytes() << ", "
+              << "\"setupSeconds\": " << setupSeconds << ", "
+              << "\"interestsSent\": " << m_face.sentInterests.size() << ", "
+              << "\"retrySeconds\": " << retrySeconds << "}" << std::endl;
+    return counter.getNAllocations();
+  }
+
+protected:
+  ndn::DummyClientFace m_face{m_io, m_keyChain, {true, false}};
+  // Set by IndependentConsumers, which runs before Group
+  static inline size_t s_consumersAllocations = 0;
+};
+
+BOOST_FIXTURE_TEST_SUITE(ConsumerGroupCost, ConsumerGroupFixture)
+
+BOOST_AUTO_TEST_CASE(IndependentConsumers)
+{
+  std::vector<std::unique_ptr<Consumer>> consumers;
+  s_consumersAllocations = run("consumers", N_GROUPS, [&] {
+    for (size_t i = 0; i < N_GROUPS; i++) {
+      auto consumer = std::make_unique<Consumer>(m_face, makeSyncPrefix(i), makeConsumerOptions());
+      consumer->addSubscription(Name(makeSyncPrefix(i)).append("user"), 0);
+      consumer->sendHelloInterest();
+      consumers.push_back(std::move(consumer));
+    }
+  });
+
+  for (auto& consumer : consumers) {
+    consumer->stop();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Group, *boost::unit_test::depends_on("ConsumerGroupCost/IndependentConsumers"))
+{
+  ConsumerGroup::Options opts;
+  opts.consumerOptions = makeConsumerOptions();
+  // Do not hold back hello Interests, so that both ways send the same Interests
+  opts.maxConcurrentHellos = N_GROUPS;
+  std::unique_ptr<ConsumerGroup> group;
+  auto nAllocations = run("group", 1, [&] {
+    group = std::make_unique<ConsumerGroup>(m_face, opts);
+    for (size_t i = 0; i < N_GROUPS; i++) {
+      auto consumer = group->addSyncGroup(makeSyncPrefix(i));
+      consumer->addSubscription(Name(makeSyncPrefix(i)).append("user"), 0);
+    }
+    group->sendHelloInterests();
+  });
+  BOOST_CHECK_LT(nAllocations, s_consumersAllocations);
+
+  group->stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::benchmarks
@@ -0,0 +1,643 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE PSync Convergence Simulator
+
+#include "PSync/consumer.hpp"
+#include "PSync/full-producer.hpp"
+#include "PSync/partial-producer.hpp"
+
+#include "tests/boost-test.hpp"
+#include "tests/io-fixture.hpp"
+#include "tests/key-chain-fixture.hpp"
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <unordered_map>
+
+namespace psync::benchmarks {
+
+using ndn::Interest;
+using ndn::Data;
+using ndn::Name;
+namespace time = ndn::time;
+
+template<typename T>
+static T
+getEnv(const char* name, T defaultValue)
+{
+  const char* value = std::getenv(name);
+  return value == nullptr ? defaultValue : boost::lexical_cast<T>(value);
+}
+
+/**
+ * @brief Parameters of a simulation, read from the environment
+ */
+struct SimulationConfig
+{
+  /// PSYNC_SIM_NODES: number of nodes
+  size_t nNodes = getEnv<size_t>("PSYNC_SIM_NODES", 100);
+  /// PSYNC_SIM_TOPOLOGY: ring, grid, star, mesh or random
+  std::string topology = getEnv<std::string>("PSYNC_SIM_TOPOLOGY", "random");
+  /// PSYNC_SIM_DEGREE: mean number of neighbors of the random topology
+  size_t degree = getEnv<size_t>("PSYNC_SIM_DEGREE", 4);
+  /// PSYNC_SIM_DELAY_MS: one-way delay of each link
+  time::milliseconds delay{getEnv<int64_t>("PSYNC_SIM_DELAY_MS", 10)};
+  /// PSYNC_SIM_DELAY_JITTER_MS: each link gets an extra delay drawn in [0, jitter]
+  time::milliseconds delayJitter{getEnv<int64_t>("PSYNC_SIM_DELAY_JITTER_MS", 10)};
+  /// PSYNC_SIM_LOSS: probability that a packet sent on a link is lost
+  double lossRate = getEnv<double>("PSYNC_SIM_LOSS", 0.0);
+  /// PSYNC_SIM_BANDWIDTH_KBPS: bandwidth of each direction of a link; zero for unlimited
+  double bandwidthKbps = getEnv<double>("PSYNC_SIM_BANDWIDTH_KBPS", 0.0);
+  /// PSYNC_SIM_IBF_COUNT: expected number of entries in the IBF of the producers
+  uint32_t ibfCount = getEnv<uint32_t>("PSYNC_SIM_IBF_COUNT", 80);
+  /// PSYNC_SIM_INTEREST_LIFETIME_MS: lifetime of sync Interests
+  time::milliseconds syncInterestLifetime{getEnv<int64_t>("PSYNC_SIM_INTEREST_LIFETIME_MS",
+                                                          SYNC_INTEREST_LIFETIME.count())};
+  /// PSYNC_SIM_FRESHNESS_MS: FreshnessPeriod of sync Data
+  time::milliseconds syncDataFreshness{getEnv<int64_t>("PSYNC_SIM_FRESHNESS_MS",
+                                                       SYNC_REPLY_FRESHNESS.count())};
+  /// PSYNC_SIM_PUBLISHERS: number of publishing prefixes; zero for one per node
+  size_t nPublishers = getEnv<size_t>("PSYNC_SIM_PUBLISHERS", 0);
+  /// PSYNC_SIM_PUBLISH_INTERVAL_MS: mean time between two publications of a prefix
+  double publishIntervalMs = getEnv<double>("PSYNC_SIM_PUBLISH_INTERVAL_MS", 5000);
+  /// PSYNC_SIM_SUBSCRIPTIONS: number of prefixes each Consumer subscribes to
+  size_t nSubscriptions = getEnv<size_t>("PSYNC_SIM_SUBSCRIPTIONS", 10);
+  /// PSYNC_SIM_WARMUP_S: time given to the nodes to start before publishing
+  time::seconds warmup{getEnv<int64_t>("PSYNC_SIM_WARMUP_S", 5)};
+  /// PSYNC_SIM_DURATION_S: time during which prefixes are published
+  time::seconds duration{getEnv<int64_t>("PSYNC_SIM_DURATION_S", 60)};
+  /// PSYNC_SIM_DRAIN_S: time given to the last publications to spread
+  time::seconds drain{getEnv<int64_t>("PSYNC_SIM_DRAIN_S", 30)};
+  /// PSYNC_SIM_SEED: seed of the topology, the losses and the workload
+  uint64_t seed = getEnv<uint64_t>("PSYNC_SIM_SEED", 1);
+};
+
+/**
+ * @brief Simulation of a sync group of many nodes, in virtual time
+ *
+ * Every node has its own DummyClientFace. The faces are connected by a small
+ * forwarder per node that keeps a PIT and sends packets over links with a delay,
+ * a loss rate and a bandwidth, so that a packet waits for the previous ones sent
+ * on the same link.
+ *
+ * FullSync runs one FullProducer per node, each publishing its own prefix. As in
+ * NLSR, sync Interests are multicast to the neighbors only and the state spreads
+ * hop by hop. The segments after the first are asked to the neighbor that sent it.
+ *
+ * PartialSync runs a PartialProducer on node 0 and a Consumer on every other node,
+ * subscribed to a random subset of the producer's prefixes. Interests are forwarded
+ * to node 0 along a shortest path tree and Data follow the PIT back.
+ *
+ * The parameters are read from the environment, see SimulationConfig. The results are printed
+ * as one JSON object: the time for each publication to reach every node that
+ * wants it, the packets and bytes sent per node, how often whole states were sent
+ * and how often IBF differences could not be decoded. They are meant for sizing
+ * ibfCount, the Interest lifetime and the Data freshness of a group.
+ */
+class ConvergenceSimulatorFixture : public tests::IoFixture, public tests::KeyChainFixture
+{
+protected:
+  struct Link
+  {
+    size_t neighbor;
+    time::nanoseconds delay;
+    // When the last packet sent on this link will have been transmitted
+    time::steady_clock::time_point busyUntil;
+  };
+
+  struct PitEntry
+  {
+    Interest interest;
+    size_t downstream;
+    time::steady_clock::time_point expiry;
+  };
+
+  struct Node
+  {
+    std::unique_ptr<ndn::DummyClientFace> face;
+    std::vector<Link> links;
+    std::vector<PitEntry> pit;
+    // FullSync: neighbor that sent the first segment of a reply, by hash of the reply name
+    // without version and segment
+    std::unordered_map<size_t, size_t> segmentUpstream;
+    // PartialSync: next hop towards node 0
+    size_t parent = 0;
+    uint64_t nInterestsSent = 0;
+    uint64_t nDataSent = 0;
+    uint64_t nBytesSent = 0;
+  };
+
+  // Reception of a publication by the nodes that want it
+  struct Publication
+  {
+    time::steady_clock::time_point time;
+    size_t nExpected = 0;
+    size_t nReceived = 0;
+    time::steady_clock::time_point lastReceived;
+  };
+
+  ConvergenceSimulatorFixture()
+    : m_rng(m_config.seed)
+  {
+    m_nodes.resize(m_config.nNodes);
+    for (size_t i = 0; i < m_nodes.size(); i++) {
+      m_nodes[i].face = std::make_unique<ndn::DummyClientFace>(m_io, m_keyChain,
+                                                               ndn::DummyClientFace::Options{false, true});
+      m_nodes[i].face->onSendInterest.connect([this, i] (const Interest& interest) {
+        onLocalInterest(i, interest);
+      });
+      m_nodes[i].face->onSendData.connect([this, i] (const Data& data) {
+        satisfyPit(i, data);
+      });
+    }
+    makeTopology();
+  }
+
+  void
+  addLink(size_t a, size_t b)
+  {
+    if (a == b || std::any_of(m_nodes[a].links.begin(), m_nodes[a].links.end(),
+                              [b] (const Link& link) { return link.neighbor == b; })) {
+      return;
+    }
+    std::uniform_int_distribution<int64_t> jitter(0, m_config.delayJitter.count());
+    time::nanoseconds delay = m_config.delay + time::milliseconds(jitter(m_rng));
+    m_nodes[a].links.push_back({b, delay, {}});
+    m_nodes[b].links.push_back({a, delay, {}});
+    ++m_nLinks;
+  }
+
+  void
+  makeTopology()
+  {
+    size_t n = m_nodes.size();
+    const auto& topology = m_config.topology;
+    if (topology == "ring" || topology == "random") {
+      for (size_t i = 0; n > 1 && i < n; i++) {
+        addLink(i, (i + 1) % n);
+      }
+      if (topology == "random") {
+        // The ring keeps the graph connected, random chords bring the mean degree up
+        std::uniform_int_distribution<size_t> pick(0, n - 1);
+        size_t nChords = n * std::max<size_t>(m_config.degree, 2) / 2 - n;
+        for (size_t i = 0; i < nChords * 4 && m_nLinks < n + nChords; i++) {
+          addLink(pick(m_rng), pick(m_rng));
+        }
+      }
+    }
+    else if (topology == "grid") {
+      size_t width = static_cast<size_t>(std::ceil(std::sqrt(n)));
+      for (size_t i = 0; i < n; i++) {
+        if ((i + 1) % width != 0 && i + 1 < n) {
+          addLink(i, i + 1);
+        }
+        if (i + width < n) {
+          addLink(i, i + width);
+        }
+      }
+    }
+    else if (topology == "star") {
+      for (size_t i = 1; i < n; i++) {
+        addLink(0, i);
+      }
+    }
+    else if (topology == "mesh") {
+      for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+          addLink(i, j);
+        }
+      }
+    }
+    else {
+      BOOST_FAIL("unknown topology " << topology);
+    }
+
+    // Shortest path tree towards node 0, in number of hops
+    std::vector<bool> isVisited(n);
+    std::queue<size_t> queue;
+    queue.push(0);
+    isVisited[0] = true;
+    while (!queue.empty()) {
+      size_t node = queue.front();
+      queue.pop();
+      for (const auto& link : m_nodes[node].links) {
+        if (!isVisited[link.neighbor]) {
+          isVisited[link.neighbor] = true;
+          m_nodes[link.neighbor].parent = node;
+          queue.push(link.neighbor);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Send a packet of @p size bytes from @p from to its neighbor @p to, then call @p onArrival
+   */
+  void
+  transmit(size_t from, size_t to, size_t size, std::function<void()> onArrival)
+  {
+    auto& node = m_nodes[from];
+    node.nBytesSent += size;
+    auto link = std::find_if(node.links.begin(), node.links.end(),
+                             [to] (const Link& l) { return l.neighbor == to; });
+    BOOST_ASSERT(link != node.links.end());
+
+    auto now = time::steady_clock::now();
+    auto sent = std::max(now, link->busyUntil);
+    if (m_config.bandwidthKbps > 0) {
+      sent += time::nanoseconds(static_cast<int64_t>(size * 8e6 / m_config.bandwidthKbps));
+    }
+    link->busyUntil = sent;
+
+    if (m_loss(m_rng)) {
+      return;
+    }
+    m_scheduler.schedule(sent - now + link->delay, std::move(onArrival));
+  }
+
+  void
+  sendInterest(size_t from, size_t to, const Interest& interest)
+  {
+    ++m_nodes[from].nInterestsSent;
+    transmit(from, to, interest.wireEncode().size(),
+             [=] { onRemoteInterest(to, from, interest); });
+  }
+
+  void
+  sendData(size_t from, size_t to, const Data& data)
+  {
+    ++m_nodes[from].nDataSent;
+    transmit(from, to, data.wireEncode().size(),
+             [=] { onRemoteData(to, from, data); });
+  }
+
+  bool
+  isSegmentName(const Name& name) const
+  {
+    // /<sync-prefix>/<IBF>/<numCumulativeElements>/<version>/<segment>
+    return m_isFullSync && name.size() == m_syncPrefix.size() + 4;
+  }
+
+  void
+  onLocalInterest(size_t node, const Interest& interest)
+  {
+    auto& n = m_nodes[node];
+    if (!m_isFullSync) {
+      if (node != 0) {
+        sendInterest(node, n.parent, interest);
+      }
+      return;
+    }
+
+    if (isSegmentName(interest.getName())) {
+      auto it = n.segmentUpstream.find(std::hash<Name>{}(interest.getName().getPrefix(-2)));
+      if (it != n.segmentUpstream.end()) {
+        sendInterest(node, it->second, interest);
+        return;
+      }
+    }
+    for (const auto& link : n.links) {
+      sendInterest(node, link.neighbor, interest);
+    }
+  }
+
+  void
+  onRemoteInterest(size_t node, size_t from, const Interest& interest)
+  {
+    auto& n = m_nodes[node];
+    n.pit.push_back({interest, from, time::steady_clock::now() + interest.getInterestLifetime()});
+    if (m_isFullSync || node == 0) {
+      n.face->receive(interest);
+    }
+    else {
+      sendInterest(node, n.parent, interest);
+    }
+  }
+
+  void
+  onRemoteData(size_t node, size_t from, const Data& data)
+  {
+    auto& n = m_nodes[node];
+    if (isSegmentName(data.getName())) {
+      if (n.segmentUpstream.size() > MAX_SEGMENT_UPSTREAMS) {
+        n.segmentUpstream.clear();
+      }
+      n.segmentUpstream[std::hash<Name>{}(data.getName().getPrefix(-2))] = from;
+    }
+    satisfyPit(node, data);
+    // Dropped by the face unless the local application asked for it
+    n.face->receive(data);
+  }
+
+  void
+  satisfyPit(size_t node, const Data& data)
+  {
+    auto& pit = m_nodes[node].pit;
+    auto now = time::steady_clock::now();
+    std::vector<size_t> downstreams;
+    pit.erase(std::remove_if(pit.begin(), pit.end(), [&] (const PitEntry& entry) {
+      if (entry.expiry < now) {
+        return true;
+      }
+      if (entry.interest.matchesData(data)) {
+        downstreams.push_back(entry.downstream);
+        return true;
+      }
+      return false;
+    }), pit.end());
+
+    std::sort(downstreams.begin(), downstreams.end());
+    downstreams.erase(std::unique(downstreams.begin(), downstreams.end()), downstreams.end());
+    for (size_t downstream : downstreams) {
+      sendData(node, downstream, data);
+    }
+  }
+
+  /**
+   * @brief Record the publication of @p seq of @p prefix, expected by @p nExpected nodes
+   */
+  void
+  onPublish(const Name& prefix, uint64_t seq, size_t nExpected)
+  {
+    auto& publication = m_publications[{prefix, seq}];
+    publication.time = time::steady_clock::now();
+    publication.nExpected = nExpected;
+  }
+
+  void
+  onUpdate(const std::vector<MissingDataInfo>& updates)
+  {
+    auto now = time::steady_clock::now();
+    for (const auto& update : updates) {
+      for (auto seq = update.lowSeq; seq <= update.highSeq; ++seq) {
+        auto it = m_publications.find({update.prefix, seq});
+        if (it != m_publications.end()) {
+          ++it->second.nReceived;
+          it->second.lastReceived = now;
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Publish the prefixes at random, exponentially distributed intervals
+   *        during the configured duration, then let the group settle
+   */
+  void
+  run(size_t nPrefixes, const std::function<void(size_t)>& publish)
+  {
+    advanceClocks(1_ms, m_config.warmup);
+
+    auto end = time::steady_clock::now() + m_config.duration;
+    std::exponential_distribution<double> interval(1 / m_config.publishIntervalMs);
+    std::vector<ndn::scheduler::ScopedEventId> events(nPrefixes);
+    std::function<void(size_t)> schedulePublish = [&] (size_t i) {
+      auto after = time::microseconds(static_cast<int64_t>(interval(m_rng) * 1000));
+      if (time::steady_clock::now() + after < end) {
+        events[i] = m_scheduler.schedule(after, [&, i] {
+          publish(i);
+          schedulePublish(i);
+        });
+      }
+    };
+    for (size_t i = 0; i < nPrefixes; i++) {
+      schedulePublish(i);
+    }
+
+    advanceClocks(1_ms, m_config.duration + m_config.drain);
+    m_workloadEnd = end;
+  }
+
+  static double
+  percentile(std::vector<double> values, double p)
+  {
+    if (values.empty()) {
+      return 0;
+    }
+    auto nth = values.begin() + static_cast<ptrdiff_t>(p * (values.size() - 1));
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+  }
+
+  void
+  printResults(const std::vector<ProducerStats>& producerStats, size_t nConsumerFetchErrors)
+  {
+    std::vector<double> convergenceMs;
+    auto lastReceived = m_workloadEnd;
+    for (const auto& [key, publication] : m_publications) {
+      if (publication.nReceived >= publication.nExpected) {
+        auto latency = publication.nExpected == 0 ? time::nanoseconds(0) :
+                       publication.lastReceived - publication.time;
+        convergenceMs.push_back(time::duration_cast<time::microseconds>(latency).count() / 1000.0);
+        lastReceived = std::max(lastReceived, publication.lastReceived);
+      }
+    }
+    bool hasConverged = convergenceMs.size() == m_publications.size();
+
+    uint64_t nInterests = 0;
+    uint64_t nData = 0;
+    uint64_t nBytes = 0;
+    uint64_t maxBytes = 0;
+    for (const auto& node : m_nodes) {
+      nInterests += node.nInterestsSent;
+      nData += node.nDataSent;
+      nBytes += node.nBytesSent;
+      maxBytes = std::max(maxBytes, node.nBytesSent);
+    }
+
+    ProducerStats total;
+    for (const auto& stats : producerStats) {
+      total.nSyncInterests += stats.nSyncInterests;
+      total.nDecodeSuccesses += stats.nDecodeSuccesses;
+      total.nDecodeFailures += stats.nDecodeFailures;
+      total.nReplies += stats.nReplies;
+      total.nFullStateReplies += stats.nFullStateReplies;
+      total.nNacks += stats.nNacks;
+    }
+    uint64_t nDecodes = total.nDecodeSuccesses + total.nDecodeFailures;
+    double nNodeMinutes = m_nodes.size() *
+                          time::duration_cast<time::seconds>(m_config.warmup + m_config.duration +
+                                                             m_config.drain).count() / 60.0;
+
+    std::cout << "{\"benchmark\": \"convergence\", "
+              << "\"mode\": \"" << (m_isFullSync ? "full" : "partial") << "\", "
+              << "\"nodes\": " << m_nodes.size() << ", "
+              << "\"topology\": \"" << m_config.topology << "\", "
+              << "\"links\": " << m_nLinks << ", "
+              << "\"delayMs\": " << m_config.delay.count() << ", "
+              << "\"delayJitterMs\": " << m_config.delayJitter.count() << ", "
+              << "\"lossRate\": " << m_config.lossRate << ", "
+              << "\"bandwidthKbps\": " << m_config.bandwidthKbps << ", "
+              << "\"ibfCount\": " << m_config.ibfCount << ", "
+              << "\"syncInterestLifetimeMs\": " << m_config.syncInterestLifetime.count() << ", "
+              << "\"syncDataFreshnessMs\": " << m_config.syncDataFreshness.count() << ", "
+              << "\"publishIntervalMs\": " << m_config.publishIntervalMs << ", "
+              << "\"publications\": " << m_publications.size() << ", "
+              << "\"converged\": " << convergenceMs.size() << ", "
+              << "\"convergenceMeanMs\": " << (convergenceMs.empty() ? 0 :
+                   std::accumulate(convergenceMs.begin(), convergenceMs.end(), 0.0) / convergenceMs.size()) << ", "
+              << "\"convergenceP50Ms\": " << percentile(convergenceMs, 0.50) << ", "
+              << "\"convergenceP95Ms\": " << percentile(convergenceMs, 0.95) << ", "
+              << "\"convergenceP99Ms\": " << percentile(convergenceMs, 0.99) << ", "
+              << "\"convergenceMaxMs\": " << percentile(convergenceMs, 1.0) << ", "
+              // Time from the end of the workload until every publication reached every node,
+              // -1 if some never did
+              << "\"settleMs\": " << (hasConverged ?
+                   time::duration_cast<time::milliseconds>(lastReceived - m_workloadEnd).count() : -1) << ", "
+              << "\"interestsPerNode\": " << static_cast<double>(nInterests) / m_nodes.size() << ", "
+              << "\"dataPerNode\": " << static_cast<double>(nData) / m_nodes.size() << ", "
+              << "\"bytesPerNode\": " << static_cast<double>(nBytes) / m_nodes.size() << ", "
+              << "\"maxBytesPerNode\": " << maxBytes << ", "
+              << "\"syncInterests\": " << total.nSyncInterests << ", "
+              << "\"replies\": " << total.nReplies << ", "
+              << "\"fullStateReplies\": " << total.nFullStateReplies << ", "
+              << "\"fullStateRepliesPerNodeMinute\": " << total.nFullStateReplies / nNodeMinutes << ", "
+              << "\"decodeFailureRate\": " << (nDecodes == 0 ? 0.0 :
+                   static_cast<double>(total.nDecodeFailures) / nDecodes) << ", "
+              << "\"nacks\": " << total.nNacks << ", "
+              << "\"consumerFetchErrors\": " << nConsumerFetchErrors << "}" << std::endl;
+  }
+
+protected:
+  static constexpr size_t MAX_SEGMENT_UPSTREAMS = 4096;
+
+  const SimulationConfig m_config;
+  const Name m_syncPrefix = "/psync";
+  std::mt19937_64 m_rng;
+  std::bernoulli_distribution m_loss{m_config.lossRate};
+  ndn::Scheduler m_scheduler{m_io};
+  std::vector<Node> m_nodes;
+  size_t m_nLinks = 0;
+  bool m_isFullSync = true;
+  std::map<std::pair<Name, uint64_t>, Publication> m_publications;
+  time::steady_clock::time_point m_workloadEnd;
+};
+
+BOOST_FIXTURE_TEST_SUITE(ConvergenceSimulator, ConvergenceSimulatorFixture)
+
+BOOST_AUTO_TEST_CASE(FullSync)
+{
+  m_isFullSync = true;
+  size_t nNodes = m_nodes.size();
+  size_t nPublishers = m_config.nPublishers == 0 ? nNodes : std::min(m_config.nPublishers, nNodes);
+
+  std::vector<std::unique_ptr<FullProducer>> producers;
+  for (size_t i = 0; i < nNodes; i++) {
+    FullProducer::Options opts;
+    opts.onUpdate = [this] (const auto& updates) { onUpdate(updates); };
+    opts.ibfCount = m_config.ibfCount;
+    opts.syncInterestLifetime = m_config.syncInterestLifetime;
+    opts.syncDataFreshness = m_config.syncDataFreshness;
+    producers.push_back(std::make_unique<FullProducer>(*m_nodes[i].face, m_keyChain, m_syncPrefix, opts));
+    producers.back()->addUserNode("/sim/node-" + std::to_string(i));
+  }
+
+  run(nPublishers, [&] (size_t i) {
+    Name prefix("/sim/node-" + std::to_string(i));
+    producers[i]->publishName(prefix);
+    onPublish(prefix, producers[i]->getSeqNo(prefix).value(), nNodes - 1);
+  });
+
+  std::vector<ProducerStats> stats;
+  for (const auto& producer : producers) {
+    stats.push_back(producer->getStats());
+  }
+  printResults(stats, 0);
+}
+
+BOOST_AUTO_TEST_CASE(PartialSync)
+{
+  m_isFullSync = false;
+  size_t nNodes = m_nodes.size();
+  size_t nPrefixes = m_config.nPublishers == 0 ? nNodes : m_config.nPublishers;
+
+  PartialProducer::Options producerOpts;
+  producerOpts.ibfCount = m_config.ibfCount;
+  producerOpts.syncDataFreshness = m_config.syncDataFreshness;
+  PartialProducer producer(*m_nodes[0].face, m_keyChain, m_syncPrefix, producerOpts);
+  std::vector<Name> prefixes;
+  for (size_t i = 0; i < nPrefixes; i++) {
+    prefixes.emplace_back("/sim/prefix-" + std::to_string(i));
+    producer.addUserNode(prefixes.back());
+  }
+
+  // Number of consumers of each prefix
+  std::vector<size_t> nSubscribers(nPrefixes);
+  std::vector<size_t> indexes(nPrefixes);
+  std::iota(indexes.begin(), indexes.end(), 0);
+  std::vector<std::unique_ptr<Consumer>> consumers(nNodes);
+  for (size_t i = 1; i < nNodes; i++) {
+    std::vector<size_t> chosen;
+    std::sample(indexes.begin(), indexes.end(), std::back_inserter(chosen), m_config.nSubscriptions, m_rng);
+    std::vector<Name> subscriptions;
+    for (size_t j : chosen) {
+      ++nSubscribers[j];
+      subscriptions.push_back(prefixes[j]);
+    }
+
+    Consumer::Options opts;
+    opts.bfCount = static_cast<uint32_t>(std::max<size_t>(subscriptions.size(), 1));
+    opts.syncInterestLifetime = m_config.syncInterestLifetime;
+    opts.onHelloData = [i, subscriptions, &consumers] (const auto& available) {
+      std::map<Name, uint64_t> wanted;
+      for (const auto& prefix : subscriptions) {
+        auto it = available.find(prefix);
+        if (it != available.end()) {
+          wanted.emplace(prefix, it->second);
+        }
+      }
+      consumers[i]->addSubscriptions(wanted, false);
+      consumers[i]->sendSyncInterest();
+    };
+    opts.onUpdate = [this] (const auto& updates) { onUpdate(updates); };
+    consumers[i] = std::make_unique<Consumer>(*m_nodes[i].face, m_syncPrefix, opts);
+  }
+  advanceClocks(1_ms, 10);
+  for (size_t i = 1; i < nNodes; i++) {
+    consumers[i]->sendHelloInterest();
+  }
+
+  run(nPrefixes, [&] (size_t i) {
+    producer.publishName(prefixes[i]);
+    onPublish(prefixes[i], producer.getSeqNo(prefixes[i]).value(), nSubscribers[i]);
+  });
+
+  size_t nFetchErrors = 0;
+  for (size_t i = 1; i < nNodes; i++) {
+    nFetchErrors += consumers[i]->getStats().nFetchErrors;
+    consumers[i]->stop();
+  }
+  printResults({producer.getStats()}, nFetchErrors);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::benchmarks
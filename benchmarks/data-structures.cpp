@@ -0,0 +1,365 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE PSync Data Structures Benchmark
+
+#include "PSync/detail/bloom-filter.hpp"
+#include "PSync/detail/iblt.hpp"
+#include "PSync/detail/state.hpp"
+#include "PSync/detail/util.hpp"
+
+#include "tests/boost-test.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <numeric>
+
+namespace psync::benchmarks {
+
+using namespace psync::detail;
+using ndn::Name;
+
+/**
+ * @brief Timings of the IBLT, Bloom filter, hash, State and compression kernels
+ *
+ * Each measurement is printed as one JSON object per line, with the time per
+ * operation in nanoseconds, so that the output of two builds can be compared.
+ */
+class DataStructuresFixture
+{
+protected:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Returns the mean time of @p op in nanoseconds, over at least @p minIterations
+   *        calls and 100 milliseconds
+   */
+  template<typename Op>
+  static double
+  measure(Op&& op, size_t minIterations = 100)
+  {
+    // Warm up the caches and the allocator
+    op();
+
+    size_t nIterations = 0;
+    auto start = Clock::now();
+    Clock::duration elapsed{};
+    do {
+      for (size_t i = 0; i < minIterations; i++) {
+        op();
+      }
+      nIterations += minIterations;
+      elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(100));
+    return std::chrono::duration<double, std::nano>(elapsed).count() / nIterations;
+  }
+
+  static Name
+  makeName(size_t nComponents, uint64_t i)
+  {
+    Name name;
+    for (size_t j = 1; j < nComponents; j++) {
+      name.append("component-" + std::to_string(j));
+    }
+    return name.appendNumber(i);
+  }
+
+  static Name
+  makePrefix(uint64_t i)
+  {
+    return Name("/psync/benchmark/node").appendNumber(i);
+  }
+
+  static uint32_t
+  makeKey(uint64_t i)
+  {
+    return murmurHash3(N_HASHCHECK, Name(makePrefix(i)).appendNumber(1));
+  }
+
+  static IBLT
+  makeIblt(size_t expectedNumEntries, uint64_t first, uint64_t last,
+           CompressionScheme scheme = CompressionScheme::NONE)
+  {
+    IBLT iblt(expectedNumEntries, scheme);
+    for (uint64_t i = first; i < last; i++) {
+      iblt.insert(makeKey(i));
+    }
+    return iblt;
+  }
+
+  static State
+  makeState(size_t nEntries)
+  {
+    State state;
+    for (size_t i = 0; i < nEntries; i++) {
+      state.addContent(Name(makePrefix(i)).appendNumber(i + 1));
+    }
+    return state;
+  }
+
+  static const char*
+  getSchemeName(CompressionScheme scheme)
+  {
+    switch (scheme) {
+      case CompressionScheme::NONE:
+        return "none";
+      case CompressionScheme::ZLIB:
+        return "zlib";
+      case CompressionScheme::GZIP:
+        return "gzip";
+      case CompressionScheme::BZIP2:
+        return "bzip2";
+      case CompressionScheme::LZMA:
+        return "lzma";
+      case CompressionScheme::ZSTD:
+        return "zstd";
+    }
+    return "unknown";
+  }
+
+  void
+  measureCompression(const std::string& payload, ndn::span<const uint8_t> buffer)
+  {
+    for (auto scheme : {CompressionScheme::NONE, CompressionScheme::ZLIB, CompressionScheme::GZIP,
+                        CompressionScheme::BZIP2, CompressionScheme::LZMA, CompressionScheme::ZSTD}) {
+      std::shared_ptr<ndn::Buffer> compressed;
+      try {
+        compressed = compress(scheme, buffer);
+      }
+      catch (const CompressionError&) {
+        // Not built in
+        continue;
+      }
+
+      double compressNs = measure([&] { m_sink += compress(scheme, buffer)->size(); }, 10);
+      double decompressNs = measure([&] { m_sink += decompress(scheme, *compressed)->size(); }, 10);
+      std::cout << "{\"benchmark\": \"compression\", "
+                << "\"payload\": \"" << payload << "\", "
+                << "\"scheme\": \"" << getSchemeName(scheme) << "\", "
+                << "\"bytes\": " << buffer.size() << ", "
+                << "\"compressedBytes\": " << compressed->size() << ", "
+                << "\"compressNs\": " << compressNs << ", "
+                << "\"decompressNs\": " << decompressNs << "}" << std::endl;
+    }
+  }
+
+protected:
+  // Consumes the results, so that the measured operations are not optimized out
+  volatile uint64_t m_sink = 0;
+};
+
+BOOST_FIXTURE_TEST_SUITE(DataStructures, DataStructuresFixture)
+
+BOOST_AUTO_TEST_CASE(IbltInsertErase)
+{
+  for (size_t expectedNumEntries : {40, 80, 1000, 10000}) {
+    IBLT iblt(expectedNumEntries, CompressionScheme::NONE);
+    uint32_t key = makeKey(0);
+    double insertNs = measure([&] { iblt.insert(key++); }, 1000);
+    double eraseNs = measure([&] { iblt.erase(--key); }, 1000);
+    std::cout << "{\"benchmark\": \"iblt-insert-erase\", "
+              << "\"expectedNumEntries\": " << expectedNumEntries << ", "
+              << "\"cells\": " << iblt.getHashTable().size() << ", "
+              << "\"insertNs\": " << insertNs << ", "
+              << "\"eraseNs\": " << eraseNs << "}" << std::endl;
+  }
+
+  for (size_t expectedNumEntries : {40, 80, 1000, 10000}) {
+    IBLT64 iblt(expectedNumEntries, CompressionScheme::NONE);
+    uint64_t key = (uint64_t{makeKey(0)} << 32) | makeKey(1);
+    double insertNs = measure([&] { iblt.insert(key++); }, 1000);
+    double eraseNs = measure([&] { iblt.erase(--key); }, 1000);
+    std::cout << "{\"benchmark\": \"iblt64-insert-erase\", "
+              << "\"expectedNumEntries\": " << expectedNumEntries << ", "
+              << "\"cells\": " << iblt.getHashTable().size() << ", "
+              << "\"insertNs\": " << insertNs << ", "
+              << "\"eraseNs\": " << eraseNs << "}" << std::endl;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(IbltEncode)
+{
+  for (size_t expectedNumEntries : {40, 80, 1000, 10000}) {
+    IBLT iblt = makeIblt(expectedNumEntries, 0, expectedNumEntries);
+    Name name;
+    iblt.appendToName(name);
+
+    double appendNs = measure([&] {
+      Name n;
+      iblt.appendToName(n);
+      m_sink += n.size();
+    });
+
+    IBLT received(expectedNumEntries, CompressionScheme::NONE);
+    double initializeNs = measure([&] { received.initialize(name.at(-1)); });
+    BOOST_CHECK_EQUAL(received, iblt);
+
+    std::cout << "{\"benchmark\": \"iblt-encode\", "
+              << "\"expectedNumEntries\": " << expectedNumEntries << ", "
+              << "\"bytes\": " << name.at(-1).value_size() << ", "
+              << "\"appendToNameNs\": " << appendNs << ", "
+              << "\"initializeNs\": " << initializeNs << "}" << std::endl;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(IbltDifference)
+{
+  for (size_t expectedNumEntries : {40, 80, 1000, 10000}) {
+    for (size_t nDiff : {0, 1, 10, 100, 1000, 10000}) {
+      if (nDiff > expectedNumEntries) {
+        continue;
+      }
+      // Same common entries, plus half of the difference on each side
+      IBLT own = makeIblt(expectedNumEntries, 0, expectedNumEntries + nDiff / 2);
+      IBLT received = makeIblt(expectedNumEntries, 0, expectedNumEntries);
+      for (uint64_t i = 0; i < nDiff - nDiff / 2; i++) {
+        received.insert(makeKey(2 * expectedNumEntries + i));
+      }
+
+      IBLTDiff diff = own - received;
+      double ns = measure([&] { m_sink += (own - received).positive.size(); });
+      std::cout << "{\"benchmark\": \"iblt-difference\", "
+                << "\"expectedNumEntries\": " << expectedNumEntries << ", "
+                << "\"difference\": " << nDiff << ", "
+                << "\"canDecode\": " << (diff.canDecode ? "true" : "false") << ", "
+                << "\"ns\": " << ns << "}" << std::endl;
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BloomFilterOps)
+{
+  for (auto layout : {BloomFilter::Layout::CLASSIC, BloomFilter::Layout::BLOCKED}) {
+    for (unsigned int count : {100, 1000, 100000}) {
+      std::vector<Name> names;
+      for (unsigned int i = 0; i < 2 * count; i++) {
+        names.push_back(makePrefix(i));
+      }
+
+      BloomFilter bf(count, 0.001, layout);
+      size_t next = 0;
+      double insertNs = measure([&] { bf.insert(names[next++ % count]); }, count);
+
+      // Half of the lookups are for names that were not inserted
+      next = 0;
+      double containsNs = measure([&] { m_sink += bf.contains(names[next++ % names.size()]); }, count);
+
+      Name name;
+      bf.appendToName(name);
+      double parseNs = measure([&] { m_sink += BloomFilter(count, 0.001, name.at(-1)).contains(names[0]); });
+
+      std::cout << "{\"benchmark\": \"bloom-filter\", "
+                << "\"layout\": \"" << (layout == BloomFilter::Layout::BLOCKED ? "blocked" : "classic") << "\", "
+                << "\"count\": " << count << ", "
+                << "\"bytes\": " << name.at(-1).value_size() << ", "
+                << "\"insertNs\": " << insertNs << ", "
+                << "\"containsNs\": " << containsNs << ", "
+                << "\"parseNs\": " << parseNs << "}" << std::endl;
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(NameHash)
+{
+  for (size_t nComponents : {1, 3, 5, 10, 20}) {
+    std::vector<Name> names;
+    for (uint64_t i = 0; i < 1024; i++) {
+      names.push_back(makeName(nComponents, i));
+    }
+
+    size_t next = 0;
+    double ns = measure([&] { m_sink += murmurHash3(N_HASHCHECK, names[next++ % names.size()]); },
+                        names.size());
+    std::cout << "{\"benchmark\": \"murmur-hash3-name\", "
+              << "\"components\": " << nComponents << ", "
+              << "\"bytes\": " << names[0].wireEncode().value_size() << ", "
+              << "\"ns\": " << ns << "}" << std::endl;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MultiSeedHash)
+{
+  std::vector<uint32_t> seeds(MURMUR_HASH3_LANES);
+  std::iota(seeds.begin(), seeds.end(), 0);
+  std::vector<uint32_t> hashes(seeds.size());
+
+  for (size_t nComponents : {1, 5, 20}) {
+    Name name = makeName(nComponents, 1);
+    const auto& wire = name.wireEncode();
+
+    double scalarNs = measure([&] {
+      for (size_t i = 0; i < seeds.size(); i++) {
+        hashes[i] = murmurHash3(wire.value(), wire.value_size(), seeds[i]);
+      }
+      m_sink += hashes[0];
+    }, 1000);
+    double lanesNs = measure([&] {
+      murmurHash3xN(wire.value(), wire.value_size(), seeds, hashes);
+      m_sink += hashes[0];
+    }, 1000);
+    std::cout << "{\"benchmark\": \"murmur-hash3-multi-seed\", "
+              << "\"seeds\": " << seeds.size() << ", "
+              << "\"bytes\": " << wire.value_size() << ", "
+              << "\"scalarNs\": " << scalarNs << ", "
+              << "\"lanesNs\": " << lanesNs << "}" << std::endl;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StateEncodeDecode)
+{
+  for (size_t nEntries : {10, 100, 1000, 10000, 100000}) {
+    State state = makeState(nEntries);
+
+    // State::wireEncode() caches its result, do what it does on a cache miss
+    double encodeNs = measure([&] {
+      ndn::EncodingEstimator estimator;
+      ndn::EncodingBuffer buffer(state.wireEncode(estimator), 0);
+      m_sink += state.wireEncode(buffer);
+    }, 1);
+
+    ndn::Block wire = state.wireEncode();
+    double decodeNs = measure([&] { m_sink += State(wire).getContent().size(); }, 1);
+
+    std::cout << "{\"benchmark\": \"state\", "
+              << "\"entries\": " << nEntries << ", "
+              << "\"bytes\": " << wire.size() << ", "
+              << "\"encodeNs\": " << encodeNs << ", "
+              << "\"decodeNs\": " << decodeNs << "}" << std::endl;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Compression)
+{
+  // IBF of sync Interests, with a typical and a large table
+  for (size_t expectedNumEntries : {80, 10000}) {
+    Name name;
+    makeIblt(expectedNumEntries, 0, expectedNumEntries / 2).appendToName(name);
+    measureCompression("ibf-" + std::to_string(expectedNumEntries), name.at(-1).value_bytes());
+  }
+
+  // Content of sync Data
+  for (size_t nEntries : {10, 1000, 100000}) {
+    ndn::Block wire = makeState(nEntries).wireEncode();
+    measureCompression("state-" + std::to_string(nEntries), {wire.data(), wire.size()});
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::benchmarks
@@ -0,0 +1,163 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE PSync Future Hash Benchmark
+
+#include "PSync/full-producer.hpp"
+#include "PSync/detail/util.hpp"
+
+#include "tests/boost-test.hpp"
+#include "tests/key-chain-fixture.hpp"
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace psync::benchmarks {
+
+using ndn::Interest;
+using ndn::Name;
+
+/**
+ * @brief FullProducer with the protected members used by the benchmark made public
+ */
+class Producer : public FullProducer
+{
+public:
+  using FullProducer::FullProducer;
+  using FullProducer::isFutureHash;
+  using ProducerBase::m_iblt;
+  using ProducerBase::findNameByHash;
+};
+
+/**
+ * @brief Cost of the future hash check of FullProducer on a large positive difference
+ *
+ * The producer has N_PREFIXES prefixes and receives sync Interests from a peer that has
+ * none of them, so that every prefix is in the positive difference. The check is timed
+ * on its own, next to the former computation of the next key from the prefix URI, then
+ * as part of the processing of sync Interests received by the face.
+ */
+class FutureHashFixture : public tests::KeyChainFixture
+{
+protected:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr uint32_t N_PREFIXES = 1000;
+  static constexpr uint32_t N_ROUNDS = 200;
+
+  FutureHashFixture()
+  {
+    for (uint32_t i = 0; i < N_PREFIXES; i++) {
+      Name prefix("/user-" + std::to_string(i));
+      m_producer.addUserNode(prefix);
+      m_producer.publishName(prefix, 1);
+    }
+    // Register the sync prefix, so that the face passes sync Interests to the producer
+    m_face.processEvents(10_ms);
+  }
+
+  static FullProducer::Options
+  makeOptions()
+  {
+    FullProducer::Options opts;
+    // Large enough to decode the whole state
+    opts.ibfCount = 4 * N_PREFIXES;
+    opts.ibfCompression = CompressionScheme::NONE;
+    opts.contentCompression = CompressionScheme::NONE;
+    return opts;
+  }
+
+  // Each Interest carries another IBF, so that none is answered from memory
+  Interest
+  makeSyncInterest(uint32_t i) const
+  {
+    detail::IBLT iblt(4 * N_PREFIXES, CompressionScheme::NONE);
+    iblt.insert(i + 1);
+    Name name(m_syncPrefix);
+    iblt.appendToName(name);
+    name.appendNumber(1);
+    return Interest(name);
+  }
+
+  static double
+  nanosecondsSince(Clock::time_point start, uint32_t n)
+  {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n;
+  }
+
+protected:
+  ndn::DummyClientFace m_face{m_keyChain, {false, true}};
+  const Name m_syncPrefix{"/psync"};
+  Producer m_producer{m_face, m_keyChain, m_syncPrefix, makeOptions()};
+};
+
+BOOST_FIXTURE_TEST_CASE(PositiveDifference, FutureHashFixture)
+{
+  detail::IBLT peer(4 * N_PREFIXES, CompressionScheme::NONE);
+  peer.insert(1);
+  auto diff = m_producer.m_iblt - peer;
+  BOOST_REQUIRE(diff.canDecode);
+  BOOST_REQUIRE_EQUAL(diff.positive.size(), N_PREFIXES);
+
+  // The check before the next keys were kept, for comparison
+  size_t nFuture = 0;
+  auto start = Clock::now();
+  for (uint32_t round = 0; round < N_ROUNDS; round++) {
+    for (auto hash : diff.positive) {
+      auto prefix = m_producer.findNameByHash(hash)->getPrefix(-1);
+      Name uriPrefix(prefix.toUri());
+      uriPrefix.appendNumber(m_producer.getSeqNo(prefix).value_or(0) + 1);
+      auto nextHash = detail::murmurHash3(detail::N_HASHCHECK, uriPrefix);
+      nFuture += std::binary_search(diff.negative.begin(), diff.negative.end(), nextHash);
+    }
+  }
+  double uriNs = nanosecondsSince(start, N_ROUNDS);
+
+  start = Clock::now();
+  for (uint32_t round = 0; round < N_ROUNDS; round++) {
+    for (auto hash : diff.positive) {
+      nFuture += m_producer.isFutureHash(hash, diff.negative);
+    }
+  }
+  double keptNs = nanosecondsSince(start, N_ROUNDS);
+  BOOST_CHECK_EQUAL(nFuture, 0);
+
+  std::vector<Interest> interests;
+  for (uint32_t i = 0; i < N_ROUNDS; i++) {
+    interests.push_back(makeSyncInterest(i));
+  }
+  auto nReplies = m_producer.getStats().nReplies;
+  start = Clock::now();
+  for (const auto& interest : interests) {
+    m_face.receive(interest);
+  }
+  double interestNs = nanosecondsSince(start, N_ROUNDS);
+  BOOST_CHECK_EQUAL(m_producer.getStats().nReplies, nReplies + N_ROUNDS);
+
+  std::cout << "{\"benchmark\": \"future-hash\", "
+            << "\"positive\": " << diff.positive.size() << ", "
+            << "\"uriCheckNs\": " << uriNs << ", "
+            << "\"checkNs\": " << keptNs << ", "
+            << "\"syncInterestNs\": " << interestNs << "}" << std::endl;
+}
+
+} // namespace psync::benchmarks
@@ -0,0 +1,208 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE PSync Prefix Table Benchmark
+
+#include "PSync/producer-base.hpp"
+#include "PSync/detail/util.hpp"
+
+#include "tests/boost-test.hpp"
+#include "tests/key-chain-fixture.hpp"
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <thread>
+
+namespace psync::benchmarks {
+
+using ndn::Name;
+
+/**
+ * @brief ProducerBase with the protected members used by the benchmark made public
+ */
+class Producer : public ProducerBase
+{
+public:
+  Producer(ndn::Face& face, ndn::KeyChain& keyChain)
+    : ProducerBase(face, keyChain, 80, "/psync")
+  {
+  }
+
+  using ProducerBase::updateSeqNo;
+  using ProducerBase::usePrefixTableFile;
+  using ProducerBase::getNumPrefixes;
+  using ProducerBase::findNameByHash;
+};
+
+/**
+ * @brief Producer state with many prefixes, kept on the heap or in a prefix table file
+ *
+ * The number of prefixes is read from PSYNC_BENCHMARK_PREFIXES (default 10 million).
+ * The heap backend runs after the file backend, so that the peak RSS of each
+ * can be told apart. LoadState compares loading all prefixes at once with
+ * adding them one by one in Heap.
+ */
+class PrefixTableFixture : public tests::KeyChainFixture
+{
+protected:
+  using Clock = std::chrono::steady_clock;
+
+  PrefixTableFixture()
+  {
+    if (const char* n = std::getenv("PSYNC_BENCHMARK_PREFIXES")) {
+      m_nPrefixes = std::strtoull(n, nullptr, 10);
+    }
+    std::filesystem::remove(m_path);
+  }
+
+  ~PrefixTableFixture()
+  {
+    std::filesystem::remove(m_path);
+  }
+
+  static double
+  secondsSince(Clock::time_point start)
+  {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  static long
+  getMaxRssKb()
+  {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+  }
+
+  static Name
+  makePrefix(uint64_t i)
+  {
+    return Name("/psync/benchmark/node").appendNumber(i);
+  }
+
+  void
+  run(const std::string& backend, Producer& producer)
+  {
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < m_nPrefixes; i++) {
+      Name prefix = makePrefix(i);
+      producer.addUserNode(prefix);
+      producer.updateSeqNo(prefix, 1);
+    }
+    double insertSeconds = secondsSince(start);
+
+    std::mt19937_64 rng(1);
+    std::uniform_int_distribution<uint64_t> dist(0, m_nPrefixes - 1);
+    start = Clock::now();
+    uint64_t nFound = 0;
+    for (size_t i = 0; i < N_LOOKUPS; i++) {
+      nFound += producer.getSeqNo(makePrefix(dist(rng))).has_value();
+    }
+    double lookupSeconds = secondsSince(start);
+
+    start = Clock::now();
+    for (size_t i = 0; i < N_LOOKUPS; i++) {
+      Name prefix = makePrefix(dist(rng));
+      nFound += producer.findNameByHash(detail::murmurHash3(detail::N_HASHCHECK,
+                                                            prefix.appendNumber(1))).has_value();
+    }
+    double hashLookupSeconds = secondsSince(start);
+
+    std::cout << "{\"benchmark\": \"prefix-table\", "
+              << "\"backend\": \"" << backend << "\", "
+              << "\"prefixes\": " << m_nPrefixes << ", "
+              << "\"insertSeconds\": " << insertSeconds << ", "
+              << "\"insertsPerSecond\": " << m_nPrefixes / insertSeconds << ", "
+              << "\"lookupNs\": " << lookupSeconds / N_LOOKUPS * 1e9 << ", "
+              << "\"hashLookupNs\": " << hashLookupSeconds / N_LOOKUPS * 1e9 << ", "
+              << "\"found\": " << nFound << ", "
+              << "\"maxRssKb\": " << getMaxRssKb();
+    if (std::filesystem::exists(m_path)) {
+      std::cout << ", \"fileBytes\": " << std::filesystem::file_size(m_path);
+    }
+    std::cout << "}" << std::endl;
+  }
+
+protected:
+  static constexpr size_t N_LOOKUPS = 1000000;
+
+  ndn::DummyClientFace m_face{m_keyChain};
+  uint64_t m_nPrefixes = 10000000;
+  const std::string m_path = (std::filesystem::temp_directory_path() / "psync-benchmark-prefixes").string();
+};
+
+BOOST_FIXTURE_TEST_SUITE(PrefixTable, PrefixTableFixture)
+
+BOOST_AUTO_TEST_CASE(File)
+{
+  {
+    Producer producer(m_face, m_keyChain);
+    producer.usePrefixTableFile(m_path, m_nPrefixes);
+    run("file", producer);
+  }
+
+  // Reopening maps the file and rebuilds the IBF from the stored keys
+  auto start = Clock::now();
+  Producer producer(m_face, m_keyChain);
+  producer.usePrefixTableFile(m_path, m_nPrefixes);
+  std::cout << "{\"benchmark\": \"prefix-table\", "
+            << "\"backend\": \"file\", "
+            << "\"prefixes\": " << producer.getNumPrefixes() << ", "
+            << "\"reopenSeconds\": " << secondsSince(start) << ", "
+            << "\"maxRssKb\": " << getMaxRssKb() << "}" << std::endl;
+}
+
+BOOST_AUTO_TEST_CASE(Heap)
+{
+  Producer producer(m_face, m_keyChain);
+  run("heap", producer);
+}
+
+BOOST_AUTO_TEST_CASE(LoadState)
+{
+  std::vector<std::pair<Name, uint64_t>> state;
+  state.reserve(m_nPrefixes);
+  for (uint64_t i = 0; i < m_nPrefixes; i++) {
+    state.emplace_back(makePrefix(i), 1);
+  }
+
+  for (size_t nThreads : {size_t(1), size_t(std::max(1U, std::thread::hardware_concurrency()))}) {
+    Producer producer(m_face, m_keyChain);
+    auto start = Clock::now();
+    producer.loadState(state, nThreads);
+    double seconds = secondsSince(start);
+    std::cout << "{\"benchmark\": \"prefix-table-load-state\", "
+              << "\"backend\": \"heap\", "
+              << "\"prefixes\": " << m_nPrefixes << ", "
+              << "\"threads\": " << nThreads << ", "
+              << "\"loadSeconds\": " << seconds << ", "
+              << "\"prefixesPerSecond\": " << m_nPrefixes / seconds << "}" << std::endl;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::benchmarks
@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE PSync Stats Overhead Benchmark
+
+#include "PSync/partial-producer.hpp"
+
+#include "tests/boost-test.hpp"
+#include "tests/key-chain-fixture.hpp"
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <chrono>
+#include <iostream>
+
+namespace psync::benchmarks {
+
+using ndn::Interest;
+using ndn::Name;
+
+/**
+ * @brief Cost of the statistics kept by producers, relative to the work they count
+ *
+ * Times the processing by PartialProducer of sync Interests received by the face, which
+ * each decode to a small difference and get a reply, then the statistics updates made
+ * for one such Interest, on their own.
+ */
+class StatsOverheadFixture : public tests::KeyChainFixture
+{
+protected:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr uint32_t N_INTERESTS = 20000;
+  static constexpr uint32_t N_PREFIXES = 10;
+
+  StatsOverheadFixture()
+  {
+    for (uint32_t i = 0; i < N_PREFIXES; i++) {
+      Name prefix("/user-" + std::to_string(i));
+      m_producer.addUserNode(prefix);
+      m_producer.publishName(prefix);
+    }
+    // Register the sync prefix, so that the face passes sync Interests to the producer
+    m_face.processEvents(10_ms);
+  }
+
+  // Each Interest carries another IBF, so that none is answered from memory
+  Interest
+  makeSyncInterest(uint32_t i)
+  {
+    detail::IBLT iblt(40, CompressionScheme::NONE);
+    iblt.insert(i + 1);
+    Name name(m_syncPrefix);
+    m_filter.appendToName(name);
+    iblt.appendToName(name);
+    return Interest(name);
+  }
+
+  static double
+  nanosecondsSince(Clock::time_point start, uint32_t n)
+  {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n;
+  }
+
+protected:
+  ndn::DummyClientFace m_face{m_keyChain, {false, true}};
+  PartialProducer m_producer{m_face, m_keyChain, "/psync", {}};
+  const Name m_syncPrefix{"/psync/sync"};
+  detail::BloomFilter m_filter{20, 0.001};
+};
+
+BOOST_FIXTURE_TEST_CASE(SyncInterest, StatsOverheadFixture)
+{
+  std::vector<Interest> interests;
+  for (uint32_t i = 0; i < N_INTERESTS; i++) {
+    interests.push_back(makeSyncInterest(i));
+  }
+
+  auto start = Clock::now();
+  for (const auto& interest : interests) {
+    m_face.receive(interest);
+  }
+  double interestNs = nanosecondsSince(start, N_INTERESTS);
+  auto stats = m_producer.getStats();
+
+  // The same updates as for one of the Interests above. The counters are reached through
+  // a volatile pointer, so that the compiler cannot fold the loop into a few additions.
+  ProducerStats counted;
+  ProducerStats* volatile sink = &counted;
+  detail::IBLTDiff diff{true, {1, 2, 3, 4, 5, 6, 7, 8, 9, 10}, {11}};
+  start = Clock::now();
+  for (uint32_t i = 0; i < N_INTERESTS; i++) {
+    ProducerStats& s = *sink;
+    ++s.nSyncInterests;
+    ++s.nDecodeSuccesses;
+    s.diffSize.record(diff.positive.size() + diff.negative.size() + (i & 1));
+    ++s.nReplies;
+    s.replySize.record(200 + (i & 7));
+    s.nBytesBeforeCompression += 200;
+    s.nBytesAfterCompression += 200;
+  }
+  double statsNs = nanosecondsSince(start, N_INTERESTS);
+  BOOST_CHECK_EQUAL(counted.nReplies, stats.nReplies);
+
+  std::cout << "{\"benchmark\": \"stats-overhead\", "
+            << "\"interests\": " << N_INTERESTS << ", "
+            << "\"replies\": " << stats.nReplies << ", "
+            << "\"meanDiffSize\": " << stats.diffSize.getMean() << ", "
+            << "\"syncInterestNs\": " << interestNs << ", "
+            << "\"statsNs\": " << statsNs << ", "
+            << "\"overheadPercent\": " << statsNs / interestNs * 100 << "}" << std::endl;
+  BOOST_CHECK_LT(statsNs / interestNs, 0.01);
+}
+
+} // namespace psync::benchmarks
@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE PSync Sync Latency Benchmark
+
+#include "PSync/consumer.hpp"
+#include "PSync/partial-producer.hpp"
+
+#include "tests/boost-test.hpp"
+#include "tests/io-fixture.hpp"
+#include "tests/key-chain-fixture.hpp"
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+namespace psync::benchmarks {
+
+using ndn::Name;
+
+/**
+ * @brief Publish-to-notify latency of a Consumer, in virtual time
+ *
+ * A PartialProducer and a Consumer subscribed to all its prefixes are connected by
+ * a link with a fixed delay. A hot prefix is published at a steady rate while bursts
+ * of updates to other prefixes cause sync data of several segments.
+ */
+class SyncLatencyFixture : public tests::IoFixture, public tests::KeyChainFixture
+{
+protected:
+  static constexpr ndn::time::milliseconds LINK_DELAY = 10_ms;
+  static constexpr ndn::time::milliseconds HOT_PUBLISH_INTERVAL = 7_ms;
+  static constexpr ndn::time::milliseconds BURST_INTERVAL = 200_ms;
+  static constexpr ndn::time::milliseconds DURATION = 20_s;
+  static constexpr int N_BURST_PREFIXES = 2000;
+  static constexpr int BURST_SIZE = 300;
+
+  SyncLatencyFixture()
+  {
+    m_consumerFace.onSendInterest.connect([this] (const ndn::Interest& interest) {
+      m_scheduler.schedule(LINK_DELAY, [this, interest] { m_producerFace.receive(interest); });
+    });
+    m_producerFace.onSendData.connect([this] (const ndn::Data& data) {
+      m_scheduler.schedule(LINK_DELAY, [this, data] { m_consumerFace.receive(data); });
+    });
+  }
+
+  void
+  run(bool pipelineSyncInterests)
+  {
+    PartialProducer producer(m_producerFace, m_keyChain, "/psync", PartialProducer::Options{});
+    const Name hotPrefix("/bench/hot");
+    producer.addUserNode(hotPrefix);
+    std::vector<Name> burstPrefixes;
+    for (int i = 0; i < N_BURST_PREFIXES; i++) {
+      // About 100 bytes per prefix in sync data
+      burstPrefixes.push_back(Name("/bench").append(std::string(80, 'x')).appendNumber(i));
+      producer.addUserNode(burstPrefixes.back());
+    }
+
+    // Publication time of each sequence number of each prefix
+    std::map<Name, std::vector<ndn::time::steady_clock::time_point>> published;
+    auto publish = [&] (const Name& prefix) {
+      producer.publishName(prefix);
+      published[prefix].push_back(ndn::time::steady_clock::now());
+    };
+
+    std::vector<double> latencies;
+    std::vector<double> hotLatencies;
+
+    std::unique_ptr<Consumer> consumer;
+    Consumer::Options opts;
+    opts.bfCount = N_BURST_PREFIXES + 1;
+    opts.pipelineSyncInterests = pipelineSyncInterests;
+    opts.onHelloData = [&] (const auto& availableSubs) {
+      consumer->addSubscriptions(availableSubs, false);
+      consumer->sendSyncInterest();
+    };
+    opts.onUpdate = [&] (const auto& updates) {
+      auto now = ndn::time::steady_clock::now();
+      for (const auto& update : updates) {
+        for (auto seq = update.lowSeq; seq <= update.highSeq; ++seq) {
+          double latency = ndn::time::duration_cast<ndn::time::microseconds>(
+                             now - published.at(update.prefix).at(seq - 1)).count() / 1000.0;
+          latencies.push_back(latency);
+          if (update.prefix == hotPrefix) {
+            hotLatencies.push_back(latency);
+          }
+        }
+      }
+    };
+    consumer = std::make_unique<Consumer>(m_consumerFace, "/psync", opts);
+
+    advanceClocks(1_ms, 10);
+    consumer->sendHelloInterest();
+    advanceClocks(1_ms, 100);
+
+    ndn::scheduler::ScopedEventId hotEvent;
+    std::function<void()> publishHot = [&] {
+      publish(hotPrefix);
+      hotEvent = m_scheduler.schedule(HOT_PUBLISH_INTERVAL, publishHot);
+    };
+    ndn::scheduler::ScopedEventId burstEvent;
+    int nextBurstPrefix = 0;
+    std::function<void()> publishBurst = [&] {
+      for (int i = 0; i < BURST_SIZE; i++) {
+        publish(burstPrefixes[nextBurstPrefix++ % N_BURST_PREFIXES]);
+      }
+      burstEvent = m_scheduler.schedule(BURST_INTERVAL, publishBurst);
+    };
+    publishHot();
+    publishBurst();
+
+    advanceClocks(1_ms, DURATION);
+    hotEvent.cancel();
+    burstEvent.cancel();
+    // Let the last updates arrive
+    advanceClocks(1_ms, 1_s);
+    consumer->stop();
+
+    std::cout << "{\"benchmark\": \"sync-latency\", "
+              << "\"pipelineSyncInterests\": " << std::boolalpha << pipelineSyncInterests << ", "
+              << "\"linkDelayMs\": " << LINK_DELAY.count() << ", "
+              << "\"notifications\": " << latencies.size() << ", "
+              << "\"p50Ms\": " << percentile(latencies, 0.50) << ", "
+              << "\"p99Ms\": " << percentile(latencies, 0.99) << ", "
+              << "\"hotP50Ms\": " << percentile(hotLatencies, 0.50) << ", "
+              << "\"hotP99Ms\": " << percentile(hotLatencies, 0.99) << "}" << std::endl;
+  }
+
+  static double
+  percentile(std::vector<double> values, double p)
+  {
+    if (values.empty()) {
+      return 0;
+    }
+    auto nth = values.begin() + static_cast<ptrdiff_t>(p * (values.size() - 1));
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+  }
+
+protected:
+  ndn::DummyClientFace m_producerFace{m_io, m_keyChain, {false, true}};
+  ndn::DummyClientFace m_consumerFace{m_io, m_keyChain, {false, false}};
+  ndn::Scheduler m_scheduler{m_io};
+};
+
+BOOST_FIXTURE_TEST_SUITE(SyncLatency, SyncLatencyFixture)
+
+BOOST_AUTO_TEST_CASE(WithoutPipelining)
+{
+  run(false);
+}
+
+BOOST_AUTO_TEST_CASE(WithPipelining)
+{
+  run(true);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::benchmarks
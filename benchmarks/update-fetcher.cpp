@@ -0,0 +1,140 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE PSync Update Fetcher Benchmark
+
+#include "PSync/update-fetcher.hpp"
+
+#include "tests/boost-test.hpp"
+#include "tests/io-fixture.hpp"
+#include "tests/key-chain-fixture.hpp"
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <chrono>
+#include <iostream>
+
+namespace psync::benchmarks {
+
+using ndn::Name;
+
+/**
+ * @brief Catch-up throughput of an UpdateFetcher, in virtual time
+ *
+ * A single update announces a large gap of sequence numbers. Interests reach the
+ * producer after a fixed delay; its Data goes through a bottleneck with a fixed
+ * service time and a drop-tail queue, then the same delay back.
+ */
+class UpdateFetcherFixture : public tests::IoFixture, public tests::KeyChainFixture
+{
+protected:
+  static constexpr ndn::time::milliseconds LINK_DELAY = 10_ms;
+  static constexpr ndn::time::microseconds SERVICE_TIME = 100_us;
+  static constexpr size_t QUEUE_CAPACITY = 100;
+  static constexpr uint64_t N_SEQS = 100000;
+  static constexpr ndn::time::seconds MAX_DURATION = 120_s;
+
+  UpdateFetcherFixture()
+  {
+    m_face.onSendInterest.connect([this] (const ndn::Interest& interest) {
+      m_scheduler.schedule(LINK_DELAY, [this, name = interest.getName()] { onInterest(name); });
+    });
+  }
+
+  void
+  onInterest(const Name& name)
+  {
+    auto now = ndn::time::steady_clock::now();
+    if (m_lastDeparture < now) {
+      m_lastDeparture = now;
+    }
+    if ((m_lastDeparture - now) / SERVICE_TIME >= static_cast<int64_t>(QUEUE_CAPACITY)) {
+      ++m_nDropped;
+      return;
+    }
+    m_lastDeparture += SERVICE_TIME;
+
+    ndn::Data data(name);
+    data.setContent(m_content);
+    // Not validated by the fetcher, only needs to be encodable
+    data.setSignatureInfo(ndn::SignatureInfo(ndn::tlv::DigestSha256));
+    data.setSignatureValue(std::make_shared<ndn::Buffer>(32));
+    m_scheduler.schedule(m_lastDeparture - now + LINK_DELAY, [this, data] { m_face.receive(data); });
+  }
+
+  void
+  run(uint64_t maxBacklogPerPrefix)
+  {
+    uint64_t nDelivered = 0;
+    uint64_t nFailed = 0;
+    UpdateFetcher::Options opts;
+    opts.onData = [&] (const auto&, auto, const auto&) { ++nDelivered; };
+    opts.onFailure = [&] (const auto&, auto lowSeq, auto highSeq) {
+      nFailed += highSeq - lowSeq + 1;
+    };
+    opts.maxBacklogPerPrefix = maxBacklogPerPrefix;
+    UpdateFetcher fetcher(m_face, opts);
+
+    auto wallStart = std::chrono::steady_clock::now();
+    auto start = ndn::time::steady_clock::now();
+    fetcher.fetch({{"/bench/producer", 1, N_SEQS, 0}});
+    while (nDelivered + nFailed < N_SEQS && ndn::time::steady_clock::now() - start < MAX_DURATION) {
+      advanceClocks(SERVICE_TIME, 100);
+    }
+    double virtualSeconds = ndn::time::duration_cast<ndn::time::microseconds>(
+                              ndn::time::steady_clock::now() - start).count() / 1e6;
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                       wallStart).count();
+    fetcher.stop();
+
+    std::cout << "{\"benchmark\": \"update-fetcher\", "
+              << "\"maxBacklogPerPrefix\": " << maxBacklogPerPrefix << ", "
+              << "\"seqs\": " << N_SEQS << ", "
+              << "\"delivered\": " << nDelivered << ", "
+              << "\"failed\": " << nFailed << ", "
+              << "\"dropped\": " << m_nDropped << ", "
+              << "\"virtualSeconds\": " << virtualSeconds << ", "
+              << "\"seqsPerSecond\": " << nDelivered / virtualSeconds << ", "
+              << "\"wallSeconds\": " << wallSeconds << ", "
+              << "\"finalCwnd\": " << fetcher.getCwnd() << "}" << std::endl;
+  }
+
+protected:
+  ndn::DummyClientFace m_face{m_io, m_keyChain, {false, false}};
+  ndn::Scheduler m_scheduler{m_io};
+  ndn::Block m_content = ndn::makeBinaryBlock(ndn::tlv::Content, std::vector<uint8_t>(1000));
+  ndn::time::steady_clock::time_point m_lastDeparture;
+  uint64_t m_nDropped = 0;
+};
+
+BOOST_FIXTURE_TEST_SUITE(UpdateFetcherCatchUp, UpdateFetcherFixture)
+
+BOOST_AUTO_TEST_CASE(FullGap)
+{
+  run(0);
+}
+
+BOOST_AUTO_TEST_CASE(NewestFirst)
+{
+  run(N_SEQS / 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::benchmarks
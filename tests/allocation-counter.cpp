@@ -0,0 +1,139 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tests/allocation-counter.hpp"
+
+#include <boost/assert.hpp>
+
+#include <cstdlib>
+#include <new>
+
+namespace psync::tests {
+
+// Innermost counter alive on this thread
+static thread_local AllocationCounter* g_current = nullptr;
+
+AllocationCounter::AllocationCounter() noexcept
+  : m_previous(g_current)
+{
+  g_current = this;
+}
+
+AllocationCounter::~AllocationCounter()
+{
+  BOOST_ASSERT(g_current == this);
+  g_current = m_previous;
+}
+
+void
+AllocationCounter::stop() noexcept
+{
+  m_isStopped = true;
+}
+
+void
+AllocationCounter::recordAllocation(size_t size) noexcept
+{
+  for (auto* counter = g_current; counter != nullptr; counter = counter->m_previous) {
+    if (!counter->m_isStopped) {
+      ++counter->m_nAllocations;
+      counter->m_nBytes += size;
+    }
+  }
+}
+
+void
+AllocationCounter::recordDeallocation() noexcept
+{
+  for (auto* counter = g_current; counter != nullptr; counter = counter->m_previous) {
+    if (!counter->m_isStopped) {
+      ++counter->m_nDeallocations;
+    }
+  }
+}
+
+static void*
+allocate(size_t size)
+{
+  AllocationCounter::recordAllocation(size);
+  if (size == 0) {
+    size = 1;
+  }
+  while (true) {
+    void* p = std::malloc(size);
+    if (p != nullptr) {
+      return p;
+    }
+    auto handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+static void
+deallocate(void* p) noexcept
+{
+  if (p != nullptr) {
+    AllocationCounter::recordDeallocation();
+    std::free(p);
+  }
+}
+
+} // namespace psync::tests
+
+// The other forms of the unaligned operators call these ones by default. The aligned
+// forms are left alone, they allocate and free with their own functions.
+
+void*
+operator new(std::size_t size)
+{
+  return psync::tests::allocate(size);
+}
+
+void*
+operator new[](std::size_t size)
+{
+  return psync::tests::allocate(size);
+}
+
+void
+operator delete(void* p) noexcept
+{
+  psync::tests::deallocate(p);
+}
+
+void
+operator delete[](void* p) noexcept
+{
+  psync::tests::deallocate(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+  psync::tests::deallocate(p);
+}
+
+void
+operator delete[](void* p, std::size_t) noexcept
+{
+  psync::tests::deallocate(p);
+}
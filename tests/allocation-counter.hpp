@@ -0,0 +1,101 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PSYNC_TESTS_ALLOCATION_COUNTER_HPP
+#define PSYNC_TESTS_ALLOCATION_COUNTER_HPP
+
+#include <cstddef>
+
+namespace psync::tests {
+
+/**
+ * @brief Counts the heap allocations made by the current thread while it is alive
+ *
+ * The unit tests replace the global operator new and operator delete
+ * (see allocation-counter.cpp), which add to every AllocationCounter alive on the
+ * calling thread. Nested counters all count. Outside of any counter, the replaced
+ * operators only call malloc() and free().
+ *
+ * Check the counts after the counter stops, since the checks allocate too:
+ * @code
+ * AllocationCounter counter;
+ * doSomething();
+ * counter.stop();
+ * BOOST_CHECK_LE(counter.getNAllocations(), 10);
+ * @endcode
+ */
+class AllocationCounter
+{
+public:
+  AllocationCounter() noexcept;
+
+  ~AllocationCounter();
+
+  AllocationCounter(const AllocationCounter&) = delete;
+
+  AllocationCounter&
+  operator=(const AllocationCounter&) = delete;
+
+  /**
+   * @brief Stop counting, the counts are kept
+   */
+  void
+  stop() noexcept;
+
+  size_t
+  getNAllocations() const noexcept
+  {
+    return m_nAllocations;
+  }
+
+  size_t
+  getNDeallocations() const noexcept
+  {
+    return m_nDeallocations;
+  }
+
+  /**
+   * @brief Returns the total size of the allocations, in bytes
+   */
+  size_t
+  getNBytes() const noexcept
+  {
+    return m_nBytes;
+  }
+
+public:
+  /// Called by the replaced operator new
+  static void
+  recordAllocation(size_t size) noexcept;
+
+  /// Called by the replaced operator delete
+  static void
+  recordDeallocation() noexcept;
+
+private:
+  AllocationCounter* m_previous;
+  bool m_isStopped = false;
+  size_t m_nAllocations = 0;
+  size_t m_nDeallocations = 0;
+  size_t m_nBytes = 0;
+};
+
+} // namespace psync::tests
+
+#endif // PSYNC_TESTS_ALLOCATION_COUNTER_HPP
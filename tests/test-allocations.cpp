@@ -0,0 +1,307 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/consumer.hpp"
+#include "PSync/full-producer.hpp"
+#include "PSync/detail/iblt.hpp"
+#include "PSync/detail/state.hpp"
+#include "PSync/detail/util.hpp"
+
+#include "tests/allocation-counter.hpp"
+#include "tests/boost-test.hpp"
+#include "tests/io-fixture.hpp"
+#include "tests/key-chain-fixture.hpp"
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+namespace psync::tests {
+
+using ndn::Interest;
+using ndn::Name;
+
+/*
+ * Allocation budgets of the main paths of sync Interest and sync Data processing.
+ *
+ * Each budget is an upper bound of the number of heap allocations made by one call: the
+ * measured count with a margin of half on top. The fixed part covers the work done once
+ * per packet (decoding, signing, publishing segments, sending the next Interest), the
+ * per-update part the work done for each prefix in a reply. Lower a budget when
+ * allocations are removed from its path, so that they cannot come back unnoticed.
+ *
+ * The budgets marked as estimated were counted by reading the code paths through ndn-cxx
+ * and have not been measured yet. Each test prints its counts as a message
+ * (--log_level=message); set an estimated budget to the printed count plus half.
+ */
+// Estimated: state encoding, compression, one segment signed with a digest, the in-memory
+// store entry with its erase event, and the put
+constexpr size_t SYNC_INTEREST_REPLY_BUDGET = 200;
+// Estimated: Name lookup and copy into the state, and the growth of the difference and
+// state lists
+constexpr size_t SYNC_INTEREST_REPLY_PER_UPDATE_BUDGET = 8;
+// Estimated: state decoding, the update notification, and the next sync Interest with
+// its fetcher
+constexpr size_t CONSUMER_SYNC_DATA_BUDGET = 200;
+// Estimated: Name decoding, the MissingDataInfo and the subscription update of one prefix
+constexpr size_t CONSUMER_SYNC_DATA_PER_UPDATE_BUDGET = 12;
+// Measured: 8 for compress and 8 for decompress of a 40-entry IBF, from the filter chain,
+// the copy buffer and the output buffer of boost::iostreams
+constexpr size_t COMPRESSION_BUDGET = 12;
+
+class AllocationsFixture : public IoFixture, public KeyChainFixture
+{
+protected:
+  std::unique_ptr<FullProducer>
+  makeProducer()
+  {
+    FullProducer::Options opts;
+    opts.ibfCount = 40;
+    // The allocations of the compressors depend on the libraries built in
+    opts.ibfCompression = CompressionScheme::NONE;
+    opts.contentCompression = CompressionScheme::NONE;
+    auto producer = std::make_unique<FullProducer>(m_face, m_keyChain, m_syncPrefix, opts);
+    for (size_t i = 0; i < N_PREFIXES; i++) {
+      producer->addUserNode(makePrefix(i));
+      producer->updateSeqNo(makePrefix(i), 1);
+    }
+    advanceClocks(10_ms);
+    return producer;
+  }
+
+  static Name
+  makePrefix(size_t i)
+  {
+    return "/user-" + std::to_string(i);
+  }
+
+  Interest
+  makeSyncInterest(const FullProducer& producer) const
+  {
+    Name name(m_syncPrefix);
+    producer.m_iblt.appendToName(name);
+    name.appendNumber(producer.m_numOwnElements);
+    return Interest(name);
+  }
+
+  /**
+   * @brief Returns the allocations of FullProducer::onSyncInterest for an Interest
+   *        that is @p nUpdates updates behind
+   */
+  size_t
+  countSyncReplyAllocations(size_t nUpdates)
+  {
+    auto producer = makeProducer();
+    auto interest = makeSyncInterest(*producer);
+    for (size_t i = 0; i < nUpdates; i++) {
+      producer->updateSeqNo(makePrefix(i), 2);
+    }
+    auto nReplies = producer->getStats().nReplies;
+
+    AllocationCounter counter;
+    producer->onSyncInterest(m_syncPrefix, interest);
+    counter.stop();
+
+    BOOST_CHECK_EQUAL(producer->getStats().nReplies, nReplies + 1);
+    return counter.getNAllocations();
+  }
+
+  /**
+   * @brief Returns the allocations of Consumer::onSyncData for sync Data of @p nUpdates updates
+   */
+  size_t
+  countSyncDataAllocations(size_t nUpdates)
+  {
+    Consumer::Options opts;
+    opts.bfCount = N_PREFIXES;
+    size_t nNotified = 0;
+    opts.onUpdate = [&] (const auto& updates) { nNotified += updates.size(); };
+    Consumer consumer(m_face, m_syncPrefix, opts);
+    for (size_t i = 0; i < N_PREFIXES; i++) {
+      consumer.addSubscription(makePrefix(i), 1, false);
+    }
+    consumer.m_syncDataName = Name(m_syncPrefix).append("sync").append("bf").append("ibf");
+
+    detail::State state;
+    for (size_t i = 0; i < nUpdates; i++) {
+      state.addContent(Name(makePrefix(i)).appendNumber(2));
+    }
+    auto content = std::make_shared<const ndn::Buffer>(state.wireEncode().begin(),
+                                                       state.wireEncode().end());
+
+    AllocationCounter counter;
+    consumer.onSyncData(content);
+    counter.stop();
+
+    BOOST_CHECK_EQUAL(nNotified, nUpdates);
+    consumer.stop();
+    return counter.getNAllocations();
+  }
+
+protected:
+  static constexpr size_t N_PREFIXES = 40;
+  const Name m_syncPrefix = "/psync";
+  ndn::DummyClientFace m_face{m_io, m_keyChain, {false, true}};
+};
+
+BOOST_FIXTURE_TEST_SUITE(TestAllocations, AllocationsFixture)
+
+BOOST_AUTO_TEST_CASE(Counter)
+{
+  AllocationCounter outer;
+  {
+    AllocationCounter inner;
+    auto p = std::make_unique<uint64_t>(1);
+    inner.stop();
+    std::vector<uint64_t> v(10);
+    BOOST_CHECK_EQUAL(inner.getNAllocations(), 1);
+    BOOST_CHECK_EQUAL(inner.getNDeallocations(), 0);
+    BOOST_CHECK_EQUAL(inner.getNBytes(), sizeof(uint64_t));
+  }
+  outer.stop();
+  // The allocations of the checks above are counted too
+  BOOST_CHECK_GE(outer.getNAllocations(), 2);
+  BOOST_CHECK_GE(outer.getNDeallocations(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(IbltDifference)
+{
+  // The peeled table is on the stack up to 120 entries, as for the default ibfCount of 80,
+  // and each key list up to 16 keys; one more of either costs one allocation
+  struct Case
+  {
+    size_t expectedNumEntries;
+    uint32_t nOwn;
+    uint32_t nReceived;
+    size_t nAllocations;
+  };
+  for (const auto& c : {Case{40, 10, 0, 0}, Case{80, 16, 16, 0}, Case{80, 17, 0, 1},
+                        Case{81, 10, 0, 1}}) {
+    BOOST_TEST_CONTEXT(c.expectedNumEntries << " entries, " << c.nOwn << "/" << c.nReceived <<
+                       " keys") {
+      detail::IBLT own(c.expectedNumEntries, CompressionScheme::NONE);
+      detail::IBLT received(c.expectedNumEntries, CompressionScheme::NONE);
+      for (uint32_t i = 0; i < c.nOwn; i++) {
+        own.insert(i + 1);
+      }
+      for (uint32_t i = 0; i < c.nReceived; i++) {
+        received.insert(i + 100000);
+      }
+
+      AllocationCounter counter;
+      auto diff = own - received;
+      counter.stop();
+
+      BOOST_CHECK(diff.canDecode);
+      BOOST_CHECK_EQUAL(counter.getNAllocations(), c.nAllocations);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Compression)
+{
+  detail::IBLT iblt(40, CompressionScheme::NONE);
+  Name name;
+  iblt.appendToName(name);
+  auto ibf = name.at(-1).value_bytes();
+
+  AllocationCounter compressCounter;
+  auto compressed = detail::compress(CompressionScheme::NONE, ibf);
+  compressCounter.stop();
+
+  AllocationCounter decompressCounter;
+  auto decompressed = detail::decompress(CompressionScheme::NONE, *compressed);
+  decompressCounter.stop();
+
+  BOOST_CHECK_EQUAL(decompressed->size(), ibf.size());
+  BOOST_TEST_MESSAGE("Compression allocations: " << compressCounter.getNAllocations() <<
+                     " to compress, " << decompressCounter.getNAllocations() << " to decompress");
+  BOOST_CHECK_LE(compressCounter.getNAllocations(), COMPRESSION_BUDGET);
+  BOOST_CHECK_LE(decompressCounter.getNAllocations(), COMPRESSION_BUDGET);
+}
+
+BOOST_AUTO_TEST_CASE(SyncInterestPending)
+{
+  auto producer = makeProducer();
+  auto interest = makeSyncInterest(*producer);
+
+  AllocationCounter counter;
+  producer->onSyncInterest(m_syncPrefix, interest);
+  counter.stop();
+
+  BOOST_CHECK_EQUAL(producer->m_pendingEntries.size(), 1);
+  // Keeping the Interest pending does the decoding of a reply without the encoding,
+  // signing and publishing, so it must stay below the measured reply
+  size_t nReply = countSyncReplyAllocations(1);
+  BOOST_TEST_MESSAGE("onSyncInterest allocations: " << counter.getNAllocations() <<
+                     " when pending, " << nReply << " for a reply");
+  BOOST_CHECK_LT(counter.getNAllocations(), nReply);
+}
+
+BOOST_AUTO_TEST_CASE(SyncInterestReply)
+{
+  size_t nOne = countSyncReplyAllocations(1);
+  size_t nMany = countSyncReplyAllocations(11);
+  BOOST_TEST_MESSAGE("onSyncInterest allocations: " << nOne << " for 1 update, " <<
+                     nMany << " for 11 updates");
+
+  BOOST_CHECK_LE(nOne, SYNC_INTEREST_REPLY_BUDGET);
+  BOOST_CHECK_LE(nMany, nOne + 10 * SYNC_INTEREST_REPLY_PER_UPDATE_BUDGET);
+}
+
+BOOST_AUTO_TEST_CASE(SatisfyPendingInterests)
+{
+  auto producer = makeProducer();
+  for (size_t i = 0; i < 3; i++) {
+    // Interests of distinct names, all up to date
+    Name name(m_syncPrefix);
+    producer->m_iblt.appendToName(name);
+    name.appendNumber(producer->m_numOwnElements + i);
+    producer->onSyncInterest(m_syncPrefix, Interest(name));
+  }
+  BOOST_REQUIRE_EQUAL(producer->m_pendingEntries.size(), 3);
+
+  Name updated = Name(makePrefix(0)).appendNumber(2);
+  producer->updateSeqNo(makePrefix(0), 2);
+
+  AllocationCounter counter;
+  producer->satisfyPendingInterests(updated);
+  counter.stop();
+
+  BOOST_CHECK_EQUAL(producer->m_pendingEntries.size(), 0);
+  // Each Interest costs an IBF subtraction, which does not allocate (see IbltDifference),
+  // and a reply like the one measured, with a margin of half
+  size_t nReply = countSyncReplyAllocations(1);
+  BOOST_TEST_MESSAGE("satisfyPendingInterests allocations: " << counter.getNAllocations() <<
+                     " for 3 Interests, " << nReply << " for one reply");
+  BOOST_CHECK_LE(counter.getNAllocations(), 3 * (nReply + nReply / 2));
+}
+
+BOOST_AUTO_TEST_CASE(ConsumerSyncData)
+{
+  size_t nOne = countSyncDataAllocations(1);
+  size_t nMany = countSyncDataAllocations(11);
+  BOOST_TEST_MESSAGE("Consumer::onSyncData allocations: " << nOne << " for 1 update, " <<
+                     nMany << " for 11 updates");
+
+  BOOST_CHECK_LE(nOne, CONSUMER_SYNC_DATA_BUDGET);
+  BOOST_CHECK_LE(nMany, nOne + 10 * CONSUMER_SYNC_DATA_PER_UPDATE_BUDGET);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::tests
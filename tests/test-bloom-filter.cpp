@@ -18,11 +18,14 @@
  **/
 
 #include "PSync/detail/bloom-filter.hpp"
+#include "PSync/detail/util.hpp"
 
 #include "tests/boost-test.hpp"
 
 #include <ndn-cxx/name.hpp>
 
+#include <algorithm>
+
 namespace psync::tests {
 
 using detail::BloomFilter;
@@ -54,6 +57,116 @@ BOOST_AUTO_TEST_CASE(NameAppendAndExtract)
   BOOST_CHECK_THROW(BloomFilter(200, 0.001, bfName.at(-1)), std::runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(ViewOfName)
+{
+  ndn::Name bfName("/test");
+  BloomFilter bf(100, 0.001);
+  bf.insert("/memphis");
+  bf.appendToName(bfName);
+  ndn::Name original = bfName;
+
+  BloomFilter view(100, 0.001, bfName.at(-1));
+  BOOST_CHECK(view.contains("/memphis"));
+
+  // Modifying the filter does not modify the name it was parsed from
+  view.insert("/arizona");
+  BOOST_CHECK(view.contains("/arizona"));
+  BOOST_CHECK(view.contains("/memphis"));
+  BOOST_CHECK_EQUAL(bfName, original);
+  BOOST_CHECK_EQUAL(BloomFilter(100, 0.001, bfName.at(-1)), bf);
+
+  view.clear();
+  BOOST_CHECK(!view.contains("/memphis"));
+  BOOST_CHECK_EQUAL(bfName, original);
+}
+
+BOOST_AUTO_TEST_CASE(Blocked)
+{
+  BloomFilter bf(100, 0.001, BloomFilter::Layout::BLOCKED);
+  BOOST_CHECK(bf.getLayout() == BloomFilter::Layout::BLOCKED);
+
+  for (int i = 0; i < 100; i++) {
+    bf.insert("/memphis/" + std::to_string(i));
+  }
+  for (int i = 0; i < 100; i++) {
+    BOOST_CHECK(bf.contains("/memphis/" + std::to_string(i)));
+  }
+
+  // All bits of a key are within one 64-byte block
+  auto positions = bf.getBitPositions("/memphis/0");
+  for (auto pos : positions) {
+    BOOST_CHECK_EQUAL(pos / 512, positions.front() / 512);
+  }
+
+  ndn::Name bfName("/test");
+  bf.appendToName(bfName);
+  BOOST_CHECK_EQUAL(bfName.at(-1).type(), tlv::BlockedBloomFilterComponent);
+  BOOST_CHECK_EQUAL(bfName.at(-1).value_size() % 64, 0);
+
+  BloomFilter bfFromName(100, 0.001, bfName.at(-1));
+  BOOST_CHECK(bfFromName.getLayout() == BloomFilter::Layout::BLOCKED);
+  BOOST_CHECK_EQUAL(bf, bfFromName);
+  BOOST_CHECK(bfFromName.contains("/memphis/42"));
+
+  // Classic filter with the same parameters has a different table size
+  ndn::Name classicName("/test");
+  BloomFilter(100, 0.001).appendToName(classicName);
+  BOOST_CHECK_EQUAL(classicName.at(-1).type(), ndn::tlv::GenericNameComponent);
+  BOOST_CHECK(BloomFilter(100, 0.001, classicName.at(-1)).getLayout() == BloomFilter::Layout::CLASSIC);
+}
+
+BOOST_AUTO_TEST_CASE(ParametersCache)
+{
+  BloomFilter used(40, 0.001);
+  // Parameters seen once, as carried by arbitrary Interests, do not evict the ones in use
+  for (unsigned int i = 0; i < 500; i++) {
+    BloomFilter once(1000 + i, 0.001);
+    BloomFilter again(40, 0.001);
+    BOOST_CHECK(again.parameters_ == used.parameters_);
+  }
+
+  // Once evicted, parameters are computed again, with the same values
+  for (unsigned int i = 0; i < 500; i++) {
+    BloomFilter once(1000 + i, 0.001);
+  }
+  BloomFilter again(40, 0.001);
+  BOOST_CHECK(again.parameters_ != used.parameters_);
+  used.insert("/test");
+  again.insert("/test");
+  BOOST_CHECK_EQUAL(again, used);
+}
+
+BOOST_AUTO_TEST_CASE(BitPositions)
+{
+  BloomFilter bf(100, 0.001);
+  bf.insert("/memphis");
+
+  auto positions = BloomFilter(100, 0.001).getBitPositions("/memphis");
+  BOOST_CHECK(bf.containsBits(positions));
+  BOOST_CHECK(!bf.containsBits(bf.getBitPositions("/arizona")) || bf.contains("/arizona"));
+
+  auto setBits = bf.getSetBits();
+  std::sort(positions.begin(), positions.end());
+  positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+  BOOST_CHECK_EQUAL_COLLECTIONS(setBits.begin(), setBits.end(), positions.begin(), positions.end());
+}
+
+BOOST_AUTO_TEST_CASE(ContainsManySalts)
+{
+  // More salts than hash lanes, so that contains() hashes them in several batches
+  BloomFilter bf(100, 0.000001);
+  BOOST_REQUIRE_GT(bf.getBitPositions("/test").size(), 2 * detail::MURMUR_HASH3_LANES);
+  for (int i = 0; i < 100; i++) {
+    bf.insert(ndn::Name("/inserted").appendNumber(i));
+  }
+
+  for (int i = 0; i < 100; i++) {
+    BOOST_CHECK(bf.contains(ndn::Name("/inserted").appendNumber(i)));
+    ndn::Name other = ndn::Name("/other").appendNumber(i);
+    BOOST_CHECK_EQUAL(bf.contains(other), bf.containsBits(bf.getBitPositions(other)));
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace psync::tests
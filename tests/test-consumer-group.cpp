@@ -0,0 +1,243 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/consumer-group.hpp"
+#include "PSync/partial-producer.hpp"
+
+#include "tests/allocation-counter.hpp"
+#include "tests/boost-test.hpp"
+#include "tests/io-fixture.hpp"
+#include "tests/key-chain-fixture.hpp"
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+namespace psync::tests {
+
+using ndn::Name;
+
+class ConsumerGroupFixture : public IoFixture, public KeyChainFixture
+{
+protected:
+  ConsumerGroupFixture()
+  {
+    for (const auto& syncPrefix : syncPrefixes) {
+      auto producer = std::make_unique<PartialProducer>(producerFace, m_keyChain, syncPrefix,
+                                                        PartialProducer::Options{});
+      producer->addUserNode(Name(syncPrefix).append("user"));
+      producers.push_back(std::move(producer));
+    }
+    producerFace.linkTo(face);
+    advanceClocks(10_ms);
+  }
+
+  void
+  makeGroup(size_t maxConcurrentHellos = 16)
+  {
+    ConsumerGroup::Options opts;
+    opts.onHelloData = [this] (const Name& syncPrefix, const auto& availableSubs) {
+      ++nHelloDataRcvd;
+      auto consumer = group->getConsumer(syncPrefix);
+      consumer->addSubscriptions(availableSubs);
+      consumer->sendSyncInterest();
+    };
+    opts.onUpdate = [this] (const auto& updates) {
+      ++nDispatches;
+      for (const auto& [syncPrefix, groupUpdates] : updates) {
+        for (const auto& update : groupUpdates) {
+          received[update.prefix] = update.highSeq;
+        }
+      }
+    };
+    opts.maxConcurrentHellos = maxConcurrentHellos;
+    group = std::make_unique<ConsumerGroup>(face, opts);
+
+    for (const auto& syncPrefix : syncPrefixes) {
+      BOOST_REQUIRE(group->addSyncGroup(syncPrefix) != nullptr);
+    }
+  }
+
+  ~ConsumerGroupFixture() override
+  {
+    if (group) {
+      group->stop();
+    }
+  }
+
+protected:
+  ndn::DummyClientFace producerFace{m_io, m_keyChain, {true, true}};
+  ndn::DummyClientFace face{m_io, m_keyChain, {true, true}};
+  const std::vector<Name> syncPrefixes{"/psync-a", "/psync-b", "/psync-c"};
+  std::vector<std::unique_ptr<PartialProducer>> producers;
+
+  std::unique_ptr<ConsumerGroup> group;
+  int nHelloDataRcvd = 0;
+  int nDispatches = 0;
+  std::map<Name, uint64_t> received;
+};
+
+BOOST_FIXTURE_TEST_SUITE(TestConsumerGroup, ConsumerGroupFixture)
+
+BOOST_AUTO_TEST_CASE(AddRemove)
+{
+  makeGroup();
+  BOOST_CHECK_EQUAL(group->size(), 3);
+  BOOST_CHECK(group->addSyncGroup("/psync-a") == nullptr);
+  BOOST_CHECK(group->getConsumer("/psync-a") != nullptr);
+  BOOST_CHECK(group->getConsumer("/psync-z") == nullptr);
+
+  BOOST_CHECK(group->removeSyncGroup("/psync-a"));
+  BOOST_CHECK(!group->removeSyncGroup("/psync-a"));
+  BOOST_CHECK(!group->sendHelloInterest("/psync-a"));
+  BOOST_CHECK_EQUAL(group->size(), 2);
+  advanceClocks(10_ms);
+}
+
+BOOST_AUTO_TEST_CASE(SharedScheduler)
+{
+  makeGroup();
+  for (const auto& syncPrefix : syncPrefixes) {
+    auto consumer = group->getConsumer(syncPrefix);
+    // No scheduler, hence no timer, of its own
+    BOOST_CHECK(consumer->m_ownScheduler == nullptr);
+    BOOST_CHECK_EQUAL(&consumer->m_scheduler, &group->m_scheduler);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FewerAllocationsThanConsumers)
+{
+  constexpr size_t N_GROUPS = 100;
+  std::vector<Name> prefixes;
+  for (size_t i = 0; i < N_GROUPS; i++) {
+    prefixes.push_back("/psync-" + std::to_string(i));
+  }
+
+  std::vector<std::unique_ptr<Consumer>> consumers;
+  consumers.reserve(N_GROUPS);
+  AllocationCounter consumersCounter;
+  for (const auto& syncPrefix : prefixes) {
+    consumers.push_back(std::make_unique<Consumer>(face, syncPrefix, Consumer::Options{}));
+  }
+  consumersCounter.stop();
+
+  ConsumerGroup consumerGroup(face, {});
+  AllocationCounter groupCounter;
+  for (const auto& syncPrefix : prefixes) {
+    consumerGroup.addSyncGroup(syncPrefix);
+  }
+  groupCounter.stop();
+
+  // A Consumer allocates itself, its scheduler and the timer of the scheduler, a group
+  // only its node in the map and the sync prefix key of that node
+  BOOST_CHECK_LT(groupCounter.getNAllocations(), consumersCounter.getNAllocations());
+}
+
+BOOST_AUTO_TEST_CASE(HelloQueue)
+{
+  makeGroup(1);
+
+  group->sendHelloInterests();
+  // Queued twice, sent once
+  group->sendHelloInterest("/psync-a");
+  BOOST_CHECK_EQUAL(group->m_nHellosInFlight, 1);
+  BOOST_CHECK_EQUAL(group->m_helloQueue.size(), 2);
+
+  advanceClocks(10_ms, 10);
+  BOOST_CHECK_EQUAL(nHelloDataRcvd, 3);
+  BOOST_CHECK_EQUAL(group->m_nHellosInFlight, 0);
+  BOOST_CHECK(group->m_helloQueue.empty());
+
+  int nHelloInterests = 0;
+  for (const auto& interest : face.sentInterests) {
+    if (interest.getName().get(1) == Name::Component("hello")) {
+      ++nHelloInterests;
+    }
+  }
+  BOOST_CHECK_EQUAL(nHelloInterests, 3);
+}
+
+BOOST_AUTO_TEST_CASE(HelloFetchError)
+{
+  makeGroup(1);
+  // No producer answers for this group
+  BOOST_REQUIRE(group->addSyncGroup("/psync-z") != nullptr);
+  group->sendHelloInterest("/psync-z");
+  group->sendHelloInterests();
+  BOOST_CHECK_EQUAL(group->m_nHellosInFlight, 1);
+  BOOST_CHECK_EQUAL(group->m_helloQueue.size(), 3);
+
+  // The group gives up its place once its hello Interest times out
+  advanceClocks(10_ms, 500);
+  BOOST_CHECK_EQUAL(nHelloDataRcvd, 3);
+  const auto& stats = group->getConsumer("/psync-z")->getStats();
+  BOOST_CHECK_GE(stats.nFetchErrors, 1);
+  BOOST_CHECK_LE(group->m_nHellosInFlight, 1);
+
+  // and keeps retrying through the queue
+  BOOST_CHECK_GE(stats.nHelloInterests, 2);
+}
+
+BOOST_AUTO_TEST_CASE(Sync)
+{
+  makeGroup();
+  group->sendHelloInterests();
+  advanceClocks(10_ms, 10);
+  BOOST_REQUIRE_EQUAL(nHelloDataRcvd, 3);
+
+  for (const auto& producer : producers) {
+    producer->publishName(Name(producer->m_syncPrefix).append("user"));
+  }
+  advanceClocks(10_ms, 10);
+
+  BOOST_CHECK_EQUAL(received.size(), 3);
+  for (const auto& syncPrefix : syncPrefixes) {
+    BOOST_CHECK_EQUAL(received[Name(syncPrefix).append("user")], 1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(CoalescedUpdates)
+{
+  makeGroup();
+  std::map<Name, std::vector<MissingDataInfo>> dispatched;
+  group->m_onUpdate = [&] (const auto& updates) {
+    ++nDispatches;
+    dispatched = updates;
+  };
+
+  group->getConsumer("/psync-a")->m_onUpdate({{"/psync-a/user", 1, 1, 0}});
+  group->getConsumer("/psync-b")->m_onUpdate({{"/psync-b/user", 1, 1, 0}});
+  group->getConsumer("/psync-a")->m_onUpdate({{"/psync-a/user", 2, 3, 0}});
+  BOOST_CHECK_EQUAL(nDispatches, 0);
+
+  advanceClocks(1_ms);
+  BOOST_CHECK_EQUAL(nDispatches, 1);
+  BOOST_REQUIRE_EQUAL(dispatched.size(), 2);
+  BOOST_REQUIRE_EQUAL(dispatched["/psync-a"].size(), 2);
+  BOOST_CHECK_EQUAL(dispatched["/psync-a"][1].highSeq, 3);
+  BOOST_CHECK_EQUAL(dispatched["/psync-b"].size(), 1);
+
+  // Updates of a removed group are dropped
+  group->getConsumer("/psync-c")->m_onUpdate({{"/psync-c/user", 1, 1, 0}});
+  group->removeSyncGroup("/psync-c");
+  advanceClocks(1_ms);
+  BOOST_CHECK_EQUAL(nDispatches, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::tests
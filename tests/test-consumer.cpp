@@ -18,6 +18,7 @@
  */
 
 #include "PSync/consumer.hpp"
+#include "PSync/detail/bloom-filter.hpp"
 
 #include "tests/boost-test.hpp"
 #include "tests/io-fixture.hpp"
@@ -30,6 +31,17 @@ using ndn::Name;
 
 BOOST_AUTO_TEST_SUITE(TestConsumer)
 
+BOOST_AUTO_TEST_CASE(OptionsPositionalOrder)
+{
+  // Options added after the original ones must not shift them
+  Consumer::Options opts{[] (const auto&) {}, [] (const auto&) {}, 40, 0.01, 1_s, 2_s};
+  BOOST_CHECK_EQUAL(opts.bfCount, 40);
+  BOOST_CHECK_EQUAL(opts.bfFalsePositive, 0.01);
+  BOOST_CHECK_EQUAL(opts.helloInterestLifetime, 1_s);
+  BOOST_CHECK_EQUAL(opts.syncInterestLifetime, 2_s);
+  BOOST_CHECK_EQUAL(opts.bfBlocked, false);
+}
+
 BOOST_AUTO_TEST_CASE(AddSubscription)
 {
   ndn::DummyClientFace face;
@@ -60,6 +72,78 @@ BOOST_AUTO_TEST_CASE(RemoveSubscription)
   BOOST_CHECK(!consumer.isSubscribed(subscription));
 }
 
+BOOST_AUTO_TEST_CASE(RemoveSubscriptionKeepsFilterExact)
+{
+  ndn::DummyClientFace face;
+  Consumer::Options opts;
+  opts.bfCount = 40;
+  Consumer consumer(face, "/psync", opts);
+
+  detail::BloomFilter expected(40, 0.001);
+  for (int i = 0; i < 10; i++) {
+    consumer.addSubscription("test-" + std::to_string(i), 0);
+    if (i % 2 == 0) {
+      expected.insert("test-" + std::to_string(i));
+    }
+  }
+  for (int i = 1; i < 10; i += 2) {
+    BOOST_CHECK(consumer.removeSubscription("test-" + std::to_string(i)));
+  }
+
+  BOOST_CHECK_EQUAL(*consumer.m_subscriptionFilter->asBloomFilter(), expected);
+}
+
+BOOST_AUTO_TEST_CASE(SubscriptionFilterGrows)
+{
+  ndn::DummyClientFace face;
+  Consumer::Options opts;
+  opts.bfCount = 4;
+  opts.subscriptionFilter = SubscriptionFilterType::CUCKOO;
+  Consumer consumer(face, "/psync", opts);
+
+  for (int i = 0; i < 20; i++) {
+    consumer.addSubscription("test-" + std::to_string(i), 0);
+  }
+
+  BOOST_CHECK_GE(consumer.m_subscriptionFilterCount, 20);
+  for (int i = 0; i < 20; i++) {
+    BOOST_CHECK(consumer.m_subscriptionFilter->contains("test-" + std::to_string(i)));
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(BulkSubscriptions, IoFixture)
+{
+  ndn::DummyClientFace face(m_io);
+  int nUpdateCallbacks = 0;
+  size_t nUpdates = 0;
+  Consumer::Options opts;
+  opts.bfCount = 40;
+  opts.onUpdate = [&] (const auto& updates) {
+    ++nUpdateCallbacks;
+    nUpdates += updates.size();
+  };
+  Consumer consumer(face, "/psync", opts);
+
+  std::map<Name, uint64_t> subscriptions{{"test-1", 0}, {"test-2", 5}, {"test-3", 7}};
+  BOOST_CHECK_EQUAL(consumer.addSubscriptions(subscriptions), 3);
+  BOOST_CHECK_EQUAL(consumer.addSubscriptions(subscriptions), 0);
+  BOOST_CHECK_EQUAL(nUpdateCallbacks, 1);
+  BOOST_CHECK_EQUAL(nUpdates, 2);
+  BOOST_CHECK(consumer.isSubscribed("test-2"));
+
+  // No hello data received yet, so no sync Interest
+  advanceClocks(10_ms);
+  BOOST_CHECK_EQUAL(face.sentInterests.size(), 0);
+
+  consumer.m_iblt = Name("test");
+  BOOST_CHECK_EQUAL(consumer.removeSubscriptions({"test-1", "test-2", "test-4"}), 2);
+  advanceClocks(10_ms);
+  BOOST_CHECK_EQUAL(face.sentInterests.size(), 1);
+  BOOST_CHECK(!consumer.isSubscribed("test-1"));
+  BOOST_CHECK(consumer.isSubscribed("test-3"));
+  consumer.stop();
+}
+
 BOOST_FIXTURE_TEST_CASE(ConstantTimeoutForFirstSegment, IoFixture)
 {
   ndn::DummyClientFace face(m_io);
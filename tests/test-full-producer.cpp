@@ -136,6 +136,62 @@ BOOST_AUTO_TEST_CASE(SatisfyPendingInterestsBehavior)
   BOOST_CHECK_EQUAL(node.m_pendingEntries.empty(), true);
 }
 
+BOOST_AUTO_TEST_CASE(FutureHash)
+{
+  Name syncPrefix("/psync");
+  FullProducer::Options opts;
+  opts.ibfCount = 40;
+  FullProducer node(m_face, m_keyChain, syncPrefix, opts);
+  node.addUserNode("/alice");
+  node.updateSeqNo("/alice", 1);
+
+  auto hash1 = detail::murmurHash3(detail::N_HASHCHECK, Name("/alice").appendNumber(1));
+  auto hash2 = detail::murmurHash3(detail::N_HASHCHECK, Name("/alice").appendNumber(2));
+  auto hash3 = detail::murmurHash3(detail::N_HASHCHECK, Name("/alice").appendNumber(3));
+  detail::IBLTDiff::Keys negative{hash2, hash3};
+  std::sort(negative.begin(), negative.end());
+  BOOST_CHECK_EQUAL(node.isFutureHash(hash1, negative), true);
+  BOOST_CHECK_EQUAL(node.isFutureHash(hash1, {hash3}), false);
+  BOOST_CHECK_EQUAL(node.isFutureHash(hash2, negative), false);
+
+  // The peer already has /alice/2, so /alice/1 is not sent
+  detail::IBLT peer(40, CompressionScheme::DEFAULT);
+  peer.insert(hash2);
+  Name syncInterestName(syncPrefix);
+  peer.appendToName(syncInterestName);
+  syncInterestName.appendNumber(2);
+  node.onSyncInterest(syncPrefix, Interest(syncInterestName));
+  advanceClocks(10_ms);
+  BOOST_CHECK_EQUAL(m_face.sentData.size(), 0);
+
+  node.updateSeqNo("/alice", 2);
+  BOOST_CHECK_EQUAL(node.isFutureHash(hash2, {hash3}), true);
+}
+
+BOOST_AUTO_TEST_CASE(StatsOfWaitingInterest)
+{
+  Name syncPrefix("/psync");
+  FullProducer::Options opts;
+  opts.ibfCount = 40;
+  FullProducer node(m_face, m_keyChain, syncPrefix, opts);
+
+  // The peer is ahead, its Interest waits to be processed again
+  detail::IBLT peer(40, CompressionScheme::DEFAULT);
+  peer.insert(detail::murmurHash3(detail::N_HASHCHECK, Name("/bob").appendNumber(1)));
+  Name syncInterestName(syncPrefix);
+  peer.appendToName(syncInterestName);
+  syncInterestName.appendNumber(1);
+  node.onSyncInterest(syncPrefix, Interest(syncInterestName));
+  BOOST_CHECK_EQUAL(node.getStats().nWaitingInterests, 1);
+
+  node.processWaitingInterests();
+  node.processWaitingInterests();
+  auto stats = node.getStats();
+  BOOST_CHECK_EQUAL(stats.nSyncInterests, 1);
+  BOOST_CHECK_EQUAL(stats.nDecodeSuccesses, 1);
+  BOOST_CHECK_EQUAL(stats.nDecodeFailures, 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace psync::tests
@@ -22,6 +22,8 @@
 
 #include "tests/boost-test.hpp"
 
+#include <algorithm>
+
 namespace psync::tests {
 
 using namespace psync::detail;
@@ -185,6 +187,117 @@ BOOST_AUTO_TEST_CASE(Difference)
   BOOST_CHECK_EQUAL(diff.negative.size(), 1);
 }
 
+BOOST_AUTO_TEST_CASE(DifferenceIsSorted)
+{
+  IBLT ownIBF(100, CompressionScheme::NONE);
+  IBLT rcvdIBF(100, CompressionScheme::NONE);
+  std::vector<uint32_t> expectedPositive;
+  std::vector<uint32_t> expectedNegative;
+  for (int i = 0; i < 30; i++) {
+    uint32_t hash = murmurHash3(11, Name("/test/memphis").appendNumber(i));
+    if (i % 3 == 0) {
+      rcvdIBF.insert(hash);
+      expectedNegative.push_back(hash);
+    }
+    else {
+      ownIBF.insert(hash);
+      expectedPositive.push_back(hash);
+    }
+  }
+  std::sort(expectedPositive.begin(), expectedPositive.end());
+  std::sort(expectedNegative.begin(), expectedNegative.end());
+
+  auto diff = ownIBF - rcvdIBF;
+  BOOST_CHECK(diff.canDecode);
+  BOOST_TEST(diff.positive == expectedPositive, boost::test_tools::per_element());
+  BOOST_TEST(diff.negative == expectedNegative, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(SixtyFourBitKeys)
+{
+  IBLT64 ownIBF(40, CompressionScheme::NONE);
+  IBLT64 rcvdIBF(40, CompressionScheme::NONE);
+  // Keys that differ only in their upper 32 bits
+  const uint64_t key1 = 0x0000000100000007;
+  const uint64_t key2 = 0x0000000200000007;
+  ownIBF.insert(key1);
+  ownIBF.insert(key2);
+  rcvdIBF.insert(key2);
+  rcvdIBF.insert(0xFFFFFFFFFFFFFFFF);
+
+  auto diff = ownIBF - rcvdIBF;
+  BOOST_CHECK(diff.canDecode);
+  BOOST_REQUIRE_EQUAL(diff.positive.size(), 1);
+  BOOST_CHECK_EQUAL(diff.positive[0], key1);
+  BOOST_REQUIRE_EQUAL(diff.negative.size(), 1);
+  BOOST_CHECK_EQUAL(diff.negative[0], 0xFFFFFFFFFFFFFFFF);
+
+  Name name;
+  ownIBF.appendToName(name);
+  // count, keySum and keyCheck take 4, 8 and 4 bytes
+  BOOST_CHECK_EQUAL(name.at(-1).value_size(), 16 * ownIBF.getHashTable().size());
+  IBLT64 decoded(40, CompressionScheme::NONE);
+  decoded.initialize(name.at(-1));
+  BOOST_CHECK_EQUAL(decoded, ownIBF);
+
+  ownIBF.erase(key1);
+  ownIBF.erase(key2);
+  BOOST_CHECK_EQUAL(ownIBF, IBLT64(40, CompressionScheme::NONE));
+
+  // The 32-bit encoding is not accepted
+  IBLT iblt(40, CompressionScheme::NONE);
+  Name name32;
+  iblt.appendToName(name32);
+  BOOST_CHECK_THROW(decoded.initialize(name32.at(-1)), IBLT64::Error);
+}
+
+BOOST_AUTO_TEST_CASE(ZeroEntries)
+{
+  BOOST_CHECK_THROW(IBLT(0, CompressionScheme::NONE), IBLT::Error);
+  BOOST_CHECK_THROW(IBLT64(0, CompressionScheme::NONE), IBLT64::Error);
+
+  // The smallest table has one bucket for each hash function
+  IBLT iblt(1, CompressionScheme::NONE);
+  BOOST_CHECK_EQUAL(iblt.getHashTable().size(), N_HASH);
+  iblt.insert(42);
+  auto diff = iblt - IBLT(1, CompressionScheme::NONE);
+  BOOST_CHECK(diff.canDecode);
+  BOOST_REQUIRE_EQUAL(diff.positive.size(), 1);
+  BOOST_CHECK_EQUAL(diff.positive[0], 42);
+}
+
+BOOST_AUTO_TEST_CASE(OtherHashCount)
+{
+  using IBLT4 = BasicIBLT<uint32_t, 4>;
+
+  IBLT4 ownIBF(40, CompressionScheme::NONE);
+  IBLT4 rcvdIBF(40, CompressionScheme::NONE);
+  // Each hash function has the same number of entries
+  BOOST_CHECK_EQUAL(ownIBF.getHashTable().size() % 4, 0);
+
+  for (uint32_t i = 0; i < 10; i++) {
+    ownIBF.insert(murmurHash3(11, Name("/test/memphis").appendNumber(i)));
+  }
+  rcvdIBF = ownIBF;
+  uint32_t ownHash = murmurHash3(11, Name("/test/memphis").appendNumber(10));
+  uint32_t rcvdHash = murmurHash3(11, Name("/test/arizona").appendNumber(1));
+  ownIBF.insert(ownHash);
+  rcvdIBF.insert(rcvdHash);
+
+  auto diff = ownIBF - rcvdIBF;
+  BOOST_CHECK(diff.canDecode);
+  BOOST_REQUIRE_EQUAL(diff.positive.size(), 1);
+  BOOST_CHECK_EQUAL(diff.positive[0], ownHash);
+  BOOST_REQUIRE_EQUAL(diff.negative.size(), 1);
+  BOOST_CHECK_EQUAL(diff.negative[0], rcvdHash);
+
+  Name name;
+  ownIBF.appendToName(name);
+  IBLT4 decoded(40, CompressionScheme::NONE);
+  decoded.initialize(name.at(-1));
+  BOOST_CHECK_EQUAL(decoded, ownIBF);
+}
+
 BOOST_AUTO_TEST_CASE(DifferenceBwOversizedIBFs)
 {
   // Insert 50 elements into IBF of size 10
@@ -0,0 +1,253 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/detail/mapped-prefix-table.hpp"
+#include "PSync/detail/util.hpp"
+#include "PSync/producer-base.hpp"
+
+#include "tests/boost-test.hpp"
+#include "tests/key-chain-fixture.hpp"
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+namespace psync::tests {
+
+using detail::MappedPrefixTable;
+using ndn::Name;
+
+class MappedPrefixTableFixture : public KeyChainFixture
+{
+protected:
+  MappedPrefixTableFixture()
+  {
+    std::filesystem::remove_all(m_dir);
+    std::filesystem::create_directories(m_dir);
+  }
+
+  ~MappedPrefixTableFixture()
+  {
+    std::filesystem::remove_all(m_dir);
+  }
+
+  static uint32_t
+  getKey(const Name& prefix, uint64_t seq)
+  {
+    return detail::murmurHash3(detail::N_HASHCHECK, Name(prefix).appendNumber(seq));
+  }
+
+protected:
+  const std::filesystem::path m_dir = std::filesystem::temp_directory_path() / "psync-test-prefix-table";
+  const std::string m_path = (m_dir / "prefixes").string();
+};
+
+BOOST_FIXTURE_TEST_SUITE(TestMappedPrefixTable, MappedPrefixTableFixture)
+
+BOOST_AUTO_TEST_CASE(Basic)
+{
+  MappedPrefixTable table(m_path, 100);
+  BOOST_CHECK_EQUAL(table.size(), 0);
+
+  BOOST_CHECK(table.insert("/a"));
+  BOOST_CHECK(!table.insert("/a"));
+  BOOST_CHECK(table.insert("/b"));
+  BOOST_CHECK_EQUAL(table.size(), 2);
+  BOOST_CHECK_EQUAL(table.getSeqNo("/a").value(), 0);
+  BOOST_CHECK(!table.getSeqNo("/c"));
+
+  BOOST_CHECK(table.setSeqNo("/a", 1, getKey("/a", 1)));
+  BOOST_CHECK(table.setSeqNo("/a", 2, getKey("/a", 2)));
+  BOOST_CHECK(!table.setSeqNo("/c", 1, getKey("/c", 1)));
+  BOOST_CHECK_EQUAL(table.getSeqNo("/a").value(), 2);
+  BOOST_CHECK(!table.findByKey(getKey("/a", 1)));
+  BOOST_CHECK_EQUAL(table.findByKey(getKey("/a", 2)).value(), Name("/a").appendNumber(2));
+
+  BOOST_CHECK_EQUAL(table.erase("/a").value(), 2);
+  BOOST_CHECK(!table.erase("/a"));
+  BOOST_CHECK(!table.findByKey(getKey("/a", 2)));
+  BOOST_CHECK_EQUAL(table.size(), 1);
+
+  // The slot of an erased prefix is reused
+  BOOST_CHECK(table.insert("/a"));
+  BOOST_CHECK_EQUAL(table.getSeqNo("/a").value(), 0);
+  BOOST_CHECK_EQUAL(table.getSeqNo("/b").value(), 0);
+
+  table.clear();
+  BOOST_CHECK_EQUAL(table.size(), 0);
+  BOOST_CHECK(!table.getSeqNo("/b"));
+}
+
+BOOST_AUTO_TEST_CASE(NameWithoutWire)
+{
+  MappedPrefixTable table(m_path, 100);
+
+  // The empty component has no wire, neither has the Name until it is encoded
+  Name prefix("/a/long-" + std::string(300, 'x'));
+  prefix.append(ndn::name::Component());
+  BOOST_REQUIRE(!prefix.hasWire());
+  BOOST_CHECK(table.insert(prefix));
+  BOOST_CHECK(!prefix.hasWire());
+
+  Name decoded(Name(prefix).wireEncode());
+  BOOST_CHECK(!table.insert(decoded));
+  BOOST_CHECK_EQUAL(table.getSeqNo(decoded).value(), 0);
+  BOOST_CHECK(!table.getSeqNo(prefix.getPrefix(-1)));
+  table.forEach([&] (const Name& name, uint64_t) { BOOST_CHECK_EQUAL(name, prefix); });
+}
+
+BOOST_AUTO_TEST_CASE(Reopen)
+{
+  std::map<Name, uint64_t> expected;
+  {
+    MappedPrefixTable table(m_path, 1000);
+    // Enough names to grow the arena
+    for (uint64_t i = 0; i < 1000; i++) {
+      Name prefix("/some/longer/prefix/name/of/user-" + std::to_string(i) + std::string(1000, 'x'));
+      table.insert(prefix);
+      table.setSeqNo(prefix, i, getKey(prefix, i));
+      expected[prefix] = i;
+    }
+    table.setNumOwnElements(42);
+  }
+
+  MappedPrefixTable table(m_path, 10);
+  BOOST_CHECK_EQUAL(table.size(), expected.size());
+  BOOST_CHECK_EQUAL(table.getNumOwnElements(), 42);
+
+  std::map<Name, uint64_t> actual;
+  table.forEach([&] (const Name& prefix, uint64_t seq) { actual[prefix] = seq; });
+  BOOST_CHECK(actual == expected);
+
+  // Sequence number zero has no key
+  size_t nKeys = 0;
+  table.forEachKey([&] (uint32_t key) {
+    ++nKeys;
+    BOOST_CHECK(table.findByKey(key));
+  });
+  BOOST_CHECK_EQUAL(nKeys, expected.size() - 1);
+}
+
+BOOST_AUTO_TEST_CASE(Churn)
+{
+  MappedPrefixTable table(m_path, 100);
+  auto fileSize = table.m_file.size();
+  auto makePrefix = [] (uint64_t i) {
+    return Name("/user-" + std::to_string(i) + std::string(1000, 'x'));
+  };
+
+  // Without reclaiming the slots and names of erased prefixes, the table would be full
+  // and the file would grow to about ten times the initial arena
+  for (uint64_t i = 0; i < 10000; i++) {
+    BOOST_REQUIRE(table.insert(makePrefix(i)));
+    table.setSeqNo(makePrefix(i), i + 1, getKey(makePrefix(i), i + 1));
+    if (i >= 50) {
+      BOOST_REQUIRE_EQUAL(table.erase(makePrefix(i - 50)).value(), i - 49);
+    }
+  }
+  BOOST_CHECK_EQUAL(table.size(), 50);
+  BOOST_CHECK_EQUAL(table.m_file.size(), fileSize);
+
+  size_t nKeys = 0;
+  table.forEachKey([&] (uint32_t key) {
+    ++nKeys;
+    BOOST_CHECK(table.findByKey(key));
+  });
+  BOOST_CHECK_EQUAL(nKeys, 50);
+  BOOST_CHECK_EQUAL(table.findByKey(getKey(makePrefix(9999), 10000)).value(),
+                    makePrefix(9999).appendNumber(10000));
+  BOOST_CHECK(!table.findByKey(getKey(makePrefix(0), 1)));
+}
+
+BOOST_AUTO_TEST_CASE(Grow)
+{
+  auto makePrefix = [] (uint64_t i) {
+    return Name("/user-" + std::to_string(i));
+  };
+  // Left behind by a crash while growing, it is not the table
+  std::ofstream(m_path + ".tmp") << "partial table";
+  {
+    MappedPrefixTable table(m_path, 5);
+    auto nSlots = table.m_nSlots;
+    for (uint64_t i = 0; i < 1000; i++) {
+      BOOST_REQUIRE(table.insert(makePrefix(i)));
+      table.setSeqNo(makePrefix(i), i, getKey(makePrefix(i), i));
+    }
+    BOOST_CHECK_GT(table.m_nSlots, nSlots);
+    BOOST_CHECK_EQUAL(table.size(), 1000);
+    BOOST_CHECK(!std::filesystem::exists(m_path + ".tmp"));
+  }
+
+  MappedPrefixTable table(m_path, 5);
+  BOOST_CHECK_EQUAL(table.size(), 1000);
+  for (uint64_t i = 0; i < 1000; i++) {
+    BOOST_CHECK_EQUAL(table.getSeqNo(makePrefix(i)).value_or(i + 1), i);
+    if (i != 0) {
+      BOOST_CHECK_EQUAL(table.findByKey(getKey(makePrefix(i), i)).value_or(Name()),
+                        makePrefix(i).appendNumber(i));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(NotATable)
+{
+  std::ofstream(m_path) << "some other file";
+  BOOST_CHECK_THROW(MappedPrefixTable(m_path, 10), MappedPrefixTable::Error);
+}
+
+BOOST_AUTO_TEST_CASE(Producer)
+{
+  ndn::DummyClientFace face;
+  ProducerBase inMemory(face, m_keyChain, 40, "/psync");
+  {
+    ProducerBase mapped(face, m_keyChain, 40, "/psync");
+    mapped.usePrefixTableFile(m_path, 100);
+    for (auto* producer : {&inMemory, &mapped}) {
+      for (int i = 0; i < 10; i++) {
+        Name prefix("/user-" + std::to_string(i));
+        producer->addUserNode(prefix);
+        producer->updateSeqNo(prefix, 1);
+        producer->updateSeqNo(prefix, i + 2);
+      }
+      producer->removeUserNode("/user-3");
+    }
+    BOOST_CHECK(mapped.m_prefixes.empty());
+    BOOST_CHECK_EQUAL(mapped.getNumPrefixes(), 9);
+    BOOST_CHECK_EQUAL(mapped.m_iblt, inMemory.m_iblt);
+    BOOST_CHECK_EQUAL(mapped.m_numOwnElements, inMemory.m_numOwnElements);
+    BOOST_CHECK_EQUAL(mapped.findNameByHash(getKey("/user-5", 7)).value(),
+                      Name("/user-5").appendNumber(7));
+    BOOST_CHECK(!mapped.findNameByHash(getKey("/user-3", 5)));
+  }
+
+  // The prefixes and the IBF are restored from the file
+  ProducerBase reopened(face, m_keyChain, 40, "/psync");
+  reopened.usePrefixTableFile(m_path, 100);
+  BOOST_CHECK_EQUAL(reopened.getNumPrefixes(), 9);
+  BOOST_CHECK_EQUAL(reopened.getSeqNo("/user-9").value_or(0), 11);
+  BOOST_CHECK_EQUAL(reopened.m_iblt, inMemory.m_iblt);
+  BOOST_CHECK_EQUAL(reopened.m_numOwnElements, inMemory.m_numOwnElements);
+  BOOST_CHECK_THROW(reopened.usePrefixTableFile(m_path, 100), ProducerBase::Error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::tests
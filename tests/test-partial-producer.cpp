@@ -18,6 +18,7 @@
  **/
 
 #include "PSync/partial-producer.hpp"
+#include "PSync/detail/util.hpp"
 
 #include "tests/boost-test.hpp"
 #include "tests/key-chain-fixture.hpp"
@@ -73,6 +74,74 @@ BOOST_AUTO_TEST_CASE(PublishName)
   BOOST_CHECK_EQUAL(producer.getSeqNo(nonUser).value_or(-1), -1);
 }
 
+BOOST_AUTO_TEST_CASE(HelloReplyCache)
+{
+  Name syncPrefix("/psync"), userNode("/testUser");
+  PartialProducer producer(m_face, m_keyChain, syncPrefix, {});
+  producer.addUserNode(userNode);
+
+  Name helloPrefix = Name(syncPrefix).append("hello");
+  Interest helloInterest(helloPrefix);
+  producer.onHelloInterest(helloPrefix, helloInterest);
+  m_face.processEvents(10_ms);
+  BOOST_CHECK_EQUAL(producer.getNumHelloReplyBuilds(), 1);
+  BOOST_REQUIRE_EQUAL(m_face.sentData.size(), 1);
+  Name firstReply = m_face.sentData.back().getName();
+
+  // Reply has expired from the store, but the state has not changed
+  producer.m_segmentPublisher.m_ims.erase(helloPrefix);
+  producer.onHelloInterest(helloPrefix, helloInterest);
+  m_face.processEvents(10_ms);
+  BOOST_CHECK_EQUAL(producer.getNumHelloReplyBuilds(), 1);
+  BOOST_REQUIRE_EQUAL(m_face.sentData.size(), 2);
+  BOOST_CHECK_EQUAL(m_face.sentData.back().getName(), firstReply);
+
+  producer.publishName(userNode);
+  producer.m_segmentPublisher.m_ims.erase(helloPrefix);
+  producer.onHelloInterest(helloPrefix, helloInterest);
+  m_face.processEvents(10_ms);
+  BOOST_CHECK_EQUAL(producer.getNumHelloReplyBuilds(), 2);
+  BOOST_REQUIRE_EQUAL(m_face.sentData.size(), 3);
+  BOOST_CHECK_NE(m_face.sentData.back().getName(), firstReply);
+}
+
+BOOST_AUTO_TEST_CASE(Stats)
+{
+  Name syncPrefix("/psync"), userNode("/testUser");
+  PartialProducer producer(m_face, m_keyChain, syncPrefix, {});
+  producer.addUserNode(userNode);
+  producer.publishName(userNode);
+
+  Name helloPrefix = Name(syncPrefix).append("hello");
+  Interest helloInterest(helloPrefix);
+  producer.onHelloInterest(helloPrefix, helloInterest);
+  // Answered from the store
+  producer.onHelloInterest(helloPrefix, helloInterest);
+
+  // Too many differences to decode
+  detail::IBLT iblt(40, CompressionScheme::NONE);
+  for (uint32_t i = 0; i < 100; i++) {
+    iblt.insert(i);
+  }
+  Name syncInterestName = Name(syncPrefix).append("sync");
+  detail::BloomFilter(20, 0.001).appendToName(syncInterestName);
+  iblt.appendToName(syncInterestName);
+  producer.onSyncInterest(Name(syncPrefix).append("sync"), Interest(syncInterestName));
+
+  auto stats = producer.getStats();
+  BOOST_CHECK_EQUAL(stats.nHelloInterests, 2);
+  BOOST_CHECK_EQUAL(stats.nSyncInterests, 1);
+  BOOST_CHECK_EQUAL(stats.nRepliesFromStore, 1);
+  BOOST_CHECK_EQUAL(stats.nReplies, 1);
+  BOOST_CHECK_EQUAL(stats.nFullStateReplies, 1);
+  BOOST_CHECK_EQUAL(stats.replySize.getCount(), 1);
+  BOOST_CHECK_GT(stats.nBytesAfterCompression, 0);
+  BOOST_CHECK_EQUAL(stats.nDecodeSuccesses, 0);
+  BOOST_CHECK_EQUAL(stats.nDecodeFailures, 1);
+  BOOST_CHECK_EQUAL(stats.nNacks, 1);
+  BOOST_CHECK_EQUAL(stats.nPendingInterests, 0);
+}
+
 BOOST_AUTO_TEST_CASE(SameSyncInterest)
 {
   Name syncPrefix("/psync"), userNode("/testUser");
@@ -110,6 +179,208 @@ BOOST_AUTO_TEST_CASE(SameSyncInterest)
   BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 0);
 }
 
+BOOST_AUTO_TEST_CASE(SatisfyPendingSyncInterests)
+{
+  Name syncPrefix("/psync");
+  PartialProducer::Options opts;
+  opts.ibfCount = 20;
+  PartialProducer producer(m_face, m_keyChain, syncPrefix, opts);
+  for (int i = 0; i < 20; i++) {
+    producer.addUserNode("testUser-" + std::to_string(i));
+  }
+
+  Name syncInterestPrefix = Name(syncPrefix).append("sync");
+  auto makeSyncInterest = [&] (const Name& subscription) {
+    Name syncInterestName(syncInterestPrefix);
+    detail::BloomFilter bf(20, 0.001);
+    bf.insert(subscription);
+    bf.appendToName(syncInterestName);
+    producer.m_iblt.appendToName(syncInterestName);
+    Interest syncInterest(syncInterestName);
+    syncInterest.setInterestLifetime(10_s);
+    return syncInterest;
+  };
+
+  auto interest2 = makeSyncInterest("testUser-2");
+  auto interest3 = makeSyncInterest("testUser-3");
+  producer.onSyncInterest(syncInterestPrefix, interest2);
+  producer.onSyncInterest(syncInterestPrefix, interest3);
+  BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 2);
+  BOOST_CHECK_EQUAL(producer.m_subscriptionGroups.size(), 1);
+  BOOST_CHECK_EQUAL(producer.m_thresholdQueue.size(), 2);
+
+  // Only the subscribed entry is answered
+  producer.publishName("testUser-2");
+  BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 1);
+  BOOST_CHECK_EQUAL(producer.m_pendingEntries.count(interest3.getName()), 1);
+
+  // Difference grows by one with each publish, threshold is 20 / 2 = 10
+  for (int i = 4; i < 12; i++) {
+    producer.publishName("testUser-" + std::to_string(i));
+  }
+  BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 1);
+
+  producer.publishName("testUser-12");
+  BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 0);
+  BOOST_CHECK_EQUAL(producer.m_subscriptionGroups.size(), 0);
+  BOOST_CHECK_EQUAL(producer.m_thresholdQueue.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(LoadStateWithPendingInterest)
+{
+  Name syncPrefix("/psync");
+  PartialProducer::Options opts;
+  opts.ibfCount = 20;
+  PartialProducer producer(m_face, m_keyChain, syncPrefix, opts);
+  std::vector<std::pair<Name, uint64_t>> state;
+  for (int i = 0; i < 40; i++) {
+    Name prefix("testUser-" + std::to_string(i));
+    producer.addUserNode(prefix);
+    state.emplace_back(prefix, 1);
+  }
+
+  Name syncInterestName = Name(syncPrefix).append("sync");
+  detail::BloomFilter bf(20, 0.001);
+  bf.insert("/other");
+  bf.appendToName(syncInterestName);
+  producer.m_iblt.appendToName(syncInterestName);
+  Interest syncInterest(syncInterestName);
+  syncInterest.setInterestLifetime(10_s);
+  producer.onSyncInterest(Name(syncPrefix).append("sync"), syncInterest);
+  BOOST_REQUIRE_EQUAL(producer.m_pendingEntries.size(), 1);
+
+  // A difference of 3, below the threshold of 20 / 2 = 10: checked again and kept
+  ndn::span<const std::pair<Name, uint64_t>> entries(state);
+  producer.loadState(entries.first(3));
+  BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 1);
+  BOOST_REQUIRE_EQUAL(producer.m_thresholdQueue.size(), 1);
+  BOOST_CHECK_GT(producer.m_thresholdQueue.begin()->first, producer.m_stateVersion);
+
+  // A difference of 40 in a single state version is past the threshold
+  producer.loadState(entries.subspan(3));
+  BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 0);
+  BOOST_CHECK_EQUAL(producer.m_thresholdQueue.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(BlockedBloomFilter)
+{
+  Name syncPrefix("/psync"), userNode("/testUser"), otherNode("/otherUser");
+  PartialProducer producer(m_face, m_keyChain, syncPrefix, {});
+  producer.addUserNode(userNode);
+  producer.addUserNode(otherNode);
+
+  Name syncInterestPrefix = Name(syncPrefix).append("sync");
+  Name syncInterestName(syncInterestPrefix);
+  detail::BloomFilter bf(20, 0.001, detail::BloomFilter::Layout::BLOCKED);
+  bf.insert(userNode);
+  bf.appendToName(syncInterestName);
+  producer.m_iblt.appendToName(syncInterestName);
+
+  producer.onSyncInterest(syncInterestPrefix, Interest(syncInterestName));
+  BOOST_REQUIRE_EQUAL(producer.m_pendingEntries.size(), 1);
+  BOOST_CHECK(producer.m_pendingEntries.begin()->second.filter->asBloomFilter()->getLayout() ==
+              detail::BloomFilter::Layout::BLOCKED);
+
+  producer.publishName(otherNode);
+  BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 1);
+  producer.publishName(userNode);
+  BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(OtherSubscriptionFilters)
+{
+  Name syncPrefix("/psync"), userNode("/testUser"), otherNode("/otherUser");
+  PartialProducer producer(m_face, m_keyChain, syncPrefix, {});
+  producer.addUserNode(userNode);
+  producer.addUserNode(otherNode);
+
+  Name syncInterestPrefix = Name(syncPrefix).append("sync");
+  for (auto type : {SubscriptionFilterType::CUCKOO, SubscriptionFilterType::XOR}) {
+    Name syncInterestName(syncInterestPrefix);
+    auto filter = detail::makeSubscriptionFilter(type, 20, 0.001);
+    filter->insert(userNode);
+    filter->appendToName(syncInterestName);
+    producer.m_iblt.appendToName(syncInterestName);
+
+    producer.onSyncInterest(syncInterestPrefix, Interest(syncInterestName));
+    BOOST_REQUIRE_EQUAL(producer.m_pendingEntries.size(), 1);
+    BOOST_CHECK_EQUAL(producer.m_unindexedEntries.size(), 1);
+    BOOST_CHECK_EQUAL(producer.m_subscriptionGroups.size(), 0);
+
+    producer.publishName(otherNode);
+    BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 1);
+    producer.publishName(userNode);
+    BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 0);
+    BOOST_CHECK_EQUAL(producer.m_unindexedEntries.size(), 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SubscriptionToken)
+{
+  Name syncPrefix("/psync"), userNode("/testUser"), otherNode("/otherUser");
+  PartialProducer::Options opts;
+  opts.subscriptionTokenCacheSize = 1;
+  PartialProducer producer(m_face, m_keyChain, syncPrefix, opts);
+  producer.addUserNode(userNode);
+  producer.addUserNode(otherNode);
+
+  Name syncInterestPrefix = Name(syncPrefix).append("sync");
+  auto makeFilter = [] (const Name& subscription) {
+    detail::BloomFilter bf(20, 0.001);
+    bf.insert(subscription);
+    Name filterName;
+    bf.appendToName(filterName);
+    return filterName;
+  };
+  auto makeSyncInterestName = [&] (const Name& filterOrToken) {
+    Name syncInterestName = Name(syncInterestPrefix).append(filterOrToken);
+    producer.m_iblt.appendToName(syncInterestName);
+    return syncInterestName;
+  };
+
+  Name userFilter = makeFilter(userNode);
+  Name tokenName = makeSyncInterestName(Name().append(detail::makeSubscriptionToken(userFilter)));
+  Name fullName = makeSyncInterestName(userFilter);
+
+  // Token is unknown until the filter has been received
+  producer.onSyncInterest(syncInterestPrefix, Interest(tokenName));
+  m_face.processEvents(10_ms);
+  BOOST_REQUIRE_EQUAL(m_face.sentData.size(), 1);
+  BOOST_CHECK_EQUAL(m_face.sentData.back().getContentType(), ndn::tlv::ContentType_Nack);
+  BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 0);
+
+  producer.onSyncInterest(syncInterestPrefix, Interest(fullName));
+  BOOST_CHECK_EQUAL(producer.m_subscriptionTokens.size(), 1);
+  BOOST_CHECK_EQUAL(producer.m_subscriptionTokensByFilter.size(), 1);
+  producer.onSyncInterest(syncInterestPrefix, Interest(tokenName));
+  m_face.processEvents(10_ms);
+  BOOST_CHECK_EQUAL(m_face.sentData.size(), 1);
+  BOOST_REQUIRE_EQUAL(producer.m_pendingEntries.size(), 2);
+  // Both pending entries use the filter parsed once
+  BOOST_CHECK(producer.m_pendingEntries.at(fullName).filter ==
+              producer.m_pendingEntries.at(tokenName).filter);
+
+  producer.publishName(userNode);
+  m_face.processEvents(10_ms);
+  BOOST_CHECK_EQUAL(m_face.sentData.size(), 3);
+  BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 0);
+
+  // Receiving another filter evicts the first one
+  producer.onSyncInterest(syncInterestPrefix, Interest(makeSyncInterestName(makeFilter(otherNode))));
+  BOOST_CHECK_EQUAL(producer.m_subscriptionTokens.size(), 1);
+  tokenName = makeSyncInterestName(Name().append(detail::makeSubscriptionToken(userFilter)));
+  producer.onSyncInterest(syncInterestPrefix, Interest(tokenName));
+  m_face.processEvents(10_ms);
+  BOOST_CHECK_EQUAL(m_face.sentData.back().getContentType(), ndn::tlv::ContentType_Nack);
+  BOOST_CHECK_EQUAL(producer.m_subscriptionTokensByFilter.size(), 1);
+
+  // A filter without a token is found by the hash of its components, which must match exactly
+  Name otherFilter = makeFilter(otherNode);
+  uint32_t otherHash = detail::murmurHash3(detail::N_HASHCHECK, otherFilter);
+  BOOST_CHECK(producer.findSubscriptionFilter(otherFilter, otherHash) != nullptr);
+  BOOST_CHECK(producer.findSubscriptionFilter(userFilter, otherHash) == nullptr);
+}
+
 BOOST_AUTO_TEST_CASE(OnSyncInterest)
 {
   Name syncPrefix("/psync"), userNode("/testUser");
@@ -131,6 +402,16 @@ BOOST_AUTO_TEST_CASE(OnSyncInterest)
   producer.m_iblt.appendToName(syncInterestName);
   BOOST_CHECK_NO_THROW(producer.onSyncInterest(syncInterestName, Interest(syncInterestName)));
 
+  // Sync interest with unknown type of subscription filter
+  syncInterestName = syncPrefix;
+  syncInterestName.append("sync");
+  syncInterestName.appendNumber(20);
+  syncInterestName.appendNumber(1);
+  syncInterestName.append(ndn::name::Component(200));
+  producer.m_iblt.appendToName(syncInterestName);
+  BOOST_CHECK_NO_THROW(producer.onSyncInterest(syncInterestName, Interest(syncInterestName)));
+  BOOST_CHECK_EQUAL(producer.m_pendingEntries.size(), 0);
+
   // Sync interest with malicious IBF
   syncInterestName = syncPrefix;
   syncInterestName.append("sync");
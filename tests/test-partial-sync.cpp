@@ -24,6 +24,7 @@
 #include "tests/io-fixture.hpp"
 #include "tests/key-chain-fixture.hpp"
 
+#include <algorithm>
 #include <array>
 #include <ndn-cxx/util/dummy-client-face.hpp>
 
@@ -351,6 +352,46 @@ BOOST_AUTO_TEST_CASE(ApplicationNack)
   BOOST_CHECK_EQUAL(numSyncDataRcvd, 3);
 }
 
+BOOST_AUTO_TEST_CASE(SubscriptionToken)
+{
+  std::vector<std::string> subscribeTo{"testUser-2", "testUser-4", "testUser-6"};
+  addConsumer(0, subscribeTo);
+  consumers[0]->m_useSubscriptionToken = true;
+
+  auto isLastSyncInterestTokenOnly = [this] {
+    const auto& name = consumerFaces[0]->sentInterests.back().getName();
+    return name.size() == 4 && name.at(2).type() == tlv::SubscriptionTokenComponent;
+  };
+
+  consumers[0]->sendHelloInterest();
+  advanceClocks(ndn::time::milliseconds(10));
+  BOOST_CHECK_EQUAL(numHelloDataRcvd, 1);
+  BOOST_CHECK(!isLastSyncInterestTokenOnly());
+
+  publishUpdateFor("testUser-2");
+  BOOST_CHECK_EQUAL(numSyncDataRcvd, 1);
+  BOOST_CHECK(isLastSyncInterestTokenOnly());
+
+  publishUpdateFor("testUser-4");
+  BOOST_CHECK_EQUAL(numSyncDataRcvd, 2);
+  BOOST_CHECK(isLastSyncInterestTokenOnly());
+
+  // Producer forgets the filter, the consumer sends it again without a new hello
+  producer->m_subscriptionTokens.clear();
+  producer->m_subscriptionTokenLru.clear();
+  producer->m_subscriptionTokensByFilter.clear();
+  publishUpdateFor("testUser-6");
+  BOOST_CHECK_EQUAL(numSyncDataRcvd, 3);
+  advanceClocks(ndn::time::milliseconds(10));
+  BOOST_CHECK(!isLastSyncInterestTokenOnly());
+  BOOST_CHECK_EQUAL(face.sentData.back().getContentType(), ndn::tlv::ContentType_Nack);
+
+  publishUpdateFor("testUser-2");
+  BOOST_CHECK_EQUAL(numSyncDataRcvd, 4);
+  BOOST_CHECK_EQUAL(numHelloDataRcvd, 1);
+  BOOST_CHECK(isLastSyncInterestTokenOnly());
+}
+
 BOOST_AUTO_TEST_CASE(SegmentedHello)
 {
   std::vector<std::string> subscribeTo{"testUser-2", "testUser-4", "testUser-6"};
@@ -398,7 +439,7 @@ BOOST_AUTO_TEST_CASE(SegmentedSync)
 
   // To be used later to simulate sending delayed segmented interest
   Name syncInterestName(consumers[0]->m_syncInterestPrefix);
-  consumers[0]->m_bloomFilter.appendToName(syncInterestName);
+  consumers[0]->m_subscriptionFilter->appendToName(syncInterestName);
   syncInterestName.append(consumers[0]->m_iblt);
   syncInterestName.appendVersion();
   syncInterestName.appendSegment(1);
@@ -430,6 +471,54 @@ BOOST_AUTO_TEST_CASE(SegmentedSync)
   BOOST_CHECK_EQUAL(face.sentData.front().getName().at(-1).toSegment(), 1);
 }
 
+BOOST_AUTO_TEST_CASE(PipelinedSync)
+{
+  Name longNameToExceedDataSize;
+  for (int i = 0; i < 100; i++) {
+    longNameToExceedDataSize.append("test-" + std::to_string(i));
+  }
+  addUserNodes(longNameToExceedDataSize.toUri(), 10);
+
+  std::vector<std::string> subscribeTo;
+  for (int i = 1; i < 10; i++) {
+    subscribeTo.push_back(longNameToExceedDataSize.toUri() + "-" + std::to_string(i));
+  }
+  addConsumer(0, subscribeTo);
+  consumers[0]->m_pipelineSyncInterests = true;
+
+  consumers[0]->sendHelloInterest();
+  advanceClocks(ndn::time::milliseconds(10));
+  BOOST_CHECK_EQUAL(numHelloDataRcvd, 1);
+
+  // Sync data in two segments, sent when the pending sync Interest expires
+  oldSeqMap = producer->m_prefixes;
+  for (int i = 1; i < 10; i++) {
+    producer->updateSeqNo(longNameToExceedDataSize.toUri() + "-" + std::to_string(i), 1);
+  }
+  consumerFaces[0]->sentInterests.clear();
+  advanceClocks(ndn::time::milliseconds(10), 100);
+  BOOST_CHECK_EQUAL(numSyncDataRcvd, 1);
+  BOOST_CHECK(consumers[0]->m_pipelinedSyncFetcher == nullptr);
+
+  // The sync Interest carrying the new IBF was sent before the second segment was requested
+  Name newIblt;
+  producer->m_iblt.appendToName(newIblt);
+  const auto& sent = consumerFaces[0]->sentInterests;
+  auto secondSegment = std::find_if(sent.begin(), sent.end(), [] (const Interest& interest) {
+    return interest.getName().at(-1).isSegment() && interest.getName().at(-1).toSegment() == 1;
+  });
+  auto pipelined = std::find_if(sent.begin(), sent.end(), [&] (const Interest& interest) {
+    return interest.getName().at(-1) == newIblt.at(0);
+  });
+  BOOST_REQUIRE(secondSegment != sent.end());
+  BOOST_REQUIRE(pipelined != sent.end());
+  BOOST_CHECK(pipelined < secondSegment);
+
+  // Answered like any other sync Interest
+  publishUpdateFor(longNameToExceedDataSize.toUri() + "-1");
+  BOOST_CHECK_EQUAL(numSyncDataRcvd, 2);
+}
+
 BOOST_AUTO_TEST_CASE(DelayedSubscription) // #5122
 {
   publishUpdateFor("testUser-2");
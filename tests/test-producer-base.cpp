@@ -18,20 +18,40 @@
  **/
 
 #include "PSync/producer-base.hpp"
+#include "PSync/detail/util.hpp"
 
 #include "tests/boost-test.hpp"
+#include "tests/io-fixture.hpp"
 #include "tests/key-chain-fixture.hpp"
 
 #include <ndn-cxx/util/dummy-client-face.hpp>
 
+#include <filesystem>
+#include <fstream>
+
 namespace psync::tests {
 
 using ndn::Name;
 
-class ProducerBaseFixture : public KeyChainFixture
+class ProducerBaseFixture : public IoFixture, public KeyChainFixture
 {
 protected:
-  ndn::DummyClientFace m_face;
+  ProducerBaseFixture()
+  {
+    std::filesystem::remove_all(m_dir);
+    std::filesystem::create_directories(m_dir);
+  }
+
+  ~ProducerBaseFixture()
+  {
+    std::filesystem::remove_all(m_dir);
+  }
+
+protected:
+  ndn::DummyClientFace m_face{m_io, m_keyChain};
+  const std::filesystem::path m_dir = std::filesystem::temp_directory_path() / "psync-test-producer-base";
+  const std::string m_snapshotPath = (m_dir / "snapshot").string();
+  const std::string m_journalPath = (m_dir / "journal").string();
 };
 
 BOOST_FIXTURE_TEST_SUITE(TestProducerBase, ProducerBaseFixture)
@@ -53,8 +73,15 @@ BOOST_AUTO_TEST_CASE(Basic)
   uint32_t hash = producerBase.m_biMap.right.find(prefixWithSeq)->second;
   Name prefix(producerBase.m_biMap.left.find(hash)->second);
   BOOST_CHECK_EQUAL(prefix.getPrefix(-1), userNode);
+  BOOST_CHECK_EQUAL(producerBase.getNextSeqHash(hash).value(),
+                    detail::murmurHash3(detail::N_HASHCHECK, Name(userNode).appendNumber(2)));
+
+  producerBase.updateSeqNo(userNode, 2);
+  BOOST_CHECK(!producerBase.getNextSeqHash(hash));
+  producerBase.updateSeqNo(userNode, 1);
 
   producerBase.removeUserNode(userNode);
+  BOOST_CHECK(!producerBase.getNextSeqHash(hash));
   BOOST_CHECK(producerBase.getSeqNo(userNode) == std::nullopt);
   BOOST_CHECK(producerBase.m_biMap.right.find(prefixWithSeq) == producerBase.m_biMap.right.end());
   BOOST_CHECK(producerBase.m_biMap.left.find(hash) == producerBase.m_biMap.left.end());
@@ -78,6 +105,165 @@ BOOST_AUTO_TEST_CASE(ApplicationNack)
   BOOST_CHECK_EQUAL(m_face.sentData.front().getContentType(), ndn::tlv::ContentType_Nack);
 }
 
+BOOST_AUTO_TEST_CASE(LoadState)
+{
+  ProducerBase expected(m_face, m_keyChain, 40, Name("/psync"));
+  std::vector<std::pair<Name, uint64_t>> state;
+  for (uint64_t i = 0; i < 10000; i++) {
+    Name prefix("/user-" + std::to_string(i));
+    expected.addUserNode(prefix);
+    if (i % 10 != 0) {
+      expected.updateSeqNo(prefix, i);
+    }
+    state.emplace_back(prefix, i % 10 != 0 ? i : 0);
+  }
+  expected.updateSeqNo("/user-1", 20000);
+
+  ProducerBase producer(m_face, m_keyChain, 40, Name("/psync"));
+  producer.addUserNode("/user-1");
+  producer.updateSeqNo("/user-1", 20000);
+  producer.addUserNode("/user-2");
+  producer.updateSeqNo("/user-2", 1);
+  auto version = producer.m_stateVersion;
+  producer.loadState(state, 4);
+
+  BOOST_CHECK(producer.m_prefixes == expected.m_prefixes);
+  BOOST_CHECK_EQUAL(producer.m_iblt, expected.m_iblt);
+  BOOST_CHECK_EQUAL(producer.m_numOwnElements, expected.m_numOwnElements);
+  BOOST_CHECK_EQUAL(producer.m_biMap.size(), expected.m_biMap.size());
+  for (const auto& [hash, name] : expected.m_biMap.left) {
+    auto it = producer.m_biMap.left.find(hash);
+    BOOST_REQUIRE(it != producer.m_biMap.left.end());
+    BOOST_CHECK_EQUAL(it->second, name);
+  }
+  BOOST_CHECK(producer.m_nextSeqHashes == expected.m_nextSeqHashes);
+  BOOST_CHECK_EQUAL(producer.m_stateVersion, version + 1);
+}
+
+BOOST_AUTO_TEST_CASE(SnapshotAndJournal)
+{
+  ProducerBase producer(m_face, m_keyChain, 40, Name("/psync"));
+  producer.setJournal(m_journalPath);
+  for (int i = 0; i < 10; i++) {
+    Name prefix("/user-" + std::to_string(i));
+    producer.addUserNode(prefix);
+    producer.updateSeqNo(prefix, i + 1);
+  }
+  producer.saveSnapshot(m_snapshotPath);
+  BOOST_CHECK_EQUAL(std::filesystem::file_size(m_journalPath), 0);
+
+  // Changes after the snapshot only go to the journal
+  producer.updateSeqNo("/user-0", 5);
+  producer.removeUserNode("/user-1");
+  producer.addUserNode("/user-10");
+
+  ProducerBase restored(m_face, m_keyChain, 40, Name("/psync"));
+  restored.setJournal(m_journalPath);
+  BOOST_CHECK(restored.restoreSnapshot(m_snapshotPath));
+  BOOST_CHECK(restored.m_prefixes == producer.m_prefixes);
+  BOOST_CHECK_EQUAL(restored.m_iblt, producer.m_iblt);
+  BOOST_CHECK_EQUAL(restored.m_numOwnElements, producer.m_numOwnElements);
+  BOOST_CHECK_EQUAL(restored.m_biMap.size(), producer.m_biMap.size());
+  BOOST_CHECK(restored.m_biMap.right.find(Name("/user-0").appendNumber(5)) !=
+              restored.m_biMap.right.end());
+
+  // A record cut short is ignored
+  restored.updateSeqNo("/user-2", 10);
+  auto journalSize = std::filesystem::file_size(m_journalPath);
+  std::filesystem::resize_file(m_journalPath, journalSize - 1);
+  ProducerBase restoredAgain(m_face, m_keyChain, 40, Name("/psync"));
+  restoredAgain.setJournal(m_journalPath);
+  BOOST_CHECK(restoredAgain.restoreSnapshot(m_snapshotPath));
+  BOOST_CHECK(restoredAgain.m_prefixes == producer.m_prefixes);
+}
+
+BOOST_AUTO_TEST_CASE(TornJournal)
+{
+  ProducerBase producer(m_face, m_keyChain, 40, Name("/psync"));
+  producer.setJournal(m_journalPath);
+  producer.addUserNode("/user-0");
+  producer.updateSeqNo("/user-0", 1);
+  producer.saveSnapshot(m_snapshotPath);
+  producer.updateSeqNo("/user-0", 2);
+  auto journalSize = std::filesystem::file_size(m_journalPath);
+
+  // What a power failure in the middle of an append may leave: a record header, then zeros
+  {
+    std::ofstream file(m_journalPath, std::ios::binary | std::ios::app);
+    file.put(static_cast<char>(tlv::JournalUpdate));
+    file.put(20);
+    file << std::string(20, '\0');
+  }
+
+  // Reopening removes the torn record, so the records appended after it are replayed
+  ProducerBase restarted(m_face, m_keyChain, 40, Name("/psync"));
+  restarted.setJournal(m_journalPath);
+  BOOST_CHECK_EQUAL(std::filesystem::file_size(m_journalPath), journalSize);
+  BOOST_CHECK(restarted.restoreSnapshot(m_snapshotPath));
+  BOOST_CHECK_EQUAL(restarted.getSeqNo("/user-0").value_or(0), 2);
+  restarted.updateSeqNo("/user-0", 3);
+
+  ProducerBase restored(m_face, m_keyChain, 40, Name("/psync"));
+  restored.setJournal(m_journalPath);
+  BOOST_CHECK(restored.restoreSnapshot(m_snapshotPath));
+  BOOST_CHECK_EQUAL(restored.getSeqNo("/user-0").value_or(0), 3);
+
+  // A garbled record is not replayed, nor is anything after it
+  {
+    std::fstream file(m_journalPath, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekg(static_cast<std::streamoff>(journalSize) - 1);
+    char last = static_cast<char>(file.get() ^ 1);
+    file.seekp(static_cast<std::streamoff>(journalSize) - 1);
+    file.put(last);
+  }
+  ProducerBase garbled(m_face, m_keyChain, 40, Name("/psync"));
+  garbled.setJournal(m_journalPath);
+  BOOST_CHECK(garbled.restoreSnapshot(m_snapshotPath));
+  BOOST_CHECK_EQUAL(garbled.getSeqNo("/user-0").value_or(0), 1);
+}
+
+BOOST_AUTO_TEST_CASE(BatchedJournalSync)
+{
+  ProducerBase producer(m_face, m_keyChain, 40, Name("/psync"));
+  producer.setJournal(m_journalPath, 100_ms);
+  producer.addUserNode("/user-0");
+  BOOST_CHECK(producer.m_journalSyncEvent);
+  for (uint64_t seq = 1; seq <= 10; seq++) {
+    producer.updateSeqNo("/user-0", seq);
+  }
+
+  // The records are in the file right away, they are only synced later, all at once
+  BOOST_CHECK_EQUAL(detail::StateJournal::replay(m_journalPath, [] (const auto&) {}), 11);
+  advanceClocks(100_ms);
+  BOOST_CHECK(!producer.m_journalSyncEvent);
+
+  producer.updateSeqNo("/user-0", 11);
+  BOOST_CHECK(producer.m_journalSyncEvent);
+}
+
+BOOST_AUTO_TEST_CASE(CorruptSnapshot)
+{
+  ProducerBase producer(m_face, m_keyChain, 40, Name("/psync"));
+  BOOST_CHECK(!producer.restoreSnapshot(m_snapshotPath));
+
+  producer.addUserNode("/user");
+  producer.updateSeqNo("/user", 1);
+  producer.saveSnapshot(m_snapshotPath);
+
+  // Another IBF size
+  ProducerBase other(m_face, m_keyChain, 80, Name("/psync"));
+  BOOST_CHECK_THROW(other.restoreSnapshot(m_snapshotPath), ProducerBase::Error);
+
+  {
+    std::fstream file(m_snapshotPath, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(10);
+    file.put('\xff');
+  }
+  ProducerBase restored(m_face, m_keyChain, 40, Name("/psync"));
+  BOOST_CHECK_THROW(restored.restoreSnapshot(m_snapshotPath), ProducerBase::Error);
+  BOOST_CHECK(restored.m_prefixes.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace psync::tests
@@ -0,0 +1,113 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/publication-store.hpp"
+#include "PSync/partial-producer.hpp"
+
+#include "tests/boost-test.hpp"
+#include "tests/io-fixture.hpp"
+#include "tests/key-chain-fixture.hpp"
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+namespace psync::tests {
+
+using ndn::Interest;
+using ndn::Name;
+
+class PublicationStoreFixture : public IoFixture, public KeyChainFixture
+{
+protected:
+  PublicationStoreFixture()
+  {
+    advanceClocks(10_ms);
+    m_face.sentData.clear();
+  }
+
+  void
+  receive(const Name& prefix, uint64_t seq)
+  {
+    m_face.receive(Interest(Name(prefix).appendNumber(seq)));
+    advanceClocks(10_ms);
+  }
+
+protected:
+  ndn::DummyClientFace m_face{m_io, m_keyChain, {true, true}};
+  PartialProducer m_producer{m_face, m_keyChain, "/psync", {}};
+  const std::vector<uint8_t> m_content{1, 2, 3};
+};
+
+BOOST_FIXTURE_TEST_SUITE(TestPublicationStore, PublicationStoreFixture)
+
+BOOST_AUTO_TEST_CASE(PublishAndServe)
+{
+  PublicationStore store(m_face, m_keyChain, m_producer, {});
+
+  BOOST_CHECK_EQUAL(store.publish("/a", m_content), 1);
+  BOOST_CHECK_EQUAL(store.publish("/a", m_content), 2);
+  BOOST_CHECK_EQUAL(store.publish("/b", m_content), 1);
+  BOOST_CHECK_EQUAL(m_producer.getSeqNo("/a").value_or(0), 2);
+  BOOST_CHECK_EQUAL(m_producer.getSeqNo("/b").value_or(0), 1);
+  advanceClocks(10_ms);
+
+  receive("/a", 2);
+  BOOST_REQUIRE_EQUAL(m_face.sentData.size(), 1);
+  const auto& data = m_face.sentData.front();
+  BOOST_CHECK_EQUAL(data.getName(), Name("/a").appendNumber(2));
+  BOOST_CHECK_EQUAL_COLLECTIONS(data.getContent().value_begin(), data.getContent().value_end(),
+                                m_content.begin(), m_content.end());
+  // The stored encoding is put as is
+  BOOST_CHECK_EQUAL(data.wireEncode(), store.find("/a", 2)->wireEncode());
+
+  // Not published yet
+  receive("/b", 2);
+  BOOST_CHECK_EQUAL(m_face.sentData.size(), 1);
+  BOOST_CHECK_EQUAL(store.m_nInterestsServed, 1);
+}
+
+BOOST_AUTO_TEST_CASE(Retention)
+{
+  PublicationStore::Options opts;
+  opts.maxPublicationsPerPrefix = 2;
+  PublicationStore store(m_face, m_keyChain, m_producer, opts);
+
+  for (int i = 0; i < 3; i++) {
+    store.publish("/a", m_content);
+  }
+  BOOST_CHECK(store.find("/a", 1) == nullptr);
+  BOOST_CHECK(store.find("/a", 2) != nullptr);
+  BOOST_CHECK(store.find("/a", 3) != nullptr);
+  advanceClocks(10_ms);
+
+  receive("/a", 1);
+  BOOST_CHECK_EQUAL(m_face.sentData.size(), 0);
+  receive("/a", 3);
+  BOOST_CHECK_EQUAL(m_face.sentData.size(), 1);
+
+  store.erase("/a");
+  BOOST_CHECK(store.find("/a", 3) == nullptr);
+  receive("/a", 3);
+  BOOST_CHECK_EQUAL(m_face.sentData.size(), 1);
+  // The producer keeps announcing the prefix
+  BOOST_CHECK_EQUAL(m_producer.getSeqNo("/a").value_or(0), 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::tests
@@ -0,0 +1,67 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/stats.hpp"
+
+#include "tests/boost-test.hpp"
+
+namespace psync::tests {
+
+BOOST_AUTO_TEST_SUITE(TestStats)
+
+BOOST_AUTO_TEST_CASE(BucketIndex)
+{
+  BOOST_CHECK_EQUAL(LogHistogram::getBucketIndex(0), 0);
+  BOOST_CHECK_EQUAL(LogHistogram::getBucketIndex(1), 1);
+  BOOST_CHECK_EQUAL(LogHistogram::getBucketIndex(2), 2);
+  BOOST_CHECK_EQUAL(LogHistogram::getBucketIndex(3), 2);
+  BOOST_CHECK_EQUAL(LogHistogram::getBucketIndex(255), 8);
+  BOOST_CHECK_EQUAL(LogHistogram::getBucketIndex(256), 9);
+  BOOST_CHECK_EQUAL(LogHistogram::getBucketIndex(UINT64_MAX), 64);
+
+  for (size_t i = 0; i < LogHistogram::N_BUCKETS; i++) {
+    BOOST_CHECK_EQUAL(LogHistogram::getBucketIndex(LogHistogram::getBucketUpperBound(i)), i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Record)
+{
+  LogHistogram histogram;
+  BOOST_CHECK_EQUAL(histogram.getQuantile(0.5), 0);
+  BOOST_CHECK_EQUAL(histogram.getMean(), 0.0);
+
+  for (uint64_t value = 1; value <= 100; value++) {
+    histogram.record(value);
+  }
+  histogram.record(0);
+
+  BOOST_CHECK_EQUAL(histogram.getCount(), 101);
+  BOOST_CHECK_EQUAL(histogram.getSum(), 5050);
+  BOOST_CHECK_EQUAL(histogram.getMax(), 100);
+  BOOST_CHECK_CLOSE(histogram.getMean(), 50.0, 0.001);
+  BOOST_CHECK_EQUAL(histogram.getBucket(0), 1);
+  BOOST_CHECK_EQUAL(histogram.getBucket(7), 37); // 64 to 100
+  BOOST_CHECK_EQUAL(histogram.getQuantile(0.0), 0);
+  BOOST_CHECK_EQUAL(histogram.getQuantile(0.5), 63);
+  BOOST_CHECK_EQUAL(histogram.getQuantile(1.0), 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::tests
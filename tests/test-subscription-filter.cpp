@@ -0,0 +1,176 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/detail/subscription-filter.hpp"
+#include "PSync/detail/bloom-filter.hpp"
+#include "PSync/detail/cuckoo-filter.hpp"
+#include "PSync/detail/xor-filter.hpp"
+
+#include "tests/boost-test.hpp"
+
+namespace psync::tests {
+
+using namespace psync::detail;
+using ndn::Name;
+
+BOOST_AUTO_TEST_SUITE(TestSubscriptionFilter)
+
+BOOST_AUTO_TEST_CASE(PackBits)
+{
+  std::vector<uint16_t> values{0x1FFF, 0x0000, 0x1234, 0x0001, 0x0ABC};
+  auto bytes = packBits(values, 13);
+  BOOST_CHECK_EQUAL(bytes.size(), getPackedSize(values.size(), 13));
+  BOOST_CHECK_EQUAL(bytes.size(), 9);
+  BOOST_CHECK_EQUAL(bytes[0], 0xFF);
+  BOOST_CHECK_EQUAL(bytes[1], 0xF8);
+
+  auto unpacked = unpackBits(bytes, values.size(), 13);
+  BOOST_CHECK_EQUAL_COLLECTIONS(unpacked.begin(), unpacked.end(), values.begin(), values.end());
+
+  BOOST_CHECK_THROW(unpackBits(bytes, values.size() + 1, 13), SubscriptionFilter::Error);
+}
+
+BOOST_AUTO_TEST_CASE(Cuckoo)
+{
+  CuckooFilter filter(100, 0.001);
+  BOOST_CHECK_EQUAL(filter.getFingerprintSize(), 13);
+
+  for (int i = 0; i < 100; i++) {
+    filter.insert("/memphis-" + std::to_string(i));
+  }
+  for (int i = 0; i < 100; i++) {
+    BOOST_CHECK(filter.contains("/memphis-" + std::to_string(i)));
+  }
+
+  filter.erase("/memphis-0");
+  BOOST_CHECK(!filter.contains("/memphis-0"));
+  BOOST_CHECK(filter.contains("/memphis-1"));
+
+  Name name("/test");
+  filter.appendToName(name);
+  BOOST_CHECK_EQUAL(name.at(1).toNumber(), 100);
+  BOOST_CHECK_EQUAL(name.at(2).toNumber(), 1);
+  BOOST_CHECK_EQUAL(name.at(3).type(), tlv::CuckooFilterComponent);
+
+  CuckooFilter fromName(100, 0.001, name.at(-1));
+  for (int i = 1; i < 100; i++) {
+    BOOST_CHECK(fromName.contains("/memphis-" + std::to_string(i)));
+  }
+
+  BOOST_CHECK_THROW(CuckooFilter(200, 0.001, name.at(-1)), SubscriptionFilter::Error);
+}
+
+BOOST_AUTO_TEST_CASE(CuckooFull)
+{
+  CuckooFilter filter(4, 0.001);
+  BOOST_CHECK_EQUAL(filter.getNumBuckets(), 2);
+
+  int nInserted = 0;
+  BOOST_CHECK_THROW(
+    for (; nInserted < 20; nInserted++) {
+      filter.insert("/memphis-" + std::to_string(nInserted));
+    },
+    SubscriptionFilter::Error);
+
+  // The failed insertion leaves the other keys in place
+  BOOST_CHECK_LE(nInserted, 8);
+  for (int i = 0; i < nInserted; i++) {
+    BOOST_CHECK(filter.contains("/memphis-" + std::to_string(i)));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Xor)
+{
+  XorFilter filter(0, 0.001);
+  BOOST_CHECK_EQUAL(filter.getFingerprintSize(), 10);
+
+  for (int i = 0; i < 100; i++) {
+    filter.insert("/memphis-" + std::to_string(i));
+  }
+  filter.insert("/memphis-1");
+  filter.erase("/memphis-0");
+  filter.erase("/memphis-1");
+  for (int i = 1; i < 100; i++) {
+    BOOST_CHECK(filter.contains("/memphis-" + std::to_string(i)));
+  }
+
+  Name name("/test");
+  filter.appendToName(name);
+  // Sized after the 99 keys actually inserted
+  BOOST_CHECK_EQUAL(name.at(1).toNumber(), 99);
+  BOOST_CHECK_EQUAL(name.at(3).type(), tlv::XorFilterComponent);
+
+  XorFilter fromName(99, 0.001, name.at(-1));
+  for (int i = 1; i < 100; i++) {
+    BOOST_CHECK(fromName.contains("/memphis-" + std::to_string(i)));
+  }
+  BOOST_CHECK_THROW(fromName.insert("/memphis-0"), SubscriptionFilter::Error);
+
+  BOOST_CHECK_THROW(XorFilter(100, 0.001, name.at(-1)), SubscriptionFilter::Error);
+}
+
+BOOST_AUTO_TEST_CASE(FalsePositiveRate)
+{
+  for (auto type : {SubscriptionFilterType::CUCKOO, SubscriptionFilterType::XOR}) {
+    auto filter = makeSubscriptionFilter(type, 1000, 0.01);
+    for (int i = 0; i < 1000; i++) {
+      filter->insert("/memphis-" + std::to_string(i));
+    }
+
+    int nFalsePositives = 0;
+    for (int i = 0; i < 10000; i++) {
+      if (filter->contains("/other-" + std::to_string(i))) {
+        ++nFalsePositives;
+      }
+    }
+    // Twice the expected rate
+    BOOST_CHECK_LT(nFalsePositives, 200);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Parse)
+{
+  for (auto type : {SubscriptionFilterType::BLOOM,
+                    SubscriptionFilterType::CUCKOO,
+                    SubscriptionFilterType::XOR}) {
+    auto filter = makeSubscriptionFilter(type, 20, 0.001);
+    filter->insert("/memphis");
+    Name name;
+    filter->appendToName(name);
+    BOOST_REQUIRE_EQUAL(name.size(), 3);
+
+    auto parsed = parseSubscriptionFilter(name.at(0).toNumber(), name.at(1).toNumber() / 1000.,
+                                          name.at(2));
+    BOOST_CHECK(parsed->contains("/memphis"));
+    BOOST_CHECK_EQUAL(parsed->asBloomFilter() != nullptr, type == SubscriptionFilterType::BLOOM);
+  }
+
+  auto blocked = makeSubscriptionFilter(SubscriptionFilterType::BLOOM, 20, 0.001, true);
+  Name name;
+  blocked->appendToName(name);
+  auto parsed = parseSubscriptionFilter(20, 0.001, name.at(2));
+  BOOST_CHECK(parsed->asBloomFilter()->getLayout() == BloomFilter::Layout::BLOCKED);
+
+  BOOST_CHECK_THROW(parseSubscriptionFilter(20, 0.001, ndn::name::Component(200)),
+                    SubscriptionFilter::Error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::tests
@@ -0,0 +1,107 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/trace.hpp"
+#include "PSync/partial-producer.hpp"
+
+#include "tests/boost-test.hpp"
+#include "tests/key-chain-fixture.hpp"
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <sstream>
+
+namespace psync::tests {
+
+using ndn::Interest;
+using ndn::Name;
+
+BOOST_AUTO_TEST_SUITE(TestTrace)
+
+BOOST_AUTO_TEST_CASE(RingBuffer)
+{
+  RingBufferTracer tracer(3);
+  auto t0 = ndn::time::steady_clock::time_point(ndn::time::seconds(1));
+  tracer.begin(TraceStage::IBF_DECODE, 1, t0);
+  tracer.end(TraceStage::IBF_DECODE, 1, t0 + 5_us);
+  tracer.begin(TraceStage::STATE_ENCODE, 1, t0 + 6_us);
+  tracer.end(TraceStage::STATE_ENCODE, 1, t0 + 8_us);
+
+  // The oldest event was replaced
+  auto events = tracer.getEvents();
+  BOOST_REQUIRE_EQUAL(events.size(), 3);
+  BOOST_CHECK(events[0].stage == TraceStage::IBF_DECODE && !events[0].isBegin);
+  BOOST_CHECK(events[2].stage == TraceStage::STATE_ENCODE && !events[2].isBegin);
+
+  // Only the stage with both events is exported
+  std::ostringstream os;
+  tracer.writeChromeTrace(os);
+  BOOST_CHECK_EQUAL(os.str(),
+    "{\"traceEvents\": [\n"
+    "{\"name\": \"state-encode\", \"cat\": \"psync\", \"ph\": \"X\", \"ts\": 1000006, \"dur\": 2, "
+    "\"pid\": 1, \"tid\": 1, \"args\": {\"tag\": \"1\"}}\n"
+    "]}\n");
+
+  tracer.clear();
+  BOOST_CHECK(tracer.getEvents().empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(Producer, KeyChainFixture)
+{
+  ndn::DummyClientFace face(m_keyChain, {true, true});
+  PartialProducer producer(face, m_keyChain, "/psync", {});
+  producer.addUserNode("/testUser");
+  producer.publishName("/testUser");
+
+  Name syncPrefix("/psync/sync");
+  Name syncInterestName(syncPrefix);
+  detail::BloomFilter bf(20, 0.001);
+  bf.insert("/testUser");
+  bf.appendToName(syncInterestName);
+  detail::IBLT(40, CompressionScheme::NONE).appendToName(syncInterestName);
+
+  // Disabled by default
+  producer.onSyncInterest(syncPrefix, Interest(syncInterestName));
+  face.processEvents(10_ms);
+  BOOST_CHECK_EQUAL(face.sentData.size(), 1);
+
+  RingBufferTracer tracer;
+  producer.setTracer(&tracer);
+  syncInterestName.appendVersion(1).appendSegment(0);
+  producer.onSyncInterest(syncPrefix, Interest(syncInterestName));
+  face.processEvents(10_ms);
+  BOOST_CHECK_EQUAL(face.sentData.size(), 2);
+  producer.setTracer(nullptr);
+
+  std::vector<TraceStage> stages;
+  for (const auto& event : tracer.getEvents()) {
+    BOOST_CHECK_EQUAL(event.tag, std::hash<Name>{}(syncInterestName));
+    if (event.isBegin) {
+      stages.push_back(event.stage);
+    }
+  }
+  std::vector<TraceStage> expected{TraceStage::IBF_DECOMPRESS, TraceStage::IBF_DECODE,
+                                   TraceStage::STATE_ENCODE, TraceStage::SEGMENT_PUBLISH};
+  BOOST_CHECK(stages == expected);
+  BOOST_CHECK_EQUAL(tracer.getEvents().size(), 2 * expected.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::tests
@@ -0,0 +1,170 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/detail/update-batcher.hpp"
+
+#include "tests/boost-test.hpp"
+#include "tests/io-fixture.hpp"
+
+namespace psync::tests {
+
+using detail::UpdateBatcher;
+using ndn::Name;
+
+class UpdateBatcherFixture : public IoFixture
+{
+protected:
+  UpdateCallback
+  makeCallback()
+  {
+    return [this] (const std::vector<MissingDataInfo>& updates) {
+      deliveries.push_back(updates);
+    };
+  }
+
+protected:
+  ndn::Scheduler scheduler{m_io};
+  std::vector<std::vector<MissingDataInfo>> deliveries;
+};
+
+BOOST_FIXTURE_TEST_SUITE(TestUpdateBatcher, UpdateBatcherFixture)
+
+BOOST_AUTO_TEST_CASE(Immediate)
+{
+  UpdateBatcher batcher(scheduler, makeCallback(), 0_ms, 0);
+
+  batcher.add({{"/a", 1, 1, 0}});
+  batcher.add({{"/a", 2, 2, 0}});
+  batcher.add({});
+  BOOST_CHECK_EQUAL(deliveries.size(), 2);
+  BOOST_CHECK_EQUAL(batcher.getStats().nDeliveries, 2);
+  BOOST_CHECK_EQUAL(batcher.getStats().nUpdatesMerged, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Interval)
+{
+  UpdateBatcher batcher(scheduler, makeCallback(), 100_ms, 0);
+
+  batcher.add({{"/a", 1, 1, 0}, {"/b", 3, 5, 0}});
+  advanceClocks(10_ms, 5);
+  batcher.add({{"/a", 2, 4, 0}, {"/c", 1, 1, 0}});
+  batcher.add({{"/b", 6, 6, 7}});
+  BOOST_CHECK_EQUAL(batcher.getStats().queueDepth, 3);
+  BOOST_CHECK(deliveries.empty());
+
+  advanceClocks(10_ms, 5);
+  BOOST_REQUIRE_EQUAL(deliveries.size(), 1);
+  // In the order the prefixes were first received
+  const auto& updates = deliveries.front();
+  BOOST_REQUIRE_EQUAL(updates.size(), 3);
+  BOOST_CHECK_EQUAL(updates[0].prefix, "/a");
+  BOOST_CHECK_EQUAL(updates[0].lowSeq, 1);
+  BOOST_CHECK_EQUAL(updates[0].highSeq, 4);
+  BOOST_CHECK_EQUAL(updates[1].prefix, "/b");
+  BOOST_CHECK_EQUAL(updates[1].lowSeq, 3);
+  BOOST_CHECK_EQUAL(updates[1].highSeq, 6);
+  BOOST_CHECK_EQUAL(updates[1].incomingFace, 7);
+  BOOST_CHECK_EQUAL(updates[2].prefix, "/c");
+
+  const auto& stats = batcher.getStats();
+  BOOST_CHECK_EQUAL(stats.queueDepth, 0);
+  BOOST_CHECK_EQUAL(stats.maxQueueDepth, 3);
+  BOOST_CHECK_EQUAL(stats.nUpdatesReceived, 5);
+  BOOST_CHECK_EQUAL(stats.nUpdatesMerged, 2);
+  BOOST_CHECK_EQUAL(stats.nDeliveries, 1);
+  BOOST_CHECK(stats.lastFlushLatency == 100_ms);
+
+  // The interval starts again with the next update
+  batcher.add({{"/a", 5, 5, 0}});
+  advanceClocks(10_ms, 9);
+  BOOST_CHECK_EQUAL(deliveries.size(), 1);
+  advanceClocks(10_ms);
+  BOOST_CHECK_EQUAL(deliveries.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(BatchSize)
+{
+  UpdateBatcher batcher(scheduler, makeCallback(), 1_s, 2);
+
+  batcher.add({{"/a", 1, 1, 0}});
+  batcher.add({{"/a", 2, 2, 0}});
+  BOOST_CHECK(deliveries.empty());
+  batcher.add({{"/b", 1, 1, 0}});
+  BOOST_REQUIRE_EQUAL(deliveries.size(), 1);
+  BOOST_CHECK_EQUAL(deliveries.front().size(), 2);
+
+  // The timer of the delivered updates was canceled
+  advanceClocks(100_ms, 20);
+  BOOST_CHECK_EQUAL(deliveries.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(AddFromCallback)
+{
+  UpdateBatcher* batcherPtr = nullptr;
+  UpdateBatcher batcher(scheduler, [&] (const auto& updates) {
+    deliveries.push_back(updates);
+    if (deliveries.size() == 1) {
+      batcherPtr->add({{"/a", 2, 2, 0}, {"/b", 1, 1, 0}});
+    }
+  }, 10_ms, 2);
+  batcherPtr = &batcher;
+
+  batcher.add({{"/a", 1, 1, 0}, {"/c", 1, 1, 0}});
+  BOOST_REQUIRE_EQUAL(deliveries.size(), 1);
+  BOOST_CHECK_EQUAL(deliveries[0][0].highSeq, 1);
+  BOOST_CHECK_EQUAL(batcher.getStats().queueDepth, 2);
+
+  advanceClocks(10_ms);
+  BOOST_REQUIRE_EQUAL(deliveries.size(), 2);
+  BOOST_CHECK_EQUAL(deliveries[1][0].highSeq, 2);
+}
+
+BOOST_AUTO_TEST_CASE(ThrowingCallback)
+{
+  UpdateBatcher batcher(scheduler, [this] (const auto& updates) {
+    deliveries.push_back(updates);
+    if (deliveries.size() == 1) {
+      throw std::runtime_error("callback error");
+    }
+  }, 10_ms, 0);
+
+  batcher.add({{"/a", 1, 1, 0}});
+  BOOST_CHECK_THROW(advanceClocks(10_ms), std::runtime_error);
+  BOOST_CHECK_EQUAL(deliveries.size(), 1);
+
+  batcher.add({{"/a", 2, 2, 0}});
+  advanceClocks(10_ms);
+  BOOST_REQUIRE_EQUAL(deliveries.size(), 2);
+  BOOST_CHECK_EQUAL(deliveries[1][0].highSeq, 2);
+}
+
+BOOST_AUTO_TEST_CASE(Clear)
+{
+  UpdateBatcher batcher(scheduler, makeCallback(), 10_ms, 0);
+
+  batcher.add({{"/a", 1, 1, 0}});
+  batcher.clear();
+  BOOST_CHECK_EQUAL(batcher.getStats().queueDepth, 0);
+  advanceClocks(10_ms, 2);
+  BOOST_CHECK(deliveries.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::tests
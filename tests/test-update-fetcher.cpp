@@ -0,0 +1,205 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2022,  The University of Memphis
+ *
+ * This file is part of PSync.
+ * See AUTHORS.md for complete list of PSync authors and contributors.
+ *
+ * PSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * PSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * PSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PSync/update-fetcher.hpp"
+
+#include "tests/boost-test.hpp"
+#include "tests/io-fixture.hpp"
+#include "tests/key-chain-fixture.hpp"
+
+#include <ndn-cxx/security/signing-helpers.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+namespace psync::tests {
+
+using ndn::Name;
+using Range = std::tuple<Name, uint64_t, uint64_t>;
+
+class UpdateFetcherFixture : public IoFixture, public KeyChainFixture
+{
+protected:
+  UpdateFetcher::Options
+  makeOptions()
+  {
+    UpdateFetcher::Options opts;
+    opts.onData = [this] (const Name& prefix, uint64_t seq, const ndn::Data&) {
+      delivered.emplace_back(prefix, seq);
+    };
+    opts.onFailure = [this] (const Name& prefix, uint64_t lowSeq, uint64_t highSeq) {
+      failed.emplace_back(prefix, lowSeq, highSeq);
+    };
+    return opts;
+  }
+
+  void
+  reply(const ndn::Interest& interest)
+  {
+    auto data = std::make_shared<ndn::Data>(interest.getName());
+    m_keyChain.sign(*data, ndn::signingWithSha256());
+    face.receive(*data);
+    advanceClocks(1_ms);
+  }
+
+  static Name
+  makeName(const Name& prefix, uint64_t seq)
+  {
+    return Name(prefix).appendNumber(seq);
+  }
+
+protected:
+  ndn::DummyClientFace face{m_io, m_keyChain, {true, false}};
+  std::vector<std::tuple<Name, uint64_t>> delivered;
+  std::vector<Range> failed;
+};
+
+BOOST_FIXTURE_TEST_SUITE(TestUpdateFetcher, UpdateFetcherFixture)
+
+BOOST_AUTO_TEST_CASE(WindowAndOrder)
+{
+  UpdateFetcher fetcher(face, makeOptions());
+  fetcher.fetch({{"/a", 1, 10, 0}});
+  advanceClocks(1_ms);
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 1);
+  BOOST_CHECK_EQUAL(face.sentInterests[0].getName(), makeName("/a", 1));
+
+  // Slow start
+  reply(face.sentInterests[0]);
+  BOOST_CHECK_EQUAL(fetcher.getCwnd(), 2.0);
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 3);
+  BOOST_CHECK_EQUAL(face.sentInterests[1].getName(), makeName("/a", 2));
+  BOOST_CHECK_EQUAL(face.sentInterests[2].getName(), makeName("/a", 3));
+  BOOST_CHECK_EQUAL(fetcher.getNumInFlight(), 2);
+
+  // Delivered in order
+  reply(face.sentInterests[2]);
+  BOOST_CHECK_EQUAL(delivered.size(), 1);
+  reply(face.sentInterests[1]);
+  BOOST_REQUIRE_EQUAL(delivered.size(), 3);
+  for (uint64_t i = 0; i < delivered.size(); i++) {
+    BOOST_CHECK_EQUAL(std::get<1>(delivered[i]), i + 1);
+  }
+  BOOST_CHECK_EQUAL(fetcher.getCwnd(), 4.0);
+  BOOST_CHECK_EQUAL(fetcher.getNumInFlight(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(Duplicates)
+{
+  UpdateFetcher fetcher(face, makeOptions());
+  fetcher.fetch({{"/a", 1, 3, 0}});
+  fetcher.fetch({{"/a", 2, 5, 0}});
+  fetcher.fetch({{"/a", 1, 2, 0}});
+  advanceClocks(1_ms);
+
+  for (size_t i = 0; i < face.sentInterests.size(); i++) {
+    reply(face.sentInterests[i]);
+  }
+  BOOST_CHECK_EQUAL(face.sentInterests.size(), 5);
+  BOOST_REQUIRE_EQUAL(delivered.size(), 5);
+  BOOST_CHECK_EQUAL(std::get<1>(delivered.back()), 5);
+  // Forgotten once everything is delivered
+  BOOST_CHECK(fetcher.m_prefixes.empty());
+
+  // Being fetched
+  fetcher.fetch({{"/a", 6, 7, 0}});
+  fetcher.fetch({{"/a", 6, 7, 0}});
+  advanceClocks(1_ms);
+  BOOST_CHECK_EQUAL(face.sentInterests.size(), 7);
+  BOOST_CHECK_EQUAL(face.sentInterests.back().getName(), makeName("/a", 7));
+  BOOST_CHECK_EQUAL(fetcher.m_prefixes.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(NewestPrefixFirst)
+{
+  UpdateFetcher fetcher(face, makeOptions());
+  fetcher.fetch({{"/a", 1, 2, 0}});
+  fetcher.fetch({{"/b", 1, 2, 0}});
+  advanceClocks(1_ms);
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 1);
+  BOOST_CHECK_EQUAL(face.sentInterests[0].getName(), makeName("/a", 1));
+
+  reply(face.sentInterests[0]);
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 3);
+  BOOST_CHECK_EQUAL(face.sentInterests[1].getName(), makeName("/b", 1));
+  BOOST_CHECK_EQUAL(face.sentInterests[2].getName(), makeName("/b", 2));
+
+  // A new update moves /a to the front again
+  fetcher.fetch({{"/b", 3, 3, 0}});
+  fetcher.fetch({{"/a", 3, 3, 0}});
+  reply(face.sentInterests[1]);
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 5);
+  BOOST_CHECK_EQUAL(face.sentInterests[3].getName(), makeName("/a", 2));
+  BOOST_CHECK_EQUAL(face.sentInterests[4].getName(), makeName("/a", 3));
+}
+
+BOOST_AUTO_TEST_CASE(RetryAndGiveUp)
+{
+  auto opts = makeOptions();
+  opts.interestLifetime = 100_ms;
+  opts.maxRetries = 1;
+  opts.initCwnd = 8;
+  UpdateFetcher fetcher(face, opts);
+  fetcher.fetch({{"/a", 1, 3, 0}});
+  advanceClocks(1_ms);
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 3);
+  reply(face.sentInterests[1]);
+
+  // The window is decreased once for the losses of the same window
+  advanceClocks(10_ms, 10);
+  BOOST_CHECK_EQUAL(fetcher.getCwnd(), 4.5);
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 5);
+  BOOST_CHECK_EQUAL(face.sentInterests[3].getName(), makeName("/a", 1));
+  BOOST_CHECK_EQUAL(face.sentInterests[4].getName(), makeName("/a", 3));
+  BOOST_CHECK(delivered.empty());
+
+  reply(face.sentInterests[4]);
+  advanceClocks(10_ms, 10);
+  BOOST_CHECK_CLOSE(fetcher.getCwnd(), (4.5 + 1 / 4.5) / 2, 0.001);
+  BOOST_CHECK_EQUAL(fetcher.getNumInFlight(), 0);
+  BOOST_REQUIRE_EQUAL(failed.size(), 1);
+  BOOST_CHECK(failed[0] == Range("/a", 1, 1));
+  BOOST_REQUIRE_EQUAL(delivered.size(), 2);
+  BOOST_CHECK_EQUAL(std::get<1>(delivered[0]), 2);
+  BOOST_CHECK_EQUAL(std::get<1>(delivered[1]), 3);
+}
+
+BOOST_AUTO_TEST_CASE(Backlog)
+{
+  auto opts = makeOptions();
+  opts.maxBacklogPerPrefix = 2;
+  UpdateFetcher fetcher(face, opts);
+  fetcher.fetch({{"/a", 1, 10, 0}});
+  advanceClocks(1_ms);
+  BOOST_REQUIRE_EQUAL(failed.size(), 1);
+  BOOST_CHECK(failed[0] == Range("/a", 1, 8));
+  BOOST_REQUIRE_EQUAL(face.sentInterests.size(), 1);
+  BOOST_CHECK_EQUAL(face.sentInterests[0].getName(), makeName("/a", 9));
+
+  // The skipped range is reported before the Data that follows
+  fetcher.fetch({{"/a", 11, 13, 0}});
+  BOOST_REQUIRE_EQUAL(failed.size(), 1);
+  reply(face.sentInterests[0]);
+  BOOST_REQUIRE_EQUAL(failed.size(), 2);
+  BOOST_CHECK(failed[1] == Range("/a", 10, 11));
+  BOOST_REQUIRE_EQUAL(delivered.size(), 1);
+  BOOST_CHECK_EQUAL(std::get<1>(delivered[0]), 9);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace psync::tests
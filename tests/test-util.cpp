@@ -21,6 +21,8 @@
 
 #include "tests/boost-test.hpp"
 
+#include <numeric>
+
 namespace psync::tests {
 
 using namespace psync::detail;
@@ -72,6 +74,93 @@ BOOST_AUTO_TEST_CASE(Compression)
   }
 }
 
+BOOST_AUTO_TEST_CASE(NameHash)
+{
+  // Components with 1, 3 and 5-octet TLV-LENGTH
+  const std::vector<uint8_t> medium(300, 'x');
+  const std::vector<uint8_t> large(70000, 'y');
+  const std::vector<ndn::Name> prefixes{
+    "/",
+    "/a",
+    "/psync/user-1/8=%FF",
+    "/test/32=keyword/sha256digest=0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef",
+    ndn::Name("/long").append(medium).append(large),
+  };
+  const std::vector<uint64_t> seqs{0, 1, 252, 253, 0xFF, 0x100, 0xFFFF, 0x10000,
+                                   0xFFFFFFFF, 0x100000000, 0xFFFFFFFFFFFFFFFF};
+
+  for (const auto& prefix : prefixes) {
+    // Hashed from the components
+    ndn::Name copy;
+    copy.append(prefix);
+    BOOST_REQUIRE(!copy.hasWire());
+    const auto& wire = prefix.wireEncode();
+    BOOST_CHECK_EQUAL(murmurHash3(11, copy), murmurHash3(wire.value(), wire.value_size(), 11));
+    BOOST_CHECK(!copy.hasWire());
+    // Hashed from the cached wire
+    BOOST_CHECK_EQUAL(murmurHash3(11, prefix), murmurHash3(wire.value(), wire.value_size(), 11));
+
+    for (auto seq : seqs) {
+      auto nameWithSeq = ndn::Name(prefix).appendNumber(seq);
+      const auto& wireWithSeq = nameWithSeq.wireEncode();
+      BOOST_CHECK_EQUAL(murmurHash3(11, prefix, seq),
+                        murmurHash3(wireWithSeq.value(), wireWithSeq.value_size(), 11));
+      BOOST_CHECK_EQUAL(murmurHash3(3, copy, seq), murmurHash3(3, ndn::Name(copy).appendNumber(seq)));
+    }
+  }
+
+  // Any split of the bytes gives the same hash
+  std::vector<uint8_t> bytes(37);
+  std::iota(bytes.begin(), bytes.end(), 0);
+  ndn::span<const uint8_t> all(bytes);
+  for (size_t split = 0; split < bytes.size(); ++split) {
+    MurmurHash3 hasher(42);
+    hasher.update(all.first(split));
+    hasher.update(all.subspan(split, 1));
+    hasher.update(all.subspan(split + 1));
+    BOOST_CHECK_EQUAL(hasher.finalize(), murmurHash3(bytes.data(), bytes.size(), 42));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MultiSeedHash)
+{
+  // Fewer, as many and more seeds than lanes
+  std::vector<uint32_t> seeds(2 * MURMUR_HASH3_LANES + 3);
+  std::iota(seeds.begin(), seeds.end(), 0);
+  seeds.back() = 0xA5A5A5A5;
+  std::vector<uint8_t> bytes(23);
+  std::iota(bytes.begin(), bytes.end(), 100);
+
+  for (size_t nSeeds : {size_t(1), MURMUR_HASH3_LANES, seeds.size()}) {
+    ndn::span<const uint32_t> someSeeds(seeds.data(), nSeeds);
+    for (size_t len = 0; len <= bytes.size(); ++len) {
+      std::vector<uint32_t> hashes(nSeeds);
+      murmurHash3xN(bytes.data(), len, someSeeds, hashes);
+      for (size_t i = 0; i < nSeeds; ++i) {
+        BOOST_CHECK_EQUAL(hashes[i], murmurHash3(bytes.data(), len, seeds[i]));
+      }
+    }
+
+    std::vector<uint32_t> hashes(nSeeds);
+    murmurHash3xN(uint32_t(12345), someSeeds, hashes);
+    for (size_t i = 0; i < nSeeds; ++i) {
+      BOOST_CHECK_EQUAL(hashes[i], murmurHash3(seeds[i], uint32_t(12345)));
+    }
+
+    ndn::Name name("/psync/user-1");
+    name.appendNumber(1000);
+    murmurHash3xN(name, someSeeds, hashes);
+    for (size_t i = 0; i < nSeeds; ++i) {
+      BOOST_CHECK_EQUAL(hashes[i], murmurHash3(seeds[i], name));
+    }
+    name.wireEncode();
+    murmurHash3xN(name, someSeeds, hashes);
+    for (size_t i = 0; i < nSeeds; ++i) {
+      BOOST_CHECK_EQUAL(hashes[i], murmurHash3(seeds[i], name));
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace psync::tests